@@ -1,14 +1,39 @@
 #!/bin/bash
-# Generate self-signed certificate for testing
+# Generate self-signed certificates for testing
+#
+#   ./gen_certs.sh                 RSA-2048 -> server.key / server.crt (default)
+#   ./gen_certs.sh ecdsa           ECDSA P-256 -> server.key / server.crt
+#   ./gen_certs.sh ed25519 x       Ed25519 -> x.key / x.crt
+#   ./gen_certs.sh all             every type -> server-<type>.key / .crt
+#
+# Types: rsa (2048), rsa3072, ecdsa (P-256), ed25519
+set -e
 
-# 1. Generate Private Key
-openssl genrsa -out server.key 2048
+SUBJ="/C=TW/ST=Taiwan/L=Taipei/O=TCG/OU=Game/CN=localhost"
 
-# 2. Generate Self-Signed Certificate
-openssl req -new -x509 -key server.key -out server.crt -days 365 \
-    -subj "/C=TW/ST=Taiwan/L=Taipei/O=TCG/OU=Game/CN=localhost"
+gen() {
+    local type=$1 out=$2
 
-# 3. (Optional) Generate Client Key/Cert if we want mutual auth (skipping for this simple case)
+    # 1. Generate Private Key
+    case "$type" in
+        rsa)     openssl genpkey -algorithm RSA -pkeyopt rsa_keygen_bits:2048 -out "$out.key" ;;
+        rsa3072) openssl genpkey -algorithm RSA -pkeyopt rsa_keygen_bits:3072 -out "$out.key" ;;
+        ecdsa)   openssl genpkey -algorithm EC -pkeyopt ec_paramgen_curve:P-256 -out "$out.key" ;;
+        ed25519) openssl genpkey -algorithm ED25519 -out "$out.key" ;;
+        *) echo "unknown key type: $type (rsa, rsa3072, ecdsa, ed25519)" >&2; exit 1 ;;
+    esac
 
-echo "Generated server.key and server.crt"
-chmod 600 server.key
+    # 2. Generate Self-Signed Certificate
+    openssl req -new -x509 -key "$out.key" -out "$out.crt" -days 365 -subj "$SUBJ"
+
+    # 3. (Optional) Generate Client Key/Cert if we want mutual auth (skipping for this simple case)
+
+    chmod 600 "$out.key"
+    echo "Generated $out.key and $out.crt ($type)"
+}
+
+if [ "$1" = "all" ]; then
+    for t in rsa rsa3072 ecdsa ed25519; do gen "$t" "server-$t"; done
+else
+    gen "${1:-rsa}" "${2:-server}"
+fi
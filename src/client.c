@@ -2,6 +2,11 @@
 #include "common/net.h"
 #include <errno.h>
 #include "common/proto.h"
+#include "common/cards.h"
+#include "common/evlog.h"
+#include "loadgen.h"
+#include "soak.h"
+#include "predcheck.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,7 +59,8 @@ static void* worker(void *p) {
 
     // login
     long long t0 = now_ns();
-    if (proto_send(&conn, OP_LOGIN_REQ, NULL, 0) != 0) { conn_close(&conn); a->lat_ns_out[a->idx] = -1; return NULL; }
+    login_req_t lr = { .caps = CAP_EVENT_LOG };
+    if (proto_send(&conn, OP_LOGIN_REQ, &lr, sizeof(lr)) != 0) { conn_close(&conn); a->lat_ns_out[a->idx] = -1; return NULL; }
 
     uint8_t buf[1024];
     uint16_t op; uint32_t plen;
@@ -91,9 +97,8 @@ static void* worker(void *p) {
         if (proto_recv(&conn, &op, buf, sizeof(buf), &plen) != 0) { conn_close(&conn); a->lat_ns_out[a->idx] = -1; return NULL; }
     }
     
-    if (op == OP_STATE && plen == sizeof(state_t) && a->idx == 0) {
-        state_t st;
-        memcpy(&st, buf, sizeof(st));
+    state_t st;
+    if (op == OP_STATE && a->idx == 0 && state_decode(buf, plen, &st, NULL) == 0) {
         printf("[login] HP=%d AI=%d over=%u winner=%u\n", st.p_hp, st.ai_hp, st.game_over, st.winner);
     }
     
@@ -130,9 +135,7 @@ static void* worker(void *p) {
              if (proto_recv(&conn, &op, buf, sizeof(buf), &plen) != 0) break;
              if (op == OP_STATE) {
                  seen_state = 1;
-                 if (plen == sizeof(state_t) && a->idx == 0) {
-                    state_t st;
-                    memcpy(&st, buf, sizeof(st));
+                 if (a->idx == 0 && state_decode(buf, plen, &st, NULL) == 0) {
                     printf("[play]  HP=%d AI=%d over=%u winner=%u\n", st.p_hp, st.ai_hp, st.game_over, st.winner);
                     if (st.game_over) goto done;
                  }
@@ -151,9 +154,7 @@ static void* worker(void *p) {
              if (proto_recv(&conn, &op, buf, sizeof(buf), &plen) != 0) break;
              if (op == OP_STATE) {
                  seen_state = 1;
-                 if (plen == sizeof(state_t) && a->idx == 0) {
-                    state_t st;
-                    memcpy(&st, buf, sizeof(st));
+                 if (a->idx == 0 && state_decode(buf, plen, &st, NULL) == 0) {
                     printf("[end]   HP=%d AI=%d over=%u winner=%u\n", st.p_hp, st.ai_hp, st.game_over, st.winner);
                     if (st.game_over) goto done;
                  }
@@ -171,32 +172,131 @@ done:
     return NULL;
 }
 
-int run_app_mode(const char *host, uint16_t port);
+int run_app_mode(const char *host, uint16_t port, int predict, int tier);
+
+// --soak without --scenario: every way a player can come and go
+static const char *g_soak_mix =
+    "game    weight=40 think=exp:300;"
+    "flaky   kind=game weight=20 think=exp:300 drop=0.05;"
+    "quitter kind=game weight=15 think=exp:300 abandon=0.05;"
+    "staller kind=game weight=10 think=exp:300 stall=0.05;"
+    "idle    weight=10 idle=20 ping=2000;"
+    "sloppy  kind=game weight=5 think=exp:300 bad=0.3";
+
+// "a,b,c" or "start:stop:step" (req/s) -> rates[]; returns the count
+static int parse_rates(const char *spec, double *rates, int cap) {
+    double a, b, step;
+    int n = 0;
+    if (sscanf(spec, "%lf:%lf:%lf", &a, &b, &step) == 3 && step > 0) {
+        for (double r = a; r <= b + 1e-9 && n < cap; r += step) rates[n++] = r;
+        return n;
+    }
+    for (const char *p = spec; *p && n < cap; ) {
+        char *end;
+        double r = strtod(p, &end);
+        if (end == p) break;
+        if (r > 0) rates[n++] = r;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
 
 int main(int argc, char **argv) {
     ssl_msg_init();
+    if (cards_init() != 0) return 1;
 
     /* ---------- APP MODE ---------- */
     if (argc >= 2 && strcmp(argv[1], "--app") == 0) {
         const char *host = "127.0.0.1";
         uint16_t port = 9000;
 
-        if (argc >= 3) host = argv[2];
-        if (argc >= 4) port = (uint16_t)atoi(argv[3]);
+        int predict = 1;
+        int tier = AI_TIER_DEFAULT;
+        int npos = 0;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--no-predict") == 0) predict = 0;
+            else if (strcmp(argv[i], "--tier") == 0 && i + 1 < argc) {
+                if ((tier = proto_ai_tier(argv[++i])) < 0) { fprintf(stderr, "unknown tier %s\n", argv[i]); return 2; }
+            }
+            else if (npos == 0) { host = argv[i]; npos++; }
+            else if (npos == 1) { port = (uint16_t)atoi(argv[i]); npos++; }
+        }
+
+        return run_app_mode(host, port, predict, tier);
+    }
 
-        return run_app_mode(host, port);
+    /* ---------- PREDICTION CHECK ---------- */
+    // ./client --predict-check [host] [port] [games]
+    if (argc >= 2 && strcmp(argv[1], "--predict-check") == 0) {
+        const char *host = argc > 2 ? argv[2] : "127.0.0.1";
+        uint16_t port = argc > 3 ? (uint16_t)atoi(argv[3]) : 9000;
+        int games = argc > 4 ? atoi(argv[4]) : 5;
+        return run_predict_check(host, port, games > 0 ? games : 1);
     }
     
     /* ---------- BENCH MODE (default) ---------- */
+    // ./client [players] [rounds] [host] [port] [--ramp N] [--lg-threads N]
+    //          [--timeout S] [--bind IP,IP..] [--pings N] [--json FILE] [--csv FILE]
+    //          [--label NAME] [-v] [--legacy]
+    //          [--rate R | --sweep a,b,c | --sweep start:stop:step]
+    //          [--arrival fixed|poisson] [--duration S]
+    //          [--scenario FILE|SPEC] [--policy greedy|search|random|first]
+    //          [--soak S] [--sample S] [--samples FILE] [--server-pid PID] [--no-ai-stream]
+    //          [--tier default|easy|normal|hard]
     const char *host = "127.0.0.1";
     uint16_t port = 9000;
     int threads = 100;
     int rounds = 5;
+    int legacy = 0;
+    double rates[64];
+    const char *scenario = NULL;
+    double sample_s = 5;
+    const char *samples_path = NULL;
+    pid_t server_pid = 0;
 
-    if (argc >= 2) threads = atoi(argv[1]);
-    if (argc >= 3) rounds = atoi(argv[2]);
-    if (argc >= 4) host = argv[3];
-    if (argc >= 5) port = (uint16_t)atoi(argv[4]);
+    long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+    lg_config_t lg = {
+        .threads = (nproc > 8) ? 8 : (nproc > 0 ? (int)nproc : 1),
+        .ramp = 1000,
+        .timeout_s = 10,
+        .rates = rates,
+        .step_s = 10,
+    };
+
+    int pos = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--legacy") == 0) legacy = 1;
+        else if (strcmp(argv[i], "-v") == 0) lg.verbose = 1;
+        else if (strcmp(argv[i], "--ramp") == 0 && i + 1 < argc) lg.ramp = atof(argv[++i]);
+        else if (strcmp(argv[i], "--lg-threads") == 0 && i + 1 < argc) lg.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) lg.timeout_s = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) lg.bind_ips = argv[++i];
+        else if (strcmp(argv[i], "--pings") == 0 && i + 1 < argc) lg.pings = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) lg.json_path = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) lg.csv_path = argv[++i];
+        else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) lg.label = argv[++i];
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) lg.nrates = parse_rates(argv[++i], rates, 1);
+        else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc) lg.nrates = parse_rates(argv[++i], rates, 64);
+        else if (strcmp(argv[i], "--arrival") == 0 && i + 1 < argc) lg.poisson = strcmp(argv[++i], "poisson") == 0;
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) lg.step_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) scenario = argv[++i];
+        else if (strcmp(argv[i], "--soak") == 0 && i + 1 < argc) lg.soak_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) sample_s = atof(argv[++i]);
+        else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) samples_path = argv[++i];
+        else if (strcmp(argv[i], "--server-pid") == 0 && i + 1 < argc) server_pid = (pid_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-ai-stream") == 0) lg.no_ai_stream = 1;
+        else if (strcmp(argv[i], "--tier") == 0 && i + 1 < argc) {
+            if ((lg.tier = proto_ai_tier(argv[++i])) < 0) { fprintf(stderr, "unknown tier %s\n", argv[i]); return 2; }
+        }
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            lg.policy = loadgen_policy(argv[++i]);
+            if (lg.policy < 0) { fprintf(stderr, "unknown policy %s\n", argv[i]); return 2; }
+        }
+        else if (pos == 0) { threads = atoi(argv[i]); pos++; }
+        else if (pos == 1) { rounds = atoi(argv[i]); pos++; }
+        else if (pos == 2) { host = argv[i]; pos++; }
+        else if (pos == 3) { port = (uint16_t)atoi(argv[i]); pos++; }
+    }
 
     SSL_CTX *ctx = ssl_init_client_ctx();
     if (!ctx) {
@@ -204,18 +304,39 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    lg_scenario_t scn;
+    if (lg.soak_s > 0 && !scenario) scenario = g_soak_mix;
+    if (scenario) {
+        // after the loop: rounds/pings/policy defaults come from the other arguments
+        lg.rounds = rounds;
+        if (loadgen_parse_scenario(scenario, &lg, &scn) != 0) return 2;
+        lg.scenario = &scn;
+    }
+
+    if (!legacy) {
+        lg.host = host;
+        lg.port = port;
+        lg.sessions = threads;
+        lg.rounds = rounds;
+
+        // soak: watch the server process while the load runs (same host only)
+        soak_t *soak = NULL;
+        if (lg.soak_s > 0) {
+            if (server_pid <= 0) server_pid = soak_find_server(port);
+            if (server_pid > 0) soak = soak_start(server_pid, sample_s, samples_path);
+            else fprintf(stderr, "[soak] no local process listens on %u: server sampling off\n", port);
+        }
+        int rc = loadgen_run(&lg, ctx);
+        if (soak && soak_stop(soak) > 0 && rc == 0) rc = 3;
+        SSL_CTX_free(ctx);
+        return rc;
+    }
+
+    /* ---------- LEGACY: one thread per player ---------- */
     pthread_t *tids = calloc((size_t)threads, sizeof(pthread_t));
     th_arg_t  *args = calloc((size_t)threads, sizeof(th_arg_t));
     long long *lats = calloc((size_t)threads, sizeof(long long));
 
-    /* han edit tls */
-    net_init_ssl();
-    // For client, we usually verify server cert. For self-signed test, we might skip verification or load CA.
-    // Simplification: just create client context, no strict verification logic added here for MVP test unless requested
-    SSL_CTX *ctx = net_create_context(0); // 0 = client
-    // net_configure_context(ctx, "client.crt", "client.key"); // Optional for client auth
-    /* han edit tls end */
-
     for (int i = 0; i < threads; i++) {
         args[i] = (th_arg_t){ .host=host, .port=port, .rounds=rounds, .lat_ns_out=lats, .idx=i, .ctx=ctx };
         pthread_create(&tids[i], NULL, worker, &args[i]);
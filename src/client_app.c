@@ -2,170 +2,488 @@
 #include "common/net.h"
 #include "common/proto.h"
 #include "common/cards.h"
+#include "common/evlog.h"
+#include "common/predict.h"
 
 #include <ncursesw/ncurses.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <openssl/ssl.h>
 
-static int recv_until(connection_t *conn, state_t *st, hand_t *hand) {
-    int got_state = 0, got_hand = 0;
-    uint8_t buf[2048];
-    uint16_t op;
-    uint32_t plen;
-
-    while (!(got_state && got_hand)) {
-        if (proto_recv(conn, &op, buf, sizeof(buf), &plen) != 0) return -1;
-
-        if (op == OP_STATE && plen == sizeof(state_t)) {
-            memcpy(st, buf, sizeof(state_t));
-            got_state = 1;
-        } else if (op == OP_HAND && plen == sizeof(hand_t)) {
-            memcpy(hand, buf, sizeof(hand_t));
-            got_hand = 1;
-        } else if (op == OP_LOGIN_RESP || op == OP_RESUME_RESP) {
-            // consume
+/*
+ * App mode: one poll() over stdin and the (non-blocking) TLS socket. Keys
+ * are sent as soon as they are pressed and server messages are drawn as soon
+ * as they arrive, so a slow reply never freezes the UI. A broken connection
+ * is retried with backoff and the game continues with OP_RESUME_REQ.
+ * Card plays are predicted locally (common/predict.c) when the server
+ * supports CAP_PLAY_SEQ, so they show before the round trip. On protocol v2
+ * every request carries a seq and its last answer is flagged, so the reply
+ * time is measured per action even with several actions in flight. The AI's
+ * turn is drawn card by card as the server streams it (CAP_AI_STREAM).
+ */
+
+#define APP_BUF         4096
+#define APP_PING_MS     2000   // heartbeat while nothing else is sent
+#define APP_TIMEOUT_MS  3000   // connect + handshake, and an unanswered ping
+#define APP_BACKOFF_MIN 250
+#define APP_BACKOFF_MAX 5000
+#define APP_INFLIGHT    32     // v2 actions tracked for the reply time
+#define APP_CAPS        (CAP_EVENT_LOG | CAP_PLAY_SEQ | CAP_AI_STREAM)
+
+enum { LINK_DOWN, LINK_CONNECT, LINK_TLS, LINK_UP };
+
+typedef struct {
+    SSL_CTX *ctx;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+
+    int fd;
+    SSL *ssl;
+    int link;
+    short want;                // poll events for fd
+
+    uint8_t in[APP_BUF];
+    uint32_t in_len;
+    uint8_t out[APP_BUF];
+    uint32_t out_len, out_off;
+
+    uint16_t ver;              // framing: PROTO_V1 until RESUME_RESP picks one
+    uint32_t req_seq;          // v2 seq of the last request sent
+    struct { uint32_t seq; long long t; } sent[APP_INFLIGHT]; // v2 actions awaiting PKT_F_LAST
+    int nsent;
+
+    uint64_t sid;              // 0 until the server announces one
+    uint32_t server_caps;      // from OP_RESUME_RESP
+    int predict;               // 0: --no-predict
+    uint8_t tier;              // ai_tier_t asked for at login (--tier)
+    long long retry_at;        // LINK_DOWN: next connect attempt
+    int backoff_ms;
+    int attempts;
+    long long last_tx;         // for the heartbeat
+    long long last_rx;         // link start, or the last bytes received
+    long long t_key;           // last action sent, 0 once answered
+    double reply_ms;           // key -> first STATE of the last action, <0 none yet
+
+    predict_t pred;            // pred.st / pred.hand is what is drawn
+    int has_state;
+    char status[96];
+} app_t;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int resolve(app_t *a, const char *host, uint16_t port) {
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family = AF_UNSPEC;
+    char portstr[16];
+    snprintf(portstr, sizeof(portstr), "%u", (unsigned)port);
+    if (getaddrinfo(host, portstr, &hints, &res) != 0 || !res) return -1;
+    memcpy(&a->addr, res->ai_addr, res->ai_addrlen);
+    a->addrlen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static void link_down(app_t *a, const char *why) {
+    if (a->ssl) SSL_free(a->ssl);
+    if (a->fd >= 0) close(a->fd);
+    a->ssl = NULL;
+    a->fd = -1;
+    a->link = LINK_DOWN;
+    a->in_len = a->out_len = a->out_off = 0;
+    a->t_key = 0;
+    a->ver = PROTO_V1;
+    a->nsent = 0;
+    pred_drop_pending(&a->pred);
+    a->retry_at = now_ms() + a->backoff_ms;
+    snprintf(a->status, sizeof(a->status), "%s - reconnecting in %.1fs", why, a->backoff_ms / 1000.0);
+    a->backoff_ms *= 2;
+    if (a->backoff_ms > APP_BACKOFF_MAX) a->backoff_ms = APP_BACKOFF_MAX;
+}
+
+static void link_start(app_t *a) {
+    a->attempts++;
+    a->fd = socket(a->addr.ss_family, SOCK_STREAM, 0);
+    if (a->fd < 0) { link_down(a, "socket failed"); return; }
+    fcntl(a->fd, F_SETFL, fcntl(a->fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(a->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(a->fd, (struct sockaddr*)&a->addr, a->addrlen) != 0 && errno != EINPROGRESS) {
+        link_down(a, "connect failed");
+        return;
+    }
+    a->link = LINK_CONNECT;
+    a->want = POLLOUT;
+    a->last_rx = now_ms();
+    snprintf(a->status, sizeof(a->status), "connecting (attempt %d)", a->attempts);
+}
+
+// Appends one packet to the send buffer; it goes out on the next flush
+static int app_send(app_t *a, uint16_t op, const void *payload, uint32_t plen) {
+    if (a->link != LINK_UP && op != OP_LOGIN_REQ && op != OP_RESUME_REQ) return -1;
+    int n = proto_encode_ver(a->ver, a->out + a->out_len, APP_BUF - a->out_len,
+                             op, ++a->req_seq, 0, payload, plen);
+    if (n < 0) return -1;
+    a->out_len += (uint32_t)n;
+    a->last_tx = now_ms();
+    return 0;
+}
+
+// A key's request was queued: start its reply clock
+static void on_sent(app_t *a) {
+    if (a->ver < PROTO_V2) { a->t_key = now_ms(); return; } // v1: until the next STATE
+    if (a->nsent == APP_INFLIGHT) {
+        memmove(a->sent, a->sent + 1, (APP_INFLIGHT - 1) * sizeof(a->sent[0]));
+        a->nsent--;
+    }
+    a->sent[a->nsent].seq = a->req_seq;
+    a->sent[a->nsent].t = now_ms();
+    a->nsent++;
+}
+
+// v2: the last answer to request seq arrived
+static void on_done(app_t *a, uint32_t seq) {
+    for (int i = 0; i < a->nsent; i++) {
+        if (a->sent[i].seq != seq) continue;
+        a->reply_ms = (double)(now_ms() - a->sent[i].t);
+        memmove(a->sent + i, a->sent + i + 1, (size_t)(a->nsent - i - 1) * sizeof(a->sent[0]));
+        a->nsent--;
+        return;
+    }
+}
+
+// 1 would block (a->want updated), 0 fatal
+static int ssl_want(app_t *a, int r) {
+    int err = SSL_get_error(a->ssl, r);
+    if (err == SSL_ERROR_WANT_READ) { a->want = POLLIN; return 1; }
+    if (err == SSL_ERROR_WANT_WRITE) { a->want = POLLOUT; return 1; }
+    ERR_clear_error();
+    return 0;
+}
+
+static void on_packet(app_t *a, uint16_t op, const uint8_t *p, uint32_t plen) {
+    state_t st;
+    evlog_t log;
+    if (op == OP_STATE && state_decode(p, plen, &st, &log) == 0) {
+        pred_state(&a->pred, &st, &log);
+        // the AI turn's STATEs come without a HAND: shown as they are
+        if (st.turn == 1 && a->pred.npending == 0) {
+            a->pred.st = st;
+            a->pred.log = log;
+        }
+        if (a->t_key) {
+            a->reply_ms = (double)(now_ms() - a->t_key);
+            a->t_key = 0;
+        }
+    } else if (op == OP_HAND && plen == sizeof(hand_t)) {
+        hand_t hand;
+        memcpy(&hand, p, sizeof(hand_t));
+        if (hand.n > 8) hand.n = 8;
+        pred_hand(&a->pred, &hand);
+        a->has_state = a->pred.has_base;
+    } else if (op == OP_AI_PLAY && plen == sizeof(ai_play_t)) {
+        // drawn now; the turn's final STATE replaces it
+        ai_play_t ap;
+        memcpy(&ap, p, sizeof(ap));
+        state_t *v = &a->pred.st;
+        v->p_hp = ap.p_hp;
+        v->ai_hp = ap.ai_hp;
+        v->p_shield = ap.p_shield;
+        v->ai_shield = ap.ai_shield;
+        v->mana = ap.ev.mana;
+        evlog_push(&a->pred.log, ap.ev.kind, ap.ev.actor, ap.ev.card_id, ap.ev.amount, ap.ev.mana);
+    } else if (op == OP_PLAY_ACK && plen == sizeof(play_ack_t)) {
+        play_ack_t ack;
+        memcpy(&ack, p, sizeof(ack));
+        pred_ack(&a->pred, &ack);
+    } else if (op == OP_RESUME_RESP && plen >= offsetof(resume_resp_t, caps)) {
+        resume_resp_t rr;
+        memset(&rr, 0, sizeof(rr));
+        memcpy(&rr, p, plen < sizeof(rr) ? plen : sizeof(rr)); // caps, version: 0 from an older server
+        a->server_caps = rr.caps;
+        if (rr.ok) {
+            // a login announces its session this way too
+            a->sid = rr.session_id;
+            // from the next packet on
+            a->ver = (rr.version >= PROTO_V2 && rr.version <= PROTO_VERSION) ? rr.version : PROTO_V1;
+            snprintf(a->status, sizeof(a->status), "online (session %llu, protocol v%u)",
+                     (unsigned long long)a->sid, a->ver);
         } else {
-            // ignore
+            // expired or unknown: start a new game on the same connection
+            a->sid = 0;
+            a->has_state = 0;
+            login_req_t lr = { .caps = APP_CAPS, .version = PROTO_VERSION, .tier = a->tier };
+            app_send(a, OP_LOGIN_REQ, &lr, sizeof(lr));
+            snprintf(a->status, sizeof(a->status), "session expired - new game");
         }
+    } else if (op == OP_ERROR) {
+        snprintf(a->status, sizeof(a->status), "server rejected the last action");
+        a->t_key = 0;
     }
-    return 0;
 }
 
-static void draw_ui(const state_t *st, const hand_t *hand) {
+// Moves the link forward as far as it goes without blocking.
+// Returns 1 if anything visible changed.
+static int link_step(app_t *a) {
+    int changed = 0;
+
+    if (a->link == LINK_CONNECT) {
+        int err = 0;
+        socklen_t el = sizeof(err);
+        if (getsockopt(a->fd, SOL_SOCKET, SO_ERROR, &err, &el) != 0 || err != 0) {
+            link_down(a, "connect failed");
+            return 1;
+        }
+        a->ssl = SSL_new(a->ctx);
+        if (!a->ssl) { link_down(a, "TLS setup failed"); return 1; }
+        SSL_set_fd(a->ssl, a->fd);
+        SSL_set_connect_state(a->ssl);
+        a->link = LINK_TLS;
+    }
+
+    if (a->link == LINK_TLS) {
+        int r = SSL_do_handshake(a->ssl);
+        if (r != 1) {
+            if (!ssl_want(a, r)) { link_down(a, "TLS handshake failed"); return 1; }
+            return changed;
+        }
+        a->link = LINK_UP;
+        a->backoff_ms = APP_BACKOFF_MIN;
+        if (a->sid) {
+            resume_req_t rr = { .session_id = a->sid, .caps = APP_CAPS,
+                                .version = PROTO_VERSION };
+            app_send(a, OP_RESUME_REQ, &rr, sizeof(rr));
+            snprintf(a->status, sizeof(a->status), "resuming session %llu", (unsigned long long)a->sid);
+        } else {
+            login_req_t lr = { .caps = APP_CAPS, .version = PROTO_VERSION, .tier = a->tier };
+            app_send(a, OP_LOGIN_REQ, &lr, sizeof(lr));
+            snprintf(a->status, sizeof(a->status), "logging in");
+        }
+        changed = 1;
+    }
+
+    if (a->link != LINK_UP) return changed;
+
+    while (a->out_off < a->out_len) {
+        int w = SSL_write(a->ssl, a->out + a->out_off, (int)(a->out_len - a->out_off));
+        if (w <= 0) {
+            if (!ssl_want(a, w)) { link_down(a, "connection lost"); return 1; }
+            return changed;
+        }
+        a->out_off += (uint32_t)w;
+    }
+    a->out_off = a->out_len = 0;
+    a->want = POLLIN;
+
+    for (;;) {
+        int r = SSL_read(a->ssl, a->in + a->in_len, (int)(APP_BUF - a->in_len));
+        if (r <= 0) {
+            if (!ssl_want(a, r)) { link_down(a, "connection lost"); return 1; }
+            break;
+        }
+        a->in_len += (uint32_t)r;
+        a->last_rx = now_ms();
+
+        uint32_t off = 0;
+        for (;;) {
+            proto_frame_t f;
+            int n = proto_decode_ver(a->ver, a->in + off, a->in_len - off, &f);
+            if (n < 0) { link_down(a, "bad packet"); return 1; }
+            if (n == 0) break;
+            on_packet(a, f.opcode, f.payload, f.plen);
+            if (f.flags & PKT_F_LAST) on_done(a, f.seq);
+            off += (uint32_t)n;
+            changed = 1;
+        }
+        memmove(a->in, a->in + off, a->in_len - off);
+        a->in_len -= off;
+    }
+
+    // on_packet may have queued a LOGIN
+    if (a->out_len > 0) a->want = POLLIN | POLLOUT;
+    return changed;
+}
+
+static void draw_ui(const app_t *a) {
+    const state_t *st = &a->pred.st;
+    const hand_t *hand = &a->pred.hand;
     erase();
     mvprintw(1, 2, "Mini TCG (Client App)  |  Keys: 1/2/3=Play  E=End Turn  Q=Quit");
-    mvprintw(3, 2, "Player HP: %d", st->p_hp);
-    mvprintw(4, 2, "AI     HP: %d", st->ai_hp);
 
-    mvprintw(6, 2, "Turn: %s", (st->turn == 0) ? "PLAYER" : "AI");
-    mvprintw(7, 2, "Game Over: %s", st->game_over ? "YES" : "NO");
+    if (!a->has_state) {
+        mvprintw(3, 2, "Waiting for the server...");
+    } else {
+        mvprintw(3, 2, "Player HP: %d", st->p_hp);
+        mvprintw(4, 2, "AI     HP: %d", st->ai_hp);
 
-    if (st->game_over) {
-        const char *w = "NONE";
-        if (st->winner == 1) w = "PLAYER";
-        else if (st->winner == 2) w = "AI";
-        mvprintw(8, 2, "Winner: %s", w);
-    }
+        mvprintw(6, 2, "Turn: %s", (st->turn == 0) ? "PLAYER" : "AI");
+        mvprintw(7, 2, "Game Over: %s", st->game_over ? "YES" : "NO");
 
-    mvprintw(10, 2, "Hand:");
-    int n = (hand->n > 8) ? 8 : hand->n;
-    for (int i = 0; i < n; i++) {
-        uint16_t cid = hand->card_ids[i];
-        const card_def_t *def = get_card_def(cid);
-        if (def) {
-            mvprintw(11 + i, 4, "%d) %s (Cost %u, Val %d)", i + 1, def->name, def->cost, def->value);
-        } else {
-            mvprintw(11 + i, 4, "%d) Unknown Card %u", i + 1, cid);
+        if (st->game_over) {
+            const char *w = "NONE";
+            if (st->winner == 1) w = "PLAYER";
+            else if (st->winner == 2) w = "AI";
+            mvprintw(8, 2, "Winner: %s", w);
+        }
+
+        mvprintw(10, 2, "Hand:");
+        int n = (hand->n > 8) ? 8 : hand->n;
+        for (int i = 0; i < n; i++) {
+            uint16_t cid = hand->card_ids[i];
+            const card_def_t *def = get_card_def(cid);
+            if (def) {
+                mvprintw(11 + i, 4, "%d) %s (Cost %u, Val %d)", i + 1, def->name, def->cost, def->value);
+            } else {
+                mvprintw(11 + i, 4, "%d) Unknown Card %u", i + 1, cid);
+            }
+        }
+
+        // events are only turned into text here, when drawn
+        mvprintw(3, 40, "Log:");
+        for (int i = 0; i < LOG_LINES; i++) {
+            char line[LOG_LEN];
+            evlog_format(evlog_at(&a->pred.log, i), line, sizeof(line));
+            mvprintw(4 + i, 42, "%s", line[0] ? line : "-");
         }
     }
 
     mvprintw(20, 2, "Action: ");
+    mvprintw(22, 2, "Link: %s", a->status);
+    if (a->reply_ms >= 0) mvprintw(23, 2, "Last reply: %.0f ms", a->reply_ms);
+    if (a->nsent > 0) mvprintw(23, 30, "Actions in flight: %d", a->nsent);
+    if (a->pred.predicted > 0)
+        mvprintw(24, 2, "Predicted plays: %llu  confirmed %llu  rollbacks %llu  in flight %d",
+                 (unsigned long long)a->pred.predicted, (unsigned long long)a->pred.confirmed,
+                 (unsigned long long)a->pred.rollbacks, a->pred.npending);
+    move(20, 10);
     refresh();
 }
 
-int run_app_mode(const char *host, uint16_t port) {
-    SSL_CTX *ctx = ssl_init_client_ctx();
-    if (!ctx) return 1;
+// 1 quit, 0 keep going
+static int on_key(app_t *a, int ch) {
+    if (ch == 'q' || ch == 'Q') return 1;
+    if (!a->has_state || a->pred.st.game_over) return 0; // keep showing final state; allow quit
+    if (a->link != LINK_UP) return 0;
 
-    int fd = tcp_connect(host, port);
-    if (fd < 0) {
-        perror("tcp_connect");
-        SSL_CTX_free(ctx);
-        return 1;
-    }
-    
-    net_set_timeout(fd, 3);
-
-    /* han edit tls */
-    net_init_ssl();
-    SSL_CTX *ctx = net_create_context(0);
-    SSL *ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, fd);
-    if (SSL_connect(ssl) <= 0) {
-        ERR_print_errors_fp(stderr);
-        SSL_free(ssl);
-        SSL_CTX_free(ctx);
-        close(fd);
-        return 1;
-    }
-    /* han edit tls end */
-
-    // SSL Handshake
-    SSL *ssl = SSL_new(ctx);
-    SSL_set_fd(ssl, fd);
-    if (SSL_connect(ssl) <= 0) {
-        ERR_print_errors_fp(stderr);
-        SSL_free(ssl);
-        close(fd);
-        SSL_CTX_free(ctx);
-        return 1;
+    if (ch == 'e' || ch == 'E') {
+        if (app_send(a, OP_END_TURN, NULL, 0) == 0) on_sent(a);
+    } else if (ch == '1' || ch == '2' || ch == '3') {
+        int idx = ch - '1';
+        if (idx >= (int)a->pred.hand.n) return 0;
+        if (a->predict && (a->server_caps & CAP_PLAY_SEQ)) {
+            // shown now; the server's answer confirms or corrects it
+            play_seq_req_t pc = { .hand_idx = (uint8_t)idx };
+            int rc = pred_play(&a->pred, (uint8_t)idx, &pc.seq);
+            if (rc != 0) {
+                snprintf(a->status, sizeof(a->status), "%s",
+                         rc == -2 ? "not enough mana" : rc == -1 ? "too many plays in flight" : "invalid card");
+                return 0;
+            }
+            if (app_send(a, OP_PLAY_CARD, &pc, sizeof(pc)) == 0) on_sent(a);
+        } else {
+            play_req_t pc = { .hand_idx = (uint8_t)idx };
+            if (app_send(a, OP_PLAY_CARD, &pc, sizeof(pc)) == 0) on_sent(a);
+        }
     }
+    return 0;
+}
 
-    connection_t conn;
-    conn_init(&conn, fd, ssl);
-
-    // login
-    if (proto_send(&conn, OP_LOGIN_REQ, NULL, 0) != 0) {
-        conn_close(&conn);
-        SSL_CTX_free(ctx);
-        return 1;
-    }
+int run_app_mode(const char *host, uint16_t port, int predict, int tier) {
+    static app_t app;
+    app_t *a = &app;
+    memset(a, 0, sizeof(*a));
+    a->fd = -1;
+    a->backoff_ms = APP_BACKOFF_MIN;
+    a->reply_ms = -1;
+    a->predict = predict;
+    a->tier = (uint8_t)tier;
+    pred_init(&a->pred);
+    a->ver = PROTO_V1;
 
-    state_t st;
-    hand_t hand;
-    memset(&st, 0, sizeof(st));
-    memset(&hand, 0, sizeof(hand));
-
-    // Receive initial STATE + HAND (consumes login resp implicitly via loop)
-    if (recv_until(&conn, &st, &hand) != 0) {
-        conn_close(&conn);
-        SSL_CTX_free(ctx);
+    signal(SIGPIPE, SIG_IGN); // a dead link shows up as a write error and is retried
+    a->ctx = ssl_init_client_ctx();
+    if (!a->ctx) return 1;
+    if (resolve(a, host, port) != 0) {
+        fprintf(stderr, "cannot resolve %s\n", host);
+        SSL_CTX_free(a->ctx);
         return 1;
     }
-    /* han edit tls end */
 
     // ncurses init
     initscr();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
-    timeout(200);
+    nodelay(stdscr, TRUE);
 
-    while (1) {
-        draw_ui(&st, &hand);
+    link_start(a);
+    int quit = 0, dirty = 1;
+    while (!quit) {
+        if (dirty) { draw_ui(a); dirty = 0; }
 
-        int ch = getch();
-        if (ch == 'q' || ch == 'Q') break;
+        long long now = now_ms();
+        long long wait = 1000;
+        if (a->link == LINK_DOWN) wait = a->retry_at - now;
+        else if (a->link == LINK_UP && a->last_tx + APP_PING_MS - now < wait) wait = a->last_tx + APP_PING_MS - now;
+        if (wait < 0) wait = 0;
+        if (wait > 1000) wait = 1000;
 
-        if (st.game_over) {
-            // keep showing final state; allow quit
-            continue;
-        }
+        struct pollfd pf[2] = {
+            { .fd = STDIN_FILENO, .events = POLLIN },
+            { .fd = a->fd, .events = a->want },
+        };
+        int np = (a->fd >= 0) ? 2 : 1;
+        if (poll(pf, (nfds_t)np, (int)wait) < 0 && errno != EINTR) break;
 
-        if (ch == 'e' || ch == 'E') {
-            if (proto_send(&conn, OP_END_TURN, NULL, 0) != 0) break;
-            if (recv_until(&conn, &st, &hand) != 0) break;
-            continue;
+        if (pf[0].revents & POLLIN) {
+            int ch;
+            while ((ch = getch()) != ERR) {
+                if (on_key(a, ch)) { quit = 1; break; }
+                if (ch == KEY_RESIZE) dirty = 1;
+            }
+            // flush what the keys queued right away
+            if (a->link == LINK_UP && a->out_len > 0 && link_step(a)) dirty = 1;
+        }
+        if (np == 2 && pf[1].revents) {
+            if (link_step(a)) dirty = 1;
         }
 
-        if (ch == '1' || ch == '2' || ch == '3') {
-            int idx = ch - '1';
-            if (idx < 0 || idx >= (int)hand.n) continue;
-
-            play_req_t pc;
-            pc.hand_idx = (uint8_t)idx;
-
-            if (proto_send(&conn, OP_PLAY_CARD, &pc, sizeof(pc)) != 0) break;
-            if (recv_until(&conn, &st, &hand) != 0) break;
-            continue;
+        now = now_ms();
+        if (a->link == LINK_DOWN && now >= a->retry_at) {
+            link_start(a);
+            dirty = 1;
+        } else if (a->link != LINK_DOWN &&
+                   now - a->last_rx > (a->link == LINK_UP ? APP_PING_MS + APP_TIMEOUT_MS : APP_TIMEOUT_MS)) {
+            // SO_RCVTIMEO no longer applies: the socket never blocks
+            link_down(a, "server not responding");
+            dirty = 1;
+        } else if (a->link == LINK_UP && now - a->last_tx >= APP_PING_MS) {
+            app_send(a, OP_PING, NULL, 0);
+            if (link_step(a)) dirty = 1;
         }
     }
 
     endwin();
-    conn_close(&conn);
-    SSL_CTX_free(ctx);
+    if (a->ssl) {
+        SSL_shutdown(a->ssl);
+        SSL_free(a->ssl);
+    }
+    if (a->fd >= 0) close(a->fd);
+    SSL_CTX_free(a->ctx);
     return 0;
 }
@@ -2,6 +2,10 @@
 #include "common/net.h"
 #include "common/proto.h"
 #include "common/cards.h"
+#include "common/evlog.h"
+#include "common/chan.h"
+#include "common/hist.h"
+#include "common/predict.h"
 
 #include <pthread.h>
 #include <string.h>
@@ -9,7 +13,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/time.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <time.h>
 #include <openssl/ssl.h>
 
@@ -81,7 +85,13 @@ typedef struct {
 } float_text_t;
 
 static anim_t g_anim = {0};
-static float_text_t g_float = {0};
+static float_text_t g_float = {0}; // render thread only, started from shared_t.fl
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
 
 static Vector2 v2_lerp(Vector2 a, Vector2 b, float t) {
     return (Vector2){ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t };
@@ -89,42 +99,88 @@ static Vector2 v2_lerp(Vector2 a, Vector2 b, float t) {
 
 typedef struct {
     state_t st;
+    evlog_t log;
     hand_t  hand;
     int has_state;
     int has_hand;
     int connected;
     int game_over;
+    uint32_t float_seq;  // bumped for each new damage number
+    float_text_t fl;
 } shared_t;
 
-static pthread_mutex_t g_mu = PTHREAD_MUTEX_INITIALIZER;
+// Net thread -> renderer: the net thread owns g_net and publishes a copy
+// through the seqlock; the renderer copies g_sh out without ever waiting.
+static seqlock_t g_sh_lock = SEQLOCK_INIT;
 static shared_t g_sh;
+static shared_t g_net;
+
+static void publish(void) {
+    seqlock_write(&g_sh_lock, &g_sh, &g_net, sizeof(g_net));
+}
 
-// ---------- CMD PIPE ----------
+// ---------- CMD RING ----------
 typedef struct {
     uint16_t op;
     play_req_t play_payload; // only payload we send currently (besides empty)
 } net_cmd_t;
 
+// Renderer -> net thread
+static spsc_t g_cmd;
+
 typedef struct {
     const char *host;
     uint16_t port;
-    int pipe_fd; // read end
     SSL_CTX *ctx;
 } net_arg_t;
 
 static uint64_t g_session_id = 0; // stored session id
+static uint32_t g_server_caps = 0; // from OP_RESUME_RESP
+static predict_t g_pred;           // net thread: server state + predicted plays
+
+// Puts the prediction view into g_net and publishes it
+static void show_view(void) {
+    const state_t *st = &g_pred.st;
+    state_t prev = g_net.st; 
+
+    g_net.st = *st;
+    g_net.log = g_pred.log;
+    g_net.hand = g_pred.hand;
+    g_net.has_state = 1;
+    g_net.has_hand = 1;
+    g_net.game_over = st->game_over;
+
+    // Float dmg calc
+    if (prev.max_mana != 0) { 
+        int dmg_to_ai = (int)prev.ai_hp - (int)st->ai_hp;
+        int dmg_to_p  = (int)prev.p_hp  - (int)st->p_hp;
+
+        if (dmg_to_ai > 0) {
+            g_net.float_seq++;
+            g_net.fl.dur = 0.60f;
+            g_net.fl.pos = (Vector2){ 690, 120 }; 
+            snprintf(g_net.fl.text, sizeof(g_net.fl.text), "-%d", dmg_to_ai);
+        } else if (dmg_to_p > 0) {
+            g_net.float_seq++;
+            g_net.fl.dur = 0.60f;
+            g_net.fl.pos = (Vector2){ 120, 120 }; 
+            snprintf(g_net.fl.text, sizeof(g_net.fl.text), "-%d", dmg_to_p);
+        }
+    }
+    publish();
+}
 
 static void* net_thread(void *p) {
     net_arg_t *a = (net_arg_t*)p;
+    pred_init(&g_pred);
     
     while (1) {
         // 1. Connect
         printf("[Net] Connecting to %s:%u...\n", a->host, a->port);
         int fd = tcp_connect(a->host, a->port);
         if (fd < 0) {
-            pthread_mutex_lock(&g_mu);
-            g_sh.connected = 0;
-            pthread_mutex_unlock(&g_mu);
+            g_net.connected = 0;
+            publish();
             sleep(2); // retry delay
             continue;
         }
@@ -149,21 +205,24 @@ static void* net_thread(void *p) {
         // 2. Login or Resume
         if (g_session_id != 0) {
              printf("[Net] Trying Resume (SID=%lu)...\n", g_session_id);
-             resume_req_t rr = { .session_id = g_session_id };
+             resume_req_t rr = { .session_id = g_session_id, .caps = CAP_EVENT_LOG | CAP_PLAY_SEQ };
              if (proto_send(&conn, OP_RESUME_REQ, &rr, sizeof(rr)) != 0) {
                  conn_close(&conn); continue; 
              }
         } else {
              printf("[Net] Sending Login...\n");
-             if (proto_send(&conn, OP_LOGIN_REQ, NULL, 0) != 0) {
+             login_req_t lr = { .caps = CAP_EVENT_LOG | CAP_PLAY_SEQ };
+             if (proto_send(&conn, OP_LOGIN_REQ, &lr, sizeof(lr)) != 0) {
                  conn_close(&conn); continue;
              }
         }
 
-        // 3. Receive Loop (Select on FD and Pipe)
+        // 3. Receive Loop (poll on FD and command ring)
         state_t st;
+        evlog_t log;
         hand_t hand;
         uint8_t buf[4096];
+        g_net.connected = 1;
         uint16_t op;
         uint32_t plen;
         
@@ -176,25 +235,28 @@ static void* net_thread(void *p) {
                 last_ping = now;
             }
 
-            int pfd = a->pipe_fd;
-            int maxfd = (fd > pfd) ? fd : pfd;
-            fd_set rfd;
-            FD_ZERO(&rfd);
-            FD_SET(fd, &rfd);
-            FD_SET(pfd, &rfd);
-            
-            struct timeval tv = {1, 0}; 
-            int sret = select(maxfd + 1, &rfd, NULL, NULL, &tv);
-            if (sret < 0) break; 
-            if (sret == 0) continue; // timeout (check ping)
-            
-            // PIPE READ (Command from Main Thread)
-            if (FD_ISSET(pfd, &rfd)) {
+            struct pollfd pf[2] = {
+                { .fd = fd, .events = POLLIN },
+                { .fd = spsc_fd(&g_cmd), .events = POLLIN },
+            };
+            // records already decrypted by OpenSSL never show up on the fd
+            int pret = SSL_pending(ssl) > 0 ? 1 : poll(pf, 2, 1000);
+            if (pret < 0) break;
+            if (pret == 0) continue; // timeout (check ping)
+
+            // COMMANDS (from the render thread)
+            if (pf[1].revents & POLLIN) {
+                spsc_ack(&g_cmd);
                 net_cmd_t cmd;
-                ssize_t n = read(pfd, &cmd, sizeof(cmd));
-                if (n == sizeof(cmd)) {
+                while (spsc_pop(&g_cmd, &cmd) == 0) {
                     // Execute Send
-                    if (cmd.op == OP_PLAY_CARD) {
+                    if (cmd.op == OP_PLAY_CARD && (g_server_caps & CAP_PLAY_SEQ)) {
+                        // shown before the round trip; the ack confirms or corrects it
+                        play_seq_req_t pr = { .hand_idx = cmd.play_payload.hand_idx };
+                        if (pred_play(&g_pred, pr.hand_idx, &pr.seq) != 0) continue;
+                        show_view();
+                        proto_send(&conn, OP_PLAY_CARD, &pr, sizeof(pr));
+                    } else if (cmd.op == OP_PLAY_CARD) {
                         proto_send(&conn, OP_PLAY_CARD, &cmd.play_payload, sizeof(cmd.play_payload));
                     } else if (cmd.op == OP_END_TURN) {
                         proto_send(&conn, OP_END_TURN, NULL, 0);
@@ -203,14 +265,15 @@ static void* net_thread(void *p) {
             }
 
             // SOCKET READ
-            if (FD_ISSET(fd, &rfd)) {
+            if ((pf[0].revents & (POLLIN | POLLHUP | POLLERR)) || SSL_pending(ssl) > 0) {
                 if (proto_recv(&conn, &op, buf, sizeof(buf), &plen) != 0) break;
 
                 if (op == OP_PONG) continue;
                 
                 if (op == OP_RESUME_RESP) {
-                    if (plen >= sizeof(resume_resp_t)) {
+                    if (plen >= offsetof(resume_resp_t, caps)) {
                         resume_resp_t *rr = (resume_resp_t*)buf;
+                        g_server_caps = (plen >= offsetof(resume_resp_t, version)) ? rr->caps : 0;
                         if (rr->ok) {
                             g_session_id = rr->session_id;
                             printf("[Net] Session Active: %lu\n", g_session_id);
@@ -225,45 +288,26 @@ static void* net_thread(void *p) {
                 
                 if (op == OP_LOGIN_RESP) continue;
 
-                if (op == OP_STATE && plen == sizeof(state_t)) {
-                    memcpy(&st, buf, sizeof(state_t));
-                    pthread_mutex_lock(&g_mu);
-                    state_t prev = g_sh.st; 
-                    
-                    g_sh.st = st;
-                    g_sh.has_state = 1;
-                    g_sh.connected = 1; 
-                    g_sh.game_over = st.game_over;
-
-                    // Float dmg calc
-                    if (prev.max_mana != 0) { 
-                        int dmg_to_ai = (int)prev.ai_hp - (int)st.ai_hp;
-                        int dmg_to_p  = (int)prev.p_hp  - (int)st.p_hp;
-
-                        if (dmg_to_ai > 0) {
-                            g_float.active = 1;
-                            g_float.t = 0.0f;
-                            g_float.dur = 0.60f;
-                            g_float.pos = (Vector2){ 690, 120 }; 
-                            snprintf(g_float.text, sizeof(g_float.text), "-%d", dmg_to_ai);
-                        } else if (dmg_to_p > 0) {
-                            g_float.active = 1;
-                            g_float.t = 0.0f;
-                            g_float.dur = 0.60f;
-                            g_float.pos = (Vector2){ 120, 120 }; 
-                            snprintf(g_float.text, sizeof(g_float.text), "-%d", dmg_to_p);
-                        }
-                    }
-                    pthread_mutex_unlock(&g_mu);
+                if (op == OP_PLAY_ACK && plen == sizeof(play_ack_t)) {
+                    play_ack_t ack;
+                    memcpy(&ack, buf, sizeof(ack));
+                    uint64_t rb = g_pred.rollbacks;
+                    pred_ack(&g_pred, &ack);
+                    if (g_pred.rollbacks != rb) show_view();
+                    continue;
+                }
+
+                // STATE is always followed by HAND: the view is rebuilt on HAND
+                if (op == OP_STATE && state_decode(buf, plen, &st, &log) == 0) {
+                    pred_state(&g_pred, &st, &log);
                     continue;
                 }
                 
                 if (op == OP_HAND && plen == sizeof(hand_t)) {
                     memcpy(&hand, buf, sizeof(hand_t));
-                    pthread_mutex_lock(&g_mu);
-                    g_sh.hand = hand;
-                    g_sh.has_hand = 1;
-                    pthread_mutex_unlock(&g_mu);
+                    if (hand.n > 8) hand.n = 8;
+                    pred_hand(&g_pred, &hand);
+                    if (g_pred.has_base) show_view();
                     continue;
                 }
             }
@@ -273,9 +317,10 @@ static void* net_thread(void *p) {
         printf("[Net] Disconnected.\n");
         conn_close(&conn);
         
-        pthread_mutex_lock(&g_mu);
-        g_sh.connected = 0;
-        pthread_mutex_unlock(&g_mu);
+        pred_drop_pending(&g_pred);
+        g_net.connected = 0;
+        if (g_pred.has_base) show_view();
+        else publish();
         
         sleep(1); 
     }
@@ -388,27 +433,256 @@ static void DrawCardVertical(Texture2D art, Rectangle cardRect,
     }
 }
 
+// ---------- layout ----------
+static const int W = 900, H = 600;
+static const int SZ_HUD = 20;
+static const int SZ_LOG = 16;
+static const int P_X = 40;
+static const int AI_X = 540;
+static const int HP_Y = 80;
+static const int BAR_W = 320;
+
+static const Rectangle cardRect[3] = {
+    { 180,       360, 160, 220 },
+    { 180 + 190, 360, 160, 220 },
+    { 180 + 380, 360, 160, 220 }
+};
+static const Rectangle endBtn = { 900 - 140, 20, 120, 40 };
+
+static int hand_count(const shared_t *sh) {
+    return sh->has_hand ? (sh->hand.n > 3 ? 3 : sh->hand.n) : 0;
+}
+
+static int hover_card(const shared_t *sh, Vector2 mouse_p) {
+    if (!sh->has_state || sh->st.turn != 0 || sh->st.game_over) return -1;
+    int n = hand_count(sh);
+    for (int i = 0; i < n; i++)
+        if (CheckCollisionPointRec(mouse_p, cardRect[i])) return i;
+    return -1;
+}
+
+// Everything but the animations; a function of (snapshot, hover, selection) only
+static void draw_scene(const shared_t *sh, int hover_idx, int selected_idx) {
+    ClearBackground((Color){20, 20, 20, 255}); 
+
+    DrawTextEx(g_ui.font, "Mini TCG (raylib SSL)", (Vector2){30, 20}, 32, 2, WHITE);
+
+    if (!sh->connected && !sh->has_state) {
+        DrawTextEx(g_ui.font, "Connecting (SSL)...", (Vector2){30, 80}, 24, 2, RED);
+        return;
+    }
+    if (!sh->has_state) return;
+
+    char buf[256];
+    DrawPanel(P_X - 10, HP_Y - 10, BAR_W + 20, 100); 
+    DrawTextEx(g_ui.font, "PLAYER", (Vector2){P_X, HP_Y}, SZ_HUD, 1, WHITE);
+    DrawHPBar(P_X, HP_Y + 25, BAR_W, 20, sh->st.p_hp, 30, sh->st.p_shield);
+    snprintf(buf, sizeof(buf), "HP %d/%d  SHD %d  Mana %d/%d", 
+        sh->st.p_hp, 30, sh->st.p_shield, sh->st.mana, sh->st.max_mana);
+    DrawTextEx(g_ui.font, buf, (Vector2){P_X, HP_Y + 50}, SZ_HUD, 1, GREEN);
+    if (sh->st.p_buff > 0 || sh->st.p_poison > 0) {
+        snprintf(buf, sizeof(buf), "Buff %d  Psn %u", sh->st.p_buff, (unsigned)sh->st.p_poison);
+        DrawTextEx(g_ui.font, buf, (Vector2){P_X, HP_Y + 74}, SZ_LOG, 1, LIGHTGRAY);
+    }
+
+    DrawPanel(AI_X - 10, HP_Y - 10, BAR_W + 20, 100); 
+    DrawTextEx(g_ui.font, "OPPONENT", (Vector2){AI_X, HP_Y}, SZ_HUD, 1, WHITE);
+    DrawHPBar(AI_X, HP_Y + 25, BAR_W, 20, sh->st.ai_hp, 30, sh->st.ai_shield);
+    snprintf(buf, sizeof(buf), "HP %d/%d  SHD %d  PSN %u", 
+        sh->st.ai_hp, 30, sh->st.ai_shield, (unsigned)sh->st.ai_poison);
+    DrawTextEx(g_ui.font, buf, (Vector2){AI_X, HP_Y + 50}, SZ_HUD, 1, RED);
+    if (sh->st.ai_buff > 0) {
+        snprintf(buf, sizeof(buf), "Buff %d", sh->st.ai_buff);
+        DrawTextEx(g_ui.font, buf, (Vector2){AI_X, HP_Y + 74}, SZ_LOG, 1, LIGHTGRAY);
+    }
+
+    DrawPanel(AI_X - 10, 210, 350, 150);
+    DrawTextEx(g_ui.font, "Battle Log:", (Vector2){AI_X, 215}, SZ_LOG, 1, GRAY);
+    int ly = 235;
+    for (int i = 0; i < LOG_LINES; i++) {
+        char line[LOG_LEN];
+        evlog_format(evlog_at(&sh->log, i), line, sizeof(line));
+        if (line[0] == '\0') strcpy(line, "-");
+        DrawTextEx(g_ui.font, line, (Vector2){AI_X, (float)ly}, SZ_LOG, 1, LIGHTGRAY);
+        ly += 18;
+    }
+
+    Color btnColor = (sh->st.turn == 0) ? SKYBLUE : GRAY;
+    DrawPanel(endBtn.x, endBtn.y, endBtn.width, endBtn.height); 
+    DrawRectangleRec(endBtn, btnColor); 
+    DrawRectangleLinesEx(endBtn, 2, WHITE);
+    DrawTextEx(g_ui.font, "End Turn", (Vector2){endBtn.x + 15, endBtn.y + 10}, SZ_HUD, 1, BLACK);
+
+    int n = hand_count(sh);
+    for (int i = 0; i < 3; i++) {
+        if (i >= n) {
+             DrawPanel((int)cardRect[i].x, (int)cardRect[i].y, (int)cardRect[i].width, (int)cardRect[i].height);
+             continue;
+        }
+        if (i == selected_idx || i == hover_idx) continue;
+
+        Rectangle r = cardRect[i];
+        uint16_t cid = sh->hand.card_ids[i];
+        const card_def_t *def = get_card_def(cid);
+        Texture2D tex = (def) ? tex_for_card(def->type) : (Texture2D){0};
+
+        bool disabled = (sh->st.turn != 0);
+        DrawCardVertical(tex, r, def, disabled, false, false);
+    }
+
+    if (hover_idx >= 0 && hover_idx != selected_idx) {
+        int i = hover_idx;
+        Rectangle base = cardRect[i];
+        float scale = 1.15f;
+        float nw = base.width * scale;
+        float nh = base.height * scale;
+        float nx = base.x - (nw - base.width)*0.5f;
+        float ny = base.y - 40; 
+        Rectangle r = {nx, ny, nw, nh};
+        
+        uint16_t cid = sh->hand.card_ids[i];
+        const card_def_t *def = get_card_def(cid);
+        Texture2D tex = (def) ? tex_for_card(def->type) : (Texture2D){0};
+
+        DrawCardVertical(tex, r, def, false, true, false);
+    }
+
+    if (selected_idx >= 0 && selected_idx < n) {
+        int i = selected_idx;
+        Rectangle base = cardRect[i];
+        float scale = 1.30f;
+        float nw = base.width * scale;
+        float nh = base.height * scale;
+        float nx = base.x - (nw - base.width)*0.5f;
+        float ny = base.y - 80; 
+        Rectangle r = {nx, ny, nw, nh};
+        
+        uint16_t cid = sh->hand.card_ids[i];
+        const card_def_t *def = get_card_def(cid);
+        Texture2D tex = (def) ? tex_for_card(def->type) : (Texture2D){0};
+
+        DrawCardVertical(tex, r, def, false, false, true); 
+        
+        DrawRectangle(r.x, r.y - 40, r.width, 30, (Color){0,0,0,200});
+        DrawTextEx(g_ui.font, "CLICK TO CONFIRM", (Vector2){r.x + 10, r.y - 35}, 16, 1, GREEN);
+
+        if (def) {
+            int px = AI_X + 25; 
+            int py = 75;
+            Rectangle pRect = { px, py, 220, 300 }; 
+            
+            DrawRectangle(px+10, py+10, 220, 300, (Color){0,0,0,120});
+            
+            DrawRectangleRec(pRect, (Color){30, 30, 35, 255});
+            DrawRectangleLinesEx(pRect, 3, GOLD);
+            
+            Rectangle artDst = { px + 10, py + 10, 200, 160 };
+            Rectangle src = SrcCropToFit(tex, artDst.width, artDst.height);
+            DrawTexturePro(tex, src, artDst, (Vector2){0,0}, 0.0f, WHITE);
+            DrawRectangleLinesEx(artDst, 1, BLACK);
+
+            DrawTextEx(g_ui.font, def->name, (Vector2){px+15, py+180}, 24, 1, GOLD);
+            
+            char desc[64];
+            get_card_desc(def, desc, sizeof(desc));
+            DrawTextEx(g_ui.font, desc, (Vector2){px+15, py+215}, 18, 1, WHITE);
+            
+            snprintf(buf, sizeof(buf), "Cost: %u   Val: %d", def->cost, def->value);
+            DrawTextEx(g_ui.font, buf, (Vector2){px+15, py+260}, 18, 1, LIGHTGRAY);
+            
+            DrawTextEx(g_ui.font, "[PREVIEW]", (Vector2){px+15, py+282}, 14, 1, GRAY);
+        }
+    }
+    
+    if (sh->st.turn != 0 && !sh->st.game_over) {
+         const char *aitext = "AI TURN";
+         int w = MeasureText(aitext, 40);
+         DrawRectangle(0, H/2 - 40, W, 80, (Color){0, 0, 0, 200});
+         DrawTextEx(g_ui.font, aitext, (Vector2){(W-w)/2, H/2 - 20}, 40, 2, RED);
+    }
+
+    if (sh->st.game_over) {
+        DrawRectangle(0, 0, W, H, (Color){0, 0, 0, 240}); 
+        snprintf(buf, sizeof(buf), "GAME OVER - WINNER: %s", winner_name(sh->st.winner));
+        DrawTextEx(g_ui.font, buf, (Vector2){250, 270}, 32, 2, GOLD);
+    }
+}
+
+// ---------- frame stats ----------
+#define ACTIVE_FPS    60
+#define IDLE_AFTER_NS 500000000ull // no input/animation/state for this long
+
+// Overlay bars: frame work time in power-of-two bins, <0.125 ms .. >16 ms
+#define FRAME_BINS 9
+
+static int frame_bin(uint64_t ns) {
+    int i = 0;
+    while (i < FRAME_BINS - 1 && ns >= (125000ull << i)) i++;
+    return i;
+}
+
+static void draw_frame_stats(const hist_t *h, const uint64_t *bins, uint64_t redraws, uint64_t frames) {
+    char buf[128];
+    int x = 10, y = H - 150;
+    DrawRectangle(x - 5, y - 5, 290, 145, (Color){0, 0, 0, 200});
+    snprintf(buf, sizeof(buf), "fps %d  work p50 %.2f p99 %.2f ms", GetFPS(),
+             hist_quantile(h, 0.50) / 1e6, hist_quantile(h, 0.99) / 1e6);
+    DrawText(buf, x, y, 10, LIGHTGRAY);
+    snprintf(buf, sizeof(buf), "scene redraws %llu / %llu frames",
+             (unsigned long long)redraws, (unsigned long long)frames);
+    DrawText(buf, x, y + 12, 10, LIGHTGRAY);
+
+    uint64_t top = 1;
+    for (int i = 0; i < FRAME_BINS; i++) if (bins[i] > top) top = bins[i];
+    for (int i = 0; i < FRAME_BINS; i++) {
+        int bh = (int)(80.0 * (double)bins[i] / (double)top);
+        DrawRectangle(x + i * 30, y + 110 - bh, 22, bh, SKYBLUE);
+        int last = (i == FRAME_BINS - 1);
+        snprintf(buf, sizeof(buf), last ? ">%g" : "<%g", (double)(125000ull << (last ? i - 1 : i)) / 1e6);
+        DrawText(buf, x + i * 30, y + 115, 10, GRAY);
+    }
+}
+
+static void print_hist_ms(const char *name, const hist_t *h) {
+    printf("[GUI] %-8s p50=%.2fms p90=%.2fms p99=%.2fms max=%.2fms mean=%.2fms\n", name,
+           hist_quantile(h, 0.50) / 1e6, hist_quantile(h, 0.90) / 1e6,
+           hist_quantile(h, 0.99) / 1e6, h->max / 1e6, hist_mean(h) / 1e6);
+}
+
 int main(int argc, char **argv) {
+    if (cards_init() != 0) return 1;
     const char *host = "127.0.0.1";
     uint16_t port = 9000;
-    if (argc >= 2) host = argv[1];
-    if (argc >= 3) port = (uint16_t)atoi(argv[2]);
+    int idle = 1, idle_fps = 10, show_stats = 0;
+    int npos = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-idle") == 0) idle = 0;
+        else if (strcmp(argv[i], "--idle-fps") == 0 && i + 1 < argc) idle_fps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stats") == 0) show_stats = 1;
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [host] [port] [--no-idle] [--idle-fps N] [--stats]\n", argv[0]);
+            return 2;
+        }
+        else if (npos == 0) { host = argv[i]; npos++; }
+        else if (npos == 1) { port = (uint16_t)atoi(argv[i]); npos++; }
+    }
+    if (idle_fps < 1) idle_fps = 1;
+    if (idle_fps > ACTIVE_FPS) idle_fps = ACTIVE_FPS;
 
     memset(&g_sh, 0, sizeof(g_sh));
+    memset(&g_net, 0, sizeof(g_net));
 
-    // Create Pipe
-    int pfd[2];
-    if (pipe(pfd) < 0) { perror("pipe"); return 1; }
+    // Command ring (render -> net)
+    if (spsc_init(&g_cmd, 64, sizeof(net_cmd_t)) != 0) { perror("spsc_init"); return 1; }
 
     ssl_msg_init();
     SSL_CTX *ctx = ssl_init_client_ctx();
     if (!ctx) return 1;
 
-    net_arg_t na = { .host = host, .port = port, .pipe_fd = pfd[0], .ctx = ctx };
+    net_arg_t na = { .host = host, .port = port, .ctx = ctx };
     pthread_t nt;
     pthread_create(&nt, NULL, net_thread, &na);
 
-    const int W = 900, H = 600;
     InitWindow(W, H, "Mini TCG - GUI Client (SSL Enabled)");
     if (!IsWindowReady()) {
         fprintf(stderr, "ERROR: GUI init failed\n");
@@ -436,186 +710,72 @@ int main(int argc, char **argv) {
     SetTextureFilter(g_ui.tex_buff, TEXTURE_FILTER_POINT);
     SetTextureFilter(g_ui.tex_poison, TEXTURE_FILTER_POINT);
 
-    Rectangle cardRect[3] = {
-        { 180,       360, 160, 220 },
-        { 180 + 190, 360, 160, 220 },
-        { 180 + 380, 360, 160, 220 }
-    };
-    
-    Rectangle endBtn = { 900 - 140, 20, 120, 40 };
     int selected_idx = -1; 
+    uint32_t float_seen = 0;
+
+    // Idle mode: the scene is drawn into a render texture only when the
+    // snapshot, hover or selection changes; other frames just blit it. With
+    // no input, animation or new state for IDLE_AFTER_NS the frame rate drops
+    // to idle_fps.
+    RenderTexture2D scene = LoadRenderTexture(W, H);
+    int scene_ok = 0, scene_hover = -1, scene_sel = -1;
+    uint32_t scene_seq = 0;
+    uint64_t last_active = 0, redraws = 0;
+    int cur_fps = ACTIVE_FPS;
+    if (idle) SetTargetFPS(cur_fps); // --no-idle keeps the old uncapped loop
+
+    // Frame pacing: interval between frame starts, CPU time of a frame (up to
+    // EndDrawing), and the time to get the snapshot
+    hist_t h_frame, h_work, h_snap;
+    hist_init(&h_frame);
+    hist_init(&h_work);
+    hist_init(&h_snap);
+    uint64_t last_frame = 0;
+    uint64_t work_bins[FRAME_BINS] = { 0 };
 
     while (!WindowShouldClose()) {
-        shared_t sh;
-        pthread_mutex_lock(&g_mu);
-        sh = g_sh;
-        pthread_mutex_unlock(&g_mu);
-
-        BeginDrawing();
-        ClearBackground((Color){20, 20, 20, 255}); 
+        uint64_t t0 = now_ns();
+        if (last_frame) hist_add(&h_frame, t0 - last_frame);
+        last_frame = t0;
 
-        DrawTextEx(g_ui.font, "Mini TCG (raylib SSL)", (Vector2){30, 20}, 32, 2, WHITE);
-
-        if (!sh.connected && !sh.has_state) {
-            DrawTextEx(g_ui.font, "Connecting (SSL)...", (Vector2){30, 80}, 24, 2, RED);
-            EndDrawing();
-            continue;
+        shared_t sh;
+        uint32_t seq = seqlock_read(&g_sh_lock, &sh, &g_sh, sizeof(sh));
+        hist_add(&h_snap, now_ns() - t0);
+
+        if (sh.float_seq != float_seen) {
+            float_seen = sh.float_seq;
+            g_float = sh.fl;
+            g_float.active = 1;
+            g_float.t = 0.0f;
         }
 
-        const int SZ_HUD   = 20;
-        const int SZ_LOG   = 16;
-        const int P_X = 40;     
-        const int AI_X = 540;   
-        const int HP_Y = 80;    
-        const int BAR_W = 320;  
-        
-        char buf[256];
-        if (sh.has_state) {
-            DrawPanel(P_X - 10, HP_Y - 10, BAR_W + 20, 100); 
-            DrawTextEx(g_ui.font, "PLAYER", (Vector2){P_X, HP_Y}, SZ_HUD, 1, WHITE);
-            DrawHPBar(P_X, HP_Y + 25, BAR_W, 20, sh.st.p_hp, 30, sh.st.p_shield);
-            snprintf(buf, sizeof(buf), "HP %d/%d  SHD %d  Mana %d/%d", 
-                sh.st.p_hp, 30, sh.st.p_shield, sh.st.mana, sh.st.max_mana);
-            DrawTextEx(g_ui.font, buf, (Vector2){P_X, HP_Y + 50}, SZ_HUD, 1, GREEN);
-            if (sh.st.p_buff > 0 || sh.st.p_poison > 0) {
-                snprintf(buf, sizeof(buf), "Buff %d  Psn %u", sh.st.p_buff, (unsigned)sh.st.p_poison);
-                DrawTextEx(g_ui.font, buf, (Vector2){P_X, HP_Y + 74}, SZ_LOG, 1, LIGHTGRAY);
-            }
-
-            DrawPanel(AI_X - 10, HP_Y - 10, BAR_W + 20, 100); 
-            DrawTextEx(g_ui.font, "OPPONENT", (Vector2){AI_X, HP_Y}, SZ_HUD, 1, WHITE);
-            DrawHPBar(AI_X, HP_Y + 25, BAR_W, 20, sh.st.ai_hp, 30, sh.st.ai_shield);
-            snprintf(buf, sizeof(buf), "HP %d/%d  SHD %d  PSN %u", 
-                sh.st.ai_hp, 30, sh.st.ai_shield, (unsigned)sh.st.ai_poison);
-            DrawTextEx(g_ui.font, buf, (Vector2){AI_X, HP_Y + 50}, SZ_HUD, 1, RED);
-            if (sh.st.ai_buff > 0) {
-                snprintf(buf, sizeof(buf), "Buff %d", sh.st.ai_buff);
-                DrawTextEx(g_ui.font, buf, (Vector2){AI_X, HP_Y + 74}, SZ_LOG, 1, LIGHTGRAY);
-            }
-
-            DrawPanel(AI_X - 10, 210, 350, 150);
-            DrawTextEx(g_ui.font, "Battle Log:", (Vector2){AI_X, 215}, SZ_LOG, 1, GRAY);
-            int ly = 235;
-            for (int i = 0; i < 6; i++) {
-                const char *line = sh.st.logs[(sh.st.log_head + i) % 6];
-                if (line[0] == '\0') line = "-";
-                DrawTextEx(g_ui.font, line, (Vector2){AI_X, (float)ly}, SZ_LOG, 1, LIGHTGRAY);
-                ly += 18;
-            }
-
-            Color btnColor = (sh.st.turn == 0) ? SKYBLUE : GRAY;
-            DrawPanel(endBtn.x, endBtn.y, endBtn.width, endBtn.height); 
-            DrawRectangleRec(endBtn, btnColor); 
-            DrawRectangleLinesEx(endBtn, 2, WHITE);
-            DrawTextEx(g_ui.font, "End Turn", (Vector2){endBtn.x + 15, endBtn.y + 10}, SZ_HUD, 1, BLACK);
-
-            int n = sh.has_hand ? (sh.hand.n > 3 ? 3 : sh.hand.n) : 0;
-            int hover_idx = -1;
-            Vector2 mouse_p = GetMousePosition();
+        int hover_idx = hover_card(&sh, GetMousePosition());
+        int dirty = !scene_ok || seq != scene_seq || hover_idx != scene_hover || selected_idx != scene_sel;
 
-            if (sh.st.turn == 0 && !sh.st.game_over) {
-                for (int i = 0; i < n; i++) {
-                     if (CheckCollisionPointRec(mouse_p, cardRect[i])) {
-                         hover_idx = i;
-                         break;
-                     }
-                }
-            }
-
-            for (int i = 0; i < 3; i++) {
-                if (i >= n) {
-                     DrawPanel((int)cardRect[i].x, (int)cardRect[i].y, (int)cardRect[i].width, (int)cardRect[i].height);
-                     continue;
-                }
-                if (i == selected_idx || i == hover_idx) continue;
-
-                Rectangle r = cardRect[i];
-                uint16_t cid = sh.hand.card_ids[i];
-                const card_def_t *def = get_card_def(cid);
-                Texture2D tex = (def) ? tex_for_card(def->type) : (Texture2D){0};
-
-                bool disabled = (sh.st.turn != 0);
-                DrawCardVertical(tex, r, def, disabled, false, false);
-            }
-
-            if (hover_idx >= 0 && hover_idx != selected_idx) {
-                int i = hover_idx;
-                Rectangle base = cardRect[i];
-                float scale = 1.15f;
-                float nw = base.width * scale;
-                float nh = base.height * scale;
-                float nx = base.x - (nw - base.width)*0.5f;
-                float ny = base.y - 40; 
-                Rectangle r = {nx, ny, nw, nh};
-                
-                uint16_t cid = sh.hand.card_ids[i];
-                const card_def_t *def = get_card_def(cid);
-                Texture2D tex = (def) ? tex_for_card(def->type) : (Texture2D){0};
-
-                DrawCardVertical(tex, r, def, false, true, false);
-            }
-
-            if (selected_idx >= 0 && selected_idx < n) {
-                int i = selected_idx;
-                Rectangle base = cardRect[i];
-                float scale = 1.30f;
-                float nw = base.width * scale;
-                float nh = base.height * scale;
-                float nx = base.x - (nw - base.width)*0.5f;
-                float ny = base.y - 80; 
-                Rectangle r = {nx, ny, nw, nh};
-                
-                uint16_t cid = sh.hand.card_ids[i];
-                const card_def_t *def = get_card_def(cid);
-                Texture2D tex = (def) ? tex_for_card(def->type) : (Texture2D){0};
-
-                DrawCardVertical(tex, r, def, false, false, true); 
-                
-                DrawRectangle(r.x, r.y - 40, r.width, 30, (Color){0,0,0,200});
-                DrawTextEx(g_ui.font, "CLICK TO CONFIRM", (Vector2){r.x + 10, r.y - 35}, 16, 1, GREEN);
-
-                if (def) {
-                    int px = AI_X + 25; 
-                    int py = 75;
-                    Rectangle pRect = { px, py, 220, 300 }; 
-                    
-                    DrawRectangle(px+10, py+10, 220, 300, (Color){0,0,0,120});
-                    
-                    DrawRectangleRec(pRect, (Color){30, 30, 35, 255});
-                    DrawRectangleLinesEx(pRect, 3, GOLD);
-                    
-                    Rectangle artDst = { px + 10, py + 10, 200, 160 };
-                    Rectangle src = SrcCropToFit(tex, artDst.width, artDst.height);
-                    DrawTexturePro(tex, src, artDst, (Vector2){0,0}, 0.0f, WHITE);
-                    DrawRectangleLinesEx(artDst, 1, BLACK);
-
-                    DrawTextEx(g_ui.font, def->name, (Vector2){px+15, py+180}, 24, 1, GOLD);
-                    
-                    char desc[64];
-                    get_card_desc(def, desc, sizeof(desc));
-                    DrawTextEx(g_ui.font, desc, (Vector2){px+15, py+215}, 18, 1, WHITE);
-                    
-                    snprintf(buf, sizeof(buf), "Cost: %u   Val: %d", def->cost, def->value);
-                    DrawTextEx(g_ui.font, buf, (Vector2){px+15, py+260}, 18, 1, LIGHTGRAY);
-                    
-                    DrawTextEx(g_ui.font, "[PREVIEW]", (Vector2){px+15, py+282}, 14, 1, GRAY);
-                }
-            }
-            
-            if (sh.st.turn != 0 && !sh.st.game_over) {
-                 const char *aitext = "AI TURN";
-                 int w = MeasureText(aitext, 40);
-                 DrawRectangle(0, H/2 - 40, W, 80, (Color){0, 0, 0, 200});
-                 DrawTextEx(g_ui.font, aitext, (Vector2){(W-w)/2, H/2 - 20}, 40, 2, RED);
-            }
-
-            if (sh.st.game_over) {
-                DrawRectangle(0, 0, W, H, (Color){0, 0, 0, 240}); 
-                snprintf(buf, sizeof(buf), "GAME OVER - WINNER: %s", winner_name(sh.st.winner));
-                DrawTextEx(g_ui.font, buf, (Vector2){250, 270}, 32, 2, GOLD);
+        if (!idle) {
+            BeginDrawing();
+            draw_scene(&sh, hover_idx, selected_idx);
+            redraws++;
+        } else {
+            if (dirty) {
+                BeginTextureMode(scene);
+                draw_scene(&sh, hover_idx, selected_idx);
+                EndTextureMode();
+                scene_ok = 1;
+                scene_seq = seq;
+                scene_hover = hover_idx;
+                scene_sel = selected_idx;
+                redraws++;
             }
+            BeginDrawing();
+            // The texture holds final colors with alpha < 255 where panels were
+            // blended; premultiplied onto black puts back exactly those colors.
+            ClearBackground(BLACK);
+            BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+            DrawTextureRec(scene.texture, (Rectangle){ 0, 0, (float)W, -(float)H }, (Vector2){ 0, 0 }, WHITE);
+            EndBlendMode();
         }
-        
+
         float dt = GetFrameTime();
         if (g_anim.active) {
             g_anim.t += dt / g_anim.dur;
@@ -626,6 +786,15 @@ int main(int argc, char **argv) {
             DrawRectangle(pos.x - 28, pos.y - 18, 56, 36, (Color){250, 240, 200, 255});
             DrawTextEx(g_ui.font, g_anim.text, (Vector2){pos.x - 22, pos.y - 10}, 16, 1, BLACK);
         }
+        if (g_float.active) {
+            g_float.t += dt;
+            if (g_float.t >= g_float.dur) g_float.active = 0;
+            else {
+                float k = g_float.t / g_float.dur;
+                Color c = { 255, 80, 80, (unsigned char)(255 * (1.0f - k)) };
+                DrawTextEx(g_ui.font, g_float.text, (Vector2){g_float.pos.x, g_float.pos.y - 30 * k}, 28, 2, c);
+            }
+        }
 
         Vector2 mp = GetMousePosition();
         if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) &&
@@ -634,10 +803,10 @@ int main(int argc, char **argv) {
             // CMD to Thread
             if (CheckCollisionPointRec(mp, endBtn)) {
                 net_cmd_t cmd = { .op = OP_END_TURN };
-                write(pfd[1], &cmd, sizeof(cmd));
+                if (spsc_push(&g_cmd, &cmd) != 0) fprintf(stderr, "[GUI] command ring full\n");
                 selected_idx = -1;
             } else {
-                int n = sh.has_hand ? (sh.hand.n > 3 ? 3 : sh.hand.n) : 0;
+                int n = hand_count(&sh);
                 int clicked_card_idx = -1;
                 for (int i = 0; i < n; i++) {
                     if (CheckCollisionPointRec(mp, cardRect[i])) {
@@ -661,7 +830,7 @@ int main(int argc, char **argv) {
                         snprintf(g_anim.text, sizeof(g_anim.text), "%s", def ? def->name : "PLAY");
                         
                         net_cmd_t cmd = { .op = OP_PLAY_CARD, .play_payload = { .hand_idx = (uint8_t)clicked_card_idx } };
-                        write(pfd[1], &cmd, sizeof(cmd));
+                        if (spsc_push(&g_cmd, &cmd) != 0) fprintf(stderr, "[GUI] command ring full\n");
                         
                         selected_idx = -1;
                     } else {
@@ -673,8 +842,24 @@ int main(int argc, char **argv) {
             }
         }
 
+        if (IsKeyPressed(KEY_F3)) show_stats = !show_stats;
+        if (show_stats) draw_frame_stats(&h_work, work_bins, redraws, h_work.count);
+
+        if (idle) {
+            Vector2 md = GetMouseDelta();
+            int input = md.x != 0 || md.y != 0 || GetMouseWheelMove() != 0 ||
+                        IsMouseButtonDown(MOUSE_LEFT_BUTTON) || GetKeyPressed() != 0;
+            if (input || dirty || g_anim.active || g_float.active || show_stats) last_active = t0;
+            int fps = (t0 - last_active < IDLE_AFTER_NS) ? ACTIVE_FPS : idle_fps;
+            if (fps != cur_fps) { cur_fps = fps; SetTargetFPS(fps); }
+        }
+
+        uint64_t work = now_ns() - t0;
+        hist_add(&h_work, work);
+        work_bins[frame_bin(work)]++;
         EndDrawing();
     }
+    UnloadRenderTexture(scene);
 
     UnloadTexture(g_ui.tex_atk);
     UnloadTexture(g_ui.tex_heal);
@@ -684,8 +869,18 @@ int main(int argc, char **argv) {
     UnloadFont(g_ui.font);
 
     CloseWindow();
+
+    if (h_frame.count > 0) {
+        printf("[GUI] frames=%llu scene redraws=%llu (%.1f%%) idle=%s\n",
+               (unsigned long long)h_work.count, (unsigned long long)redraws,
+               100.0 * (double)redraws / (double)h_work.count, idle ? "on" : "off");
+        print_hist_ms("interval", &h_frame);
+        print_hist_ms("work", &h_work);
+        printf("[GUI] snapshot p50=%.0fns p99=%.0fns max=%.0fns\n",
+               (double)hist_quantile(&h_snap, 0.50), (double)hist_quantile(&h_snap, 0.99), (double)h_snap.max);
+    }
     
     // cleanup
-    // leak stuff for now (thread detach, ctx, pipe)
+    // leak stuff for now (thread detach, ctx, command ring)
     return 0;
 }
@@ -0,0 +1,385 @@
+#define _DEFAULT_SOURCE
+#include "ai.h"
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#define WIN_SCORE  1000000
+#define DRAW_WAYS  (DRAW_POOL_SIZE * DRAW_POOL_SIZE * DRAW_POOL_SIZE)
+#define MAX_COMBOS 286 // multisets of HAND_DRAW cards out of DRAW_POOL_SIZE
+
+/* ---------- Transposition table ----------
+ * One entry = two words. The key is stored XOR'ed with the data word, so a
+ * torn write from a concurrent writer (another worker process) just fails
+ * the key check instead of returning garbage. No locks.
+ *
+ * data: [0..31] value, [32..39] depth, [40] valid
+ */
+typedef struct {
+    uint64_t key_x;
+    uint64_t data;
+} tt_entry_t;
+
+struct ai_tt {
+    uint64_t mask;
+    size_t   bytes;
+    tt_entry_t e[];
+};
+
+ai_tt_t* ai_tt_create(unsigned log2_entries) {
+    if (log2_entries < 4) log2_entries = 4;
+    if (log2_entries > 28) log2_entries = 28;
+
+    size_t n = (size_t)1 << log2_entries;
+    size_t bytes = sizeof(ai_tt_t) + n * sizeof(tt_entry_t);
+    void *p = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+
+    // mmap zero-fills: every entry starts invalid
+    ai_tt_t *tt = (ai_tt_t*)p;
+    tt->mask = n - 1;
+    tt->bytes = bytes;
+    return tt;
+}
+
+void ai_tt_destroy(ai_tt_t *tt) {
+    if (tt) munmap(tt, tt->bytes);
+}
+
+/* ---------- Static tables (Zobrist keys, draw combos) ---------- */
+
+enum {
+    ZF_P_HP, ZF_AI_HP,          // int16 fields first: they also key their high byte
+    ZF_P_SHIELD, ZF_AI_SHIELD,
+    ZF_P_BUFF, ZF_AI_BUFF,
+    ZF_P_POISON, ZF_AI_POISON,
+    ZF_MANA, ZF_MAX_MANA,
+    ZF_NODE,    // side to move | node kind
+    ZF_COUNT
+};
+
+enum { NODE_DECIDE = 0, NODE_CHANCE = 1 };
+
+typedef struct {
+    uint8_t  cnt[DRAW_POOL_SIZE];
+    uint16_t ways; // ordered draws producing this multiset
+} draw_combo_t;
+
+static uint64_t g_z_field[ZF_COUNT][256];
+static uint64_t g_z_high[ZF_AI_BUFF + 1][256]; // high byte of the int16 fields
+static uint64_t g_z_hand[DRAW_POOL_SIZE][9];
+static const card_def_t *g_defs[DRAW_POOL_SIZE];
+static draw_combo_t g_combos[MAX_COMBOS];
+static int g_ncombos;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void init_tables(void) {
+    // fixed seed: every worker must derive the same keys for the shared table
+    uint64_t seed = 0x7C6A11D5EEDULL;
+    for (int f = 0; f < ZF_COUNT; f++)
+        for (int v = 0; v < 256; v++) g_z_field[f][v] = splitmix64(&seed);
+    for (int f = 0; f <= ZF_AI_BUFF; f++)
+        for (int v = 0; v < 256; v++) g_z_high[f][v] = splitmix64(&seed);
+    for (int k = 0; k < DRAW_POOL_SIZE; k++)
+        for (int n = 0; n < 9; n++) g_z_hand[k][n] = splitmix64(&seed);
+
+    const uint16_t *pool = engine_draw_pool();
+    for (int k = 0; k < DRAW_POOL_SIZE; k++) g_defs[k] = get_card_def(pool[k]);
+
+    g_ncombos = 0;
+    for (int a = 0; a < DRAW_POOL_SIZE; a++)
+        for (int b = a; b < DRAW_POOL_SIZE; b++)
+            for (int c = b; c < DRAW_POOL_SIZE; c++) {
+                draw_combo_t *dc = &g_combos[g_ncombos++];
+                memset(dc, 0, sizeof(*dc));
+                dc->cnt[a]++; dc->cnt[b]++; dc->cnt[c]++;
+                if (a == c) dc->ways = 1;
+                else if (a == b || b == c) dc->ways = 3;
+                else dc->ways = 6;
+            }
+}
+
+static int kind_of(uint16_t cid) {
+    const uint16_t *pool = engine_draw_pool();
+    for (int k = 0; k < DRAW_POOL_SIZE; k++)
+        if (pool[k] == cid) return k;
+    return -1;
+}
+
+/* ---------- Search ---------- */
+
+typedef struct {
+    const ai_search_t *cfg;
+    uint64_t nodes, probes, hits;
+    uint64_t cuts; // subtrees max_nodes replaced by a static eval
+} sctx_t;
+
+// all 16 bits: heals can take HP past 255
+static uint64_t z16(int f, int16_t v) {
+    uint16_t u = (uint16_t)v;
+    return g_z_field[f][u & 0xFF] ^ g_z_high[f][u >> 8];
+}
+
+static uint64_t hash_node(const state_t *s, const uint8_t *cnt, int kind) {
+    uint64_t h = z16(ZF_P_HP, s->p_hp)
+               ^ z16(ZF_AI_HP, s->ai_hp)
+               ^ z16(ZF_P_SHIELD, s->p_shield)
+               ^ z16(ZF_AI_SHIELD, s->ai_shield)
+               ^ z16(ZF_P_BUFF, s->p_buff)
+               ^ z16(ZF_AI_BUFF, s->ai_buff)
+               ^ g_z_field[ZF_P_POISON][s->p_poison]
+               ^ g_z_field[ZF_AI_POISON][s->ai_poison]
+               ^ g_z_field[ZF_MANA][s->mana]
+               ^ g_z_field[ZF_MAX_MANA][s->max_mana]
+               ^ g_z_field[ZF_NODE][(s->turn & 1) | (kind << 1)];
+    if (cnt) {
+        for (int k = 0; k < DRAW_POOL_SIZE; k++)
+            if (cnt[k]) h ^= g_z_hand[k][cnt[k] > 8 ? 8 : cnt[k]];
+    }
+    return h | 1; // never 0: empty entries must not match
+}
+
+static int tt_probe(sctx_t *c, uint64_t key, int depth, int32_t *val) {
+    ai_tt_t *tt = c->cfg->tt;
+    if (!tt) return 0;
+    c->probes++;
+
+    tt_entry_t *e = &tt->e[key & tt->mask];
+    uint64_t d = __atomic_load_n(&e->data, __ATOMIC_RELAXED);
+    uint64_t k = __atomic_load_n(&e->key_x, __ATOMIC_RELAXED);
+    if ((k ^ d) != key || !((d >> 40) & 1)) return 0;
+    if ((int)((d >> 32) & 0xFF) < depth) return 0;
+
+    *val = (int32_t)(uint32_t)d;
+    c->hits++;
+    return 1;
+}
+
+static int stopped(const int *stop) {
+    return stop && __atomic_load_n(stop, __ATOMIC_RELAXED);
+}
+
+static void tt_store(sctx_t *c, uint64_t key, int depth, int32_t val) {
+    ai_tt_t *tt = c->cfg->tt;
+    if (!tt || stopped(c->cfg->stop)) return; // an abandoned search's values are not exact
+
+    uint64_t d = (uint64_t)(uint32_t)val | ((uint64_t)(uint8_t)depth << 32) | (1ULL << 40);
+    tt_entry_t *e = &tt->e[key & tt->mask];
+    __atomic_store_n(&e->data, d, __ATOMIC_RELAXED);
+    __atomic_store_n(&e->key_x, key ^ d, __ATOMIC_RELAXED);
+}
+
+// AI perspective: positive is good for the AI
+static int32_t eval_static(const state_t *s) {
+    if (s->game_over) {
+        if (s->winner == 2) return WIN_SCORE;
+        if (s->winner == 1) return -WIN_SCORE;
+        return 0;
+    }
+    return 100 * (s->ai_hp - s->p_hp)
+         +  40 * (s->ai_shield - s->p_shield)
+         +  30 * (s->ai_buff - s->p_buff)
+         + 180 * ((int)s->p_poison - (int)s->ai_poison);
+}
+
+static int play_kind(state_t *s, int k) {
+    hand_t h;
+    h.n = 1;
+    h.card_ids[0] = engine_draw_pool()[k];
+    return engine_play_quiet(s, &h, s->turn == 0, 0);
+}
+
+static int32_t decide(sctx_t *c, const state_t *s, uint8_t *cnt, int depth);
+
+static int32_t chance(sctx_t *c, const state_t *s, int depth) {
+    c->nodes++;
+    if (stopped(c->cfg->stop)) return eval_static(s); // unwind fast, nothing is stored
+    uint64_t key = hash_node(s, NULL, NODE_CHANCE);
+    int32_t v;
+    if (tt_probe(c, key, depth, &v)) return v;
+
+    state_t n = *s;
+    n.mana = n.max_mana;
+    n.phase = PHASE_MAIN;
+
+    uint64_t cuts = c->cuts;
+    int64_t sum = 0;
+    for (int i = 0; i < g_ncombos; i++) {
+        uint8_t cnt[DRAW_POOL_SIZE];
+        memcpy(cnt, g_combos[i].cnt, sizeof(cnt));
+        sum += (int64_t)g_combos[i].ways * decide(c, &n, cnt, depth);
+    }
+    v = (int32_t)(sum / DRAW_WAYS);
+    // a value cut short by max_nodes is not worth `depth`: the TT is shared
+    // with deeper tiers, whose probes it would satisfy
+    if (c->cuts == cuts) tt_store(c, key, depth, v);
+    return v;
+}
+
+static int32_t end_turn_value(sctx_t *c, state_t *n, int depth) {
+    engine_end_quiet(n);
+    if (n->game_over || depth <= 1) return eval_static(n);
+    if (c->cfg->max_nodes && c->nodes >= c->cfg->max_nodes) {
+        c->cuts++;
+        return eval_static(n);
+    }
+    n->turn = (uint8_t)!n->turn;
+    return chance(c, n, depth - 1);
+}
+
+static int32_t decide(sctx_t *c, const state_t *s, uint8_t *cnt, int depth) {
+    c->nodes++;
+    if (s->game_over || stopped(c->cfg->stop)) return eval_static(s);
+
+    uint64_t key = hash_node(s, cnt, NODE_DECIDE);
+    int32_t v;
+    if (tt_probe(c, key, depth, &v)) return v;
+
+    int maximize = (s->turn == 1);
+    uint64_t cuts = c->cuts;
+    state_t n = *s;
+    int32_t best = end_turn_value(c, &n, depth);
+
+    for (int k = 0; k < DRAW_POOL_SIZE; k++) {
+        if (!cnt[k] || !g_defs[k] || g_defs[k]->cost > s->mana) continue;
+        n = *s;
+        if (play_kind(&n, k) != 0) continue;
+        cnt[k]--;
+        int32_t cv = decide(c, &n, cnt, depth);
+        cnt[k]++;
+        if (maximize ? (cv > best) : (cv < best)) best = cv;
+    }
+
+    if (c->cuts == cuts) tt_store(c, key, depth, best); // see chance()
+    return best;
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int ai_pick_search(const state_t *st, const hand_t *hand, void *ctx) {
+    ai_search_t *cfg = (ai_search_t*)ctx;
+    pthread_once(&g_once, init_tables);
+
+    long long t0 = now_ns();
+    int depth = cfg->depth < 1 ? 1 : cfg->depth;
+
+    uint8_t cnt[DRAW_POOL_SIZE];
+    memset(cnt, 0, sizeof(cnt));
+    int n = hand->n > 8 ? 8 : hand->n;
+    for (int i = 0; i < n; i++) {
+        int k = kind_of(hand->card_ids[i]);
+        if (k >= 0) cnt[k]++;
+    }
+
+    sctx_t c = { .cfg = cfg };
+    state_t root = *st;
+    root.turn = 1;
+
+    state_t s = root;
+    int32_t best = end_turn_value(&c, &s, depth);
+    int best_k = -1;
+
+    for (int k = 0; k < DRAW_POOL_SIZE; k++) {
+        if (!cnt[k] || !g_defs[k] || g_defs[k]->cost > root.mana) continue;
+        s = root;
+        if (play_kind(&s, k) != 0) continue;
+        cnt[k]--;
+        int32_t v = decide(&c, &s, cnt, depth);
+        cnt[k]++;
+        if (v > best) { best = v; best_k = k; }
+    }
+
+    cfg->stats.picks++;
+    cfg->stats.nodes += c.nodes;
+    cfg->stats.tt_probes += c.probes;
+    cfg->stats.tt_hits += c.hits;
+    cfg->stats.ns += (uint64_t)(now_ns() - t0);
+
+    if (best_k < 0) return -1;
+    uint16_t cid = engine_draw_pool()[best_k];
+    for (int i = 0; i < n; i++)
+        if (hand->card_ids[i] == cid) return i;
+    return -1;
+}
+
+/* ---------- Decision cache ---------- */
+
+static unsigned clamp_u(int v, unsigned max) {
+    if (v < 0) return 0;
+    return (unsigned)v > max ? max : (unsigned)v;
+}
+
+// hp/2 keeps the "hp < 10" boundary; shield keeps "== 0"
+static unsigned hp_bucket(int hp)   { return clamp_u(hp / 2, 63); }
+static unsigned shd_bucket(int shd) { return shd <= 0 ? 0 : clamp_u(1 + (shd - 1) / 2, 31); }
+
+int ai_canon_key(const state_t *st, const hand_t *hand, uint8_t policy_id,
+                 uint64_t *k0, uint64_t *k1) {
+    // sorted hand: 8 x 4-bit (kind + 1), 0 = empty
+    uint8_t kinds[8];
+    int n = 0;
+    int hn = hand->n > 8 ? 8 : hand->n;
+    for (int i = 0; i < hn; i++) {
+        if (hand->card_ids[i] == 0) continue; // played
+        int k = kind_of(hand->card_ids[i]);
+        if (k < 0) return -1;
+        int j = n++;
+        while (j > 0 && kinds[j - 1] > k + 1) { kinds[j] = kinds[j - 1]; j--; }
+        kinds[j] = (uint8_t)(k + 1);
+    }
+    uint64_t h = 0;
+    for (int i = 0; i < n; i++) h |= (uint64_t)kinds[i] << (4 * i);
+
+    *k0 = h
+        | (uint64_t)clamp_u(st->mana, 15) << 32
+        | (uint64_t)clamp_u(st->max_mana, 15) << 36
+        | (uint64_t)hp_bucket(st->ai_hp) << 40
+        | (uint64_t)hp_bucket(st->p_hp) << 46
+        | (uint64_t)policy_id << 52
+        | 1ULL << 63; // never 0 (empty slot)
+
+    *k1 = (uint64_t)shd_bucket(st->ai_shield)
+        | (uint64_t)shd_bucket(st->p_shield) << 5
+        | (uint64_t)clamp_u(st->ai_buff, 31) << 10
+        | (uint64_t)clamp_u(st->p_buff, 31) << 15
+        | (uint64_t)clamp_u(st->ai_poison, 31) << 20
+        | (uint64_t)clamp_u(st->p_poison, 31) << 25;
+    return 0;
+}
+
+int ai_pick_cached(const state_t *st, const hand_t *hand, void *ctx) {
+    ai_cached_t *cc = (ai_cached_t*)ctx;
+    if (!cc->cache) return cc->inner.pick(st, hand, cc->inner.ctx);
+
+    uint64_t k0, k1;
+    if (ai_canon_key(st, hand, cc->policy_id, &k0, &k1) != 0)
+        return cc->inner.pick(st, hand, cc->inner.ctx);
+
+    // cached value is a card id (0 = end turn), valid for any order of the hand
+    int hn = hand->n > 8 ? 8 : hand->n;
+    int32_t cid;
+    if (ipc_aicache_get(cc->cache, k0, k1, &cid) == 0) {
+        if (cid == 0) return -1;
+        for (int i = 0; i < hn; i++)
+            if (hand->card_ids[i] == (uint16_t)cid) return i;
+        // key collision on an unknown card: fall through and recompute
+    }
+
+    int idx = cc->inner.pick(st, hand, cc->inner.ctx);
+    if (stopped(cc->stop)) return idx;
+    cid = (idx >= 0 && idx < hn) ? hand->card_ids[idx] : 0;
+    ipc_aicache_put(cc->cache, k0, k1, cid);
+    return idx;
+}
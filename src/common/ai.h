@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "engine.h"
+#include "ipc.h"
+
+/* ---------------------------
+ *  Search AI (expectiminimax)
+ * ---------------------------
+ * Depth-limited expectiminimax over the AI's card sequence, the END phase,
+ * and the next side's uniform 3-card draw (chance node). Positions are cached
+ * in a transposition table keyed by a Zobrist hash of the numeric state and
+ * the hand multiset.
+ */
+
+// Bounded, lock-free transposition table. Lives in a MAP_SHARED anonymous
+// mapping so that forked workers created after ai_tt_create() share it.
+typedef struct ai_tt ai_tt_t;
+
+ai_tt_t* ai_tt_create(unsigned log2_entries);
+void ai_tt_destroy(ai_tt_t *tt);
+
+typedef struct {
+    uint64_t picks;
+    uint64_t nodes;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t ns;       // wall time spent in search
+} ai_search_stats_t;
+
+typedef struct {
+    ai_tt_t *tt;        // may be NULL (no caching)
+    int depth;          // turns to look ahead: 1 = own turn, 2 = + opponent reply, ...
+    uint64_t max_nodes; // per pick; deeper chance nodes fall back to static eval (0 = unlimited)
+    const int *stop;    // optional: nonzero (set by another thread) abandons the pick;
+                        // nothing is stored in the TT after that
+    ai_search_stats_t stats; // accumulated by ai_pick_search
+} ai_search_t;
+
+// ai_pick_fn compatible; ctx is ai_search_t*
+int ai_pick_search(const state_t *st, const hand_t *hand, void *ctx);
+
+/* ---------------------------
+ *  Decision cache (any policy)
+ * ---------------------------
+ * Memoizes inner.pick() in the shared AI cache, keyed by a canonical
+ * encoding of the state (HP/shield in coarse buckets) and the sorted hand,
+ * so a search policy gets a coarse approximation. Only worth it for picks
+ * that cost far more than a lookup (~0.2 us): the server does not cache
+ * the greedy policy. Hands with a card outside the draw pool have no key
+ * and are not cached.
+ */
+typedef struct {
+    shm_aicache_t *cache;
+    uint8_t policy_id;   // keeps decisions of different policies apart
+    ai_policy_t inner;
+    const int *stop;     // optional: an inner pick made while set is not stored
+} ai_cached_t;
+
+// 0 ok, -1 the hand holds a card outside the draw pool (no key)
+int ai_canon_key(const state_t *st, const hand_t *hand, uint8_t policy_id,
+                 uint64_t *k0, uint64_t *k1);
+
+// ai_pick_fn compatible; ctx is ai_cached_t*
+int ai_pick_cached(const state_t *st, const hand_t *hand, void *ctx);
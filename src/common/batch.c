@@ -0,0 +1,336 @@
+#include "batch.h"
+#include "engine.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <immintrin.h>
+
+/* ---------- Card table (by kind) ---------- */
+
+static int16_t g_type[DRAW_POOL_SIZE];
+static int16_t g_cost[DRAW_POOL_SIZE];
+static int16_t g_value[DRAW_POOL_SIZE];
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static int g_use_simd = 0;
+
+static void init_tables(void) {
+    const uint16_t *pool = engine_draw_pool();
+    for (int k = 0; k < DRAW_POOL_SIZE; k++) {
+        const card_def_t *c = get_card_def(pool[k]);
+        g_type[k]  = c ? c->type : 0;
+        g_cost[k]  = c ? c->cost : 0;
+        g_value[k] = c ? c->value : 0;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    g_use_simd = __builtin_cpu_supports("avx2");
+#endif
+}
+
+uint8_t batch_card_kind(uint16_t card_id) {
+    const uint16_t *pool = engine_draw_pool();
+    for (int k = 0; k < DRAW_POOL_SIZE; k++)
+        if (pool[k] == card_id) return (uint8_t)k;
+    return BATCH_NO_CARD;
+}
+
+int batch_simd_enabled(void) {
+    pthread_once(&g_once, init_tables);
+    return g_use_simd;
+}
+
+void batch_force_scalar(int on) {
+    pthread_once(&g_once, init_tables);
+    if (on) g_use_simd = 0;
+    else {
+#if defined(__x86_64__) || defined(__i386__)
+        g_use_simd = __builtin_cpu_supports("avx2");
+#endif
+    }
+}
+
+/* ---------- Storage ---------- */
+
+#define BATCH_FIELDS 13
+
+static int16_t** field_ptr(batch_t *b, int f) {
+    int16_t **fields[BATCH_FIELDS] = {
+        &b->p_hp, &b->ai_hp, &b->p_shield, &b->ai_shield, &b->p_buff, &b->ai_buff,
+        &b->p_poison, &b->ai_poison, &b->mana, &b->max_mana, &b->turn,
+        &b->game_over, &b->winner
+    };
+    return fields[f];
+}
+
+int batch_init(batch_t *b, size_t n) {
+    pthread_once(&g_once, init_tables);
+    memset(b, 0, sizeof(*b));
+
+    // lanes rounded up to a whole vector, padding stays zero
+    size_t cap = (n + 15) & ~(size_t)15;
+    if (cap == 0) cap = 16;
+    for (int f = 0; f < BATCH_FIELDS; f++) {
+        int16_t *p = aligned_alloc(32, cap * sizeof(int16_t));
+        if (!p) { batch_free(b); return -1; }
+        memset(p, 0, cap * sizeof(int16_t));
+        *field_ptr(b, f) = p;
+    }
+    b->n = n;
+    return 0;
+}
+
+void batch_free(batch_t *b) {
+    for (int f = 0; f < BATCH_FIELDS; f++) {
+        int16_t **p = field_ptr(b, f);
+        free(*p);
+        *p = NULL;
+    }
+    b->n = 0;
+}
+
+void batch_load(batch_t *b, size_t i, const state_t *st) {
+    b->p_hp[i] = st->p_hp;           b->ai_hp[i] = st->ai_hp;
+    b->p_shield[i] = st->p_shield;   b->ai_shield[i] = st->ai_shield;
+    b->p_buff[i] = st->p_buff;       b->ai_buff[i] = st->ai_buff;
+    b->p_poison[i] = st->p_poison;   b->ai_poison[i] = st->ai_poison;
+    b->mana[i] = st->mana;           b->max_mana[i] = st->max_mana;
+    b->turn[i] = st->turn;
+    b->game_over[i] = st->game_over; b->winner[i] = st->winner;
+}
+
+void batch_store(const batch_t *b, size_t i, state_t *st) {
+    st->p_hp = b->p_hp[i];           st->ai_hp = b->ai_hp[i];
+    st->p_shield = b->p_shield[i];   st->ai_shield = b->ai_shield[i];
+    st->p_buff = b->p_buff[i];       st->ai_buff = b->ai_buff[i];
+    st->p_poison = (uint8_t)b->p_poison[i];
+    st->ai_poison = (uint8_t)b->ai_poison[i];
+    st->mana = (uint8_t)b->mana[i];  st->max_mana = (uint8_t)b->max_mana[i];
+    st->turn = (uint8_t)b->turn[i];
+    st->game_over = (uint8_t)b->game_over[i];
+    st->winner = (uint8_t)b->winner[i];
+}
+
+/* ---------- Scalar lanes (fallback + tails) ---------- */
+
+static void game_over_lane(batch_t *b, size_t i) {
+    if (b->game_over[i]) return;
+    if (b->p_hp[i] <= 0 || b->ai_hp[i] <= 0) {
+        b->game_over[i] = 1;
+        if (b->p_hp[i] > b->ai_hp[i]) b->winner[i] = 1;
+        else if (b->ai_hp[i] > b->p_hp[i]) b->winner[i] = 2;
+        else b->winner[i] = 0;
+    }
+}
+
+static int16_t play_lane(batch_t *b, size_t i, uint8_t k) {
+    if (k >= DRAW_POOL_SIZE) return -3;
+    if (g_cost[k] > b->mana[i]) return -2;
+    b->mana[i] = (int16_t)(b->mana[i] - g_cost[k]);
+
+    int is_player = (b->turn[i] == 0);
+    int16_t *self_hp     = is_player ? &b->p_hp[i]      : &b->ai_hp[i];
+    int16_t *enemy_hp    = is_player ? &b->ai_hp[i]     : &b->p_hp[i];
+    int16_t *self_shield = is_player ? &b->p_shield[i]  : &b->ai_shield[i];
+    int16_t *enemy_shield= is_player ? &b->ai_shield[i] : &b->p_shield[i];
+    int16_t *self_buff   = is_player ? &b->p_buff[i]    : &b->ai_buff[i];
+    int16_t *enemy_poison= is_player ? &b->ai_poison[i] : &b->p_poison[i];
+    int16_t v = g_value[k];
+
+    switch (g_type[k]) {
+        case CT_ATK: {
+            int dmg = (int)v + (int)(*self_buff);
+            *self_buff = 0;
+            apply_damage(enemy_hp, enemy_shield, dmg);
+        } break;
+        case CT_HEAL:   *self_hp = (int16_t)(*self_hp + v); break;
+        case CT_SHIELD: *self_shield = (int16_t)(*self_shield + v); break;
+        case CT_BUFF:   *self_buff = (int16_t)(*self_buff + v); break;
+        case CT_POISON: *enemy_poison = (uint8_t)(*enemy_poison + (uint8_t)v); break;
+        default: return -3;
+    }
+
+    game_over_lane(b, i);
+    return 0;
+}
+
+static void end_lane(batch_t *b, size_t i) {
+    if (b->p_poison[i] > 0) {
+        b->p_poison[i]--;
+        b->p_hp[i] = (int16_t)(b->p_hp[i] - 2);
+        if (b->p_hp[i] < 0) b->p_hp[i] = 0;
+    }
+    if (b->ai_poison[i] > 0) {
+        b->ai_poison[i]--;
+        b->ai_hp[i] = (int16_t)(b->ai_hp[i] - 2);
+        if (b->ai_hp[i] < 0) b->ai_hp[i] = 0;
+    }
+    game_over_lane(b, i);
+    if (b->game_over[i]) return;
+    b->turn[i] = (int16_t)(b->turn[i] ? 0 : 1);
+    b->mana[i] = b->max_mana[i];
+}
+
+/* ---------- AVX2 (16 games per op) ---------- */
+#if defined(__x86_64__) || defined(__i386__)
+
+#define LD(f)     _mm256_load_si256((const __m256i*)(b->f + i))
+#define ST(f, v)  _mm256_store_si256((__m256i*)(b->f + i), (v))
+#define SEL(m, a, b_) _mm256_blendv_epi8((b_), (a), (m)) // m ? a : b
+
+__attribute__((target("avx2")))
+static __m256i game_over_vec(batch_t *b, size_t i, __m256i fire_mask,
+                             __m256i p_hp, __m256i ai_hp) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi16(1);
+    const __m256i two  = _mm256_set1_epi16(2);
+
+    __m256i go = LD(game_over);
+    __m256i dead = _mm256_or_si256(_mm256_cmpgt_epi16(one, p_hp), _mm256_cmpgt_epi16(one, ai_hp));
+    __m256i fire = _mm256_and_si256(_mm256_and_si256(fire_mask, _mm256_cmpeq_epi16(go, zero)), dead);
+
+    __m256i w = SEL(_mm256_cmpgt_epi16(ai_hp, p_hp), two, zero);
+    w = SEL(_mm256_cmpgt_epi16(p_hp, ai_hp), one, w);
+
+    go = SEL(fire, one, go);
+    ST(game_over, go);
+    ST(winner, SEL(fire, w, LD(winner)));
+    return go;
+}
+
+__attribute__((target("avx2")))
+static void play_avx2(batch_t *b, size_t end, const uint8_t *kind, int16_t *rc) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(-1);
+
+    for (size_t i = 0; i < end; i += 16) {
+        __m256i k = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(kind + i)));
+
+        // card table lookup as compare + blend (the table is tiny)
+        __m256i typ = zero, cost = zero, val = zero, valid = zero;
+        for (int c = 0; c < DRAW_POOL_SIZE; c++) {
+            __m256i m = _mm256_cmpeq_epi16(k, _mm256_set1_epi16((int16_t)c));
+            valid = _mm256_or_si256(valid, m);
+            typ  = SEL(m, _mm256_set1_epi16(g_type[c]), typ);
+            cost = SEL(m, _mm256_set1_epi16(g_cost[c]), cost);
+            val  = SEL(m, _mm256_set1_epi16(g_value[c]), val);
+        }
+
+        __m256i mana = LD(mana);
+        __m256i ok = _mm256_andnot_si256(_mm256_cmpgt_epi16(cost, mana), valid);
+        if (rc) {
+            __m256i r = SEL(valid, _mm256_set1_epi16(-2), _mm256_set1_epi16(-3));
+            _mm256_storeu_si256((__m256i*)(rc + i), SEL(ok, zero, r));
+        }
+        if (_mm256_testz_si256(ok, ones)) continue;
+        ST(mana, SEL(ok, _mm256_sub_epi16(mana, cost), mana));
+
+        __m256i P = _mm256_cmpeq_epi16(LD(turn), zero); // player side
+        __m256i p_hp = LD(p_hp), ai_hp = LD(ai_hp);
+        __m256i p_shd = LD(p_shield), ai_shd = LD(ai_shield);
+        __m256i p_buf = LD(p_buff), ai_buf = LD(ai_buff);
+        __m256i p_psn = LD(p_poison), ai_psn = LD(ai_poison);
+
+        __m256i self_hp   = SEL(P, p_hp, ai_hp),   enemy_hp  = SEL(P, ai_hp, p_hp);
+        __m256i self_shd  = SEL(P, p_shd, ai_shd), enemy_shd = SEL(P, ai_shd, p_shd);
+        __m256i self_buf  = SEL(P, p_buf, ai_buf);
+        __m256i enemy_psn = SEL(P, ai_psn, p_psn);
+
+        __m256i m_atk  = _mm256_and_si256(ok, _mm256_cmpeq_epi16(typ, _mm256_set1_epi16(CT_ATK)));
+        __m256i m_heal = _mm256_and_si256(ok, _mm256_cmpeq_epi16(typ, _mm256_set1_epi16(CT_HEAL)));
+        __m256i m_shd  = _mm256_and_si256(ok, _mm256_cmpeq_epi16(typ, _mm256_set1_epi16(CT_SHIELD)));
+        __m256i m_buf  = _mm256_and_si256(ok, _mm256_cmpeq_epi16(typ, _mm256_set1_epi16(CT_BUFF)));
+        __m256i m_psn  = _mm256_and_si256(ok, _mm256_cmpeq_epi16(typ, _mm256_set1_epi16(CT_POISON)));
+
+        // ATK: value + buff, buff consumed, shield absorbs first (apply_damage)
+        __m256i dmg  = _mm256_add_epi16(val, self_buf);
+        self_buf = SEL(m_atk, zero, self_buf);
+        __m256i hit  = _mm256_and_si256(m_atk, _mm256_cmpgt_epi16(dmg, zero));
+        __m256i used = _mm256_and_si256(_mm256_cmpgt_epi16(enemy_shd, zero), _mm256_min_epi16(dmg, enemy_shd));
+        used = _mm256_and_si256(used, hit);
+        enemy_shd = _mm256_sub_epi16(enemy_shd, used);
+        __m256i rest = _mm256_sub_epi16(dmg, used);
+        __m256i hp_hit = _mm256_and_si256(hit, _mm256_cmpgt_epi16(rest, zero));
+        enemy_hp = SEL(hp_hit, _mm256_max_epi16(_mm256_sub_epi16(enemy_hp, rest), zero), enemy_hp);
+
+        // HEAL / SHIELD / BUFF / POISON
+        self_hp   = _mm256_add_epi16(self_hp,  _mm256_and_si256(val, m_heal));
+        self_shd  = _mm256_add_epi16(self_shd, _mm256_and_si256(val, m_shd));
+        self_buf  = _mm256_add_epi16(self_buf, _mm256_and_si256(val, m_buf));
+        enemy_psn = _mm256_and_si256(_mm256_add_epi16(enemy_psn, _mm256_and_si256(val, m_psn)),
+                                     _mm256_set1_epi16(0xFF));
+
+        p_hp  = SEL(P, self_hp, enemy_hp);   ai_hp  = SEL(P, enemy_hp, self_hp);
+        p_shd = SEL(P, self_shd, enemy_shd); ai_shd = SEL(P, enemy_shd, self_shd);
+        p_buf = SEL(P, self_buf, p_buf);     ai_buf = SEL(P, ai_buf, self_buf);
+        p_psn = SEL(P, p_psn, enemy_psn);    ai_psn = SEL(P, enemy_psn, ai_psn);
+
+        ST(p_hp, p_hp);       ST(ai_hp, ai_hp);
+        ST(p_shield, p_shd);  ST(ai_shield, ai_shd);
+        ST(p_buff, p_buf);    ST(ai_buff, ai_buf);
+        ST(p_poison, p_psn);  ST(ai_poison, ai_psn);
+
+        game_over_vec(b, i, ok, p_hp, ai_hp);
+    }
+}
+
+__attribute__((target("avx2")))
+static void end_avx2(batch_t *b, size_t end) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi16(1);
+    const __m256i two  = _mm256_set1_epi16(2);
+    const __m256i all  = _mm256_set1_epi16(-1);
+
+    for (size_t i = 0; i < end; i += 16) {
+        __m256i p_psn = LD(p_poison), ai_psn = LD(ai_poison);
+        __m256i p_hp = LD(p_hp), ai_hp = LD(ai_hp);
+
+        __m256i pp = _mm256_cmpgt_epi16(p_psn, zero);
+        p_psn = _mm256_sub_epi16(p_psn, _mm256_and_si256(pp, one));
+        p_hp = SEL(pp, _mm256_max_epi16(_mm256_sub_epi16(p_hp, two), zero), p_hp);
+
+        __m256i ap = _mm256_cmpgt_epi16(ai_psn, zero);
+        ai_psn = _mm256_sub_epi16(ai_psn, _mm256_and_si256(ap, one));
+        ai_hp = SEL(ap, _mm256_max_epi16(_mm256_sub_epi16(ai_hp, two), zero), ai_hp);
+
+        ST(p_poison, p_psn); ST(ai_poison, ai_psn);
+        ST(p_hp, p_hp);      ST(ai_hp, ai_hp);
+
+        __m256i go = game_over_vec(b, i, all, p_hp, ai_hp);
+        __m256i alive = _mm256_cmpeq_epi16(go, zero);
+        __m256i turn = LD(turn);
+        ST(turn, SEL(alive, _mm256_xor_si256(turn, one), turn));
+        ST(mana, SEL(alive, LD(max_mana), LD(mana)));
+    }
+}
+
+#undef LD
+#undef ST
+#undef SEL
+#endif
+
+/* ---------- Dispatch ---------- */
+
+void batch_play(batch_t *b, const uint8_t *kind, int16_t *rc) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (g_use_simd) {
+        i = b->n & ~(size_t)15;
+        play_avx2(b, i, kind, rc);
+    }
+#endif
+    for (; i < b->n; i++) {
+        int16_t r = play_lane(b, i, kind[i]);
+        if (rc) rc[i] = r;
+    }
+}
+
+void batch_end_phase(batch_t *b) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (g_use_simd) {
+        i = b->n & ~(size_t)15;
+        end_avx2(b, i);
+    }
+#endif
+    for (; i < b->n; i++) end_lane(b, i);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "proto.h"
+
+/* ---------------------------
+ *  Batch engine (SoA, lockstep)
+ * ---------------------------
+ * The numeric rules of handle_play_card / apply_damage / tick_poison /
+ * check_game_over applied to many games at once. Every field is a
+ * contiguous int16 array (32-byte aligned) so a card play is a handful of
+ * masked vector ops. Uses AVX2 when the CPU has it, scalar otherwise.
+ * Results match the scalar engine field for field (see simbench verify).
+ * No hands and no logs: the caller picks the card per game.
+ */
+
+#define BATCH_NO_CARD 0xFF  // kind: no play for this game
+
+typedef struct {
+    size_t n;
+    int16_t *p_hp, *ai_hp;
+    int16_t *p_shield, *ai_shield;
+    int16_t *p_buff, *ai_buff;
+    int16_t *p_poison, *ai_poison; // uint8 in state_t, wraps the same way
+    int16_t *mana, *max_mana;
+    int16_t *turn;                 // 0 = player, 1 = AI
+    int16_t *game_over, *winner;
+} batch_t;
+
+int  batch_init(batch_t *b, size_t n);
+void batch_free(batch_t *b);
+
+void batch_load(batch_t *b, size_t i, const state_t *st);
+void batch_store(const batch_t *b, size_t i, state_t *st); // numeric fields only
+
+// Card kind = index into engine_draw_pool(), or BATCH_NO_CARD
+uint8_t batch_card_kind(uint16_t card_id);
+
+// One play per game for the side in turn[i]. rc[i] as handle_play_card:
+// 0 ok, -2 not enough mana, -3 invalid card / no play. rc may be NULL.
+void batch_play(batch_t *b, const uint8_t *kind, int16_t *rc);
+
+// END phase for every game: poison tick, game over check, next side, mana refill
+void batch_end_phase(batch_t *b);
+
+// 1 if the AVX2 path is used
+int batch_simd_enabled(void);
+
+// Force the scalar path (benchmarks, differential checks)
+void batch_force_scalar(int on);
@@ -1,40 +1,97 @@
 #include "cards.h"
 #include <stddef.h>
+#include <stdio.h>
 
 // Static Card Definitions
 // User's New Card System (IDs 100+)
+//
+// A card is a cost and a program of up to CARD_PROG_MAX effects, run in
+// order by the engine. type/value (the card's headline: the first effect
+// with an icon) and nprog are filled in by cards_init.
 
-static const card_def_t g_cards[] = {
-    // ID, TYPE, COST, VALUE, DUR, NAME
+#define FX(op, arg) { EF_##op, arg }
+#define CARD(id, cost, name, ...) { id, 0, cost, 0, 0, name, 0, { __VA_ARGS__ } }
+
+static card_def_t g_cards[] = {
+    // ID, COST, NAME, EFFECTS
     // ATK
-    { 100, CT_ATK,    1, 3, 0, "Slash" },
-    { 101, CT_ATK,    2, 5, 0, "Heavy Hit" },
-    { 102, CT_ATK,    3, 8, 0, "Execute" },
-    
+    CARD(100, 1, "Slash",        FX(DAMAGE, 3)),
+    CARD(101, 2, "Heavy Hit",    FX(DAMAGE, 5)),
+    CARD(102, 3, "Execute",      FX(DAMAGE, 8)),
+
     // HEAL
-    { 200, CT_HEAL,   2, 4, 0, "Bandage" },
-    { 201, CT_HEAL,   3, 7, 0, "Potion" },
-    
+    CARD(200, 2, "Bandage",      FX(HEAL, 4)),
+    CARD(201, 3, "Potion",       FX(HEAL, 7)),
+
     // SHIELD
-    { 300, CT_SHIELD, 1, 3, 0, "Block" },
-    { 301, CT_SHIELD, 2, 6, 0, "Barrier" },
-    
-    // BUFF (Value = amount to add to next attack)
-    { 400, CT_BUFF,   1, 2, 0, "Sharpen" },
-    { 401, CT_BUFF,   2, 4, 0, "Empower" },
-    
-    // POISON (Value = turns to add)
-    { 500, CT_POISON, 2, 2, 0, "Toxic Dagger" },
-    { 501, CT_POISON, 3, 3, 0, "Venom" }
+    CARD(300, 1, "Block",        FX(SHIELD, 3)),
+    CARD(301, 2, "Barrier",      FX(SHIELD, 6)),
+
+    // BUFF (adds to the next attack)
+    CARD(400, 1, "Sharpen",      FX(BUFF, 2)),
+    CARD(401, 2, "Empower",      FX(BUFF, 4)),
+
+    // POISON (turns to add)
+    CARD(500, 2, "Toxic Dagger", FX(POISON, 2)),
+    CARD(501, 3, "Venom",        FX(POISON, 3)),
+
+    // Composite (not in the draw pool yet)
+    CARD(600, 2, "Shield Bash",  FX(DAMAGE, 3), FX(SHIELD, 2)),
+    CARD(601, 3, "Venom Edge",   FX(POISON, 2), FX(BUFF, 2)),
+    CARD(602, 2, "Insight",      FX(DRAW, 1), FX(MANA, 1)),
 };
 
 #define CARD_COUNT (sizeof(g_cards)/sizeof(g_cards[0]))
 
-const card_def_t* get_card_def(uint16_t id) {
+// id -> index + 1 into g_cards, 0 = no such card (or its program is bad)
+static uint8_t g_by_id[CARD_ID_MAX];
+static int g_loaded;
+
+// effect -> the card type that draws its icon / text (0: none)
+static const uint8_t k_effect_type[EF_COUNT] = {
+    [EF_DAMAGE] = CT_ATK, [EF_HEAL] = CT_HEAL, [EF_SHIELD] = CT_SHIELD,
+    [EF_BUFF] = CT_BUFF, [EF_POISON] = CT_POISON,
+};
+
+// 0 if the engine can run c's program without any checks of its own
+static int validate(card_def_t *c) {
+    int n = 0;
+    while (n < CARD_PROG_MAX && c->prog[n].op != EF_END) {
+        const effect_t *e = &c->prog[n];
+        if (e->op >= EF_COUNT) return -1;
+        if (e->arg <= 0 || e->arg > 20) return -1;
+        if (e->op == EF_DRAW && e->arg > 8) return -1;
+        n++;
+    }
+    if (n == 0 || c->id == 0 || c->id >= CARD_ID_MAX) return -1;
+    c->nprog = (uint8_t)n;
+    for (int i = 0; i < n; i++) {
+        if (k_effect_type[c->prog[i].op]) {
+            c->type = k_effect_type[c->prog[i].op];
+            c->value = c->prog[i].arg;
+            break;
+        }
+    }
+    return 0;
+}
+
+int cards_init(void) {
+    if (g_loaded) return g_loaded > 0 ? 0 : -1;
+    int bad = 0;
     for (size_t i = 0; i < CARD_COUNT; i++) {
-        if (g_cards[i].id == id) {
-            return &g_cards[i];
+        if (validate(&g_cards[i]) != 0) {
+            fprintf(stderr, "[cards] card %u (%s): bad effect program\n",
+                    g_cards[i].id, g_cards[i].name);
+            bad++;
+            continue;
         }
+        g_by_id[g_cards[i].id] = (uint8_t)(i + 1);
     }
-    return NULL;
+    g_loaded = bad ? -1 : 1;
+    return bad ? -1 : 0;
+}
+
+const card_def_t* get_card_def(uint16_t id) {
+    if (id >= CARD_ID_MAX || g_by_id[id] == 0) return NULL;
+    return &g_cards[g_by_id[id] - 1];
 }
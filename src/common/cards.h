@@ -3,10 +3,15 @@
 
 #include "proto.h"
 
-// Returns NULL if id invalid
-const card_def_t* get_card_def(uint16_t id);
+// Card ids are below this (snapshots store them in 10 bits)
+#define CARD_ID_MAX 1024
+
+// Validates every card's effect program and builds the id table. Call once
+// at startup, before any thread or fork: 0 ok, -1 a card is bad (reported
+// on stderr and left out). Calling it again returns the same result.
+int cards_init(void);
 
-// Fills definitions array (optional if we expose global)
-// We will just expose a getter.
+// Returns NULL if id invalid (or cards_init has not run)
+const card_def_t* get_card_def(uint16_t id);
 
 #endif
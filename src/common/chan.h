@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+/* ---------------------------
+ *  Thread channels (GUI client)
+ * ---------------------------
+ * spsc_t: bounded single-producer / single-consumer ring of fixed-size
+ * entries. Push and pop never block and never take a lock; each push also
+ * bumps an eventfd so the consumer can sleep in poll() next to its socket.
+ *
+ * seqlock_t: one writer publishes a small struct, readers copy it out
+ * without ever waiting on the writer. A read that overlaps a write is
+ * retried; the writer only holds the odd sequence for one memcpy.
+ */
+
+#define CHAN_LINE 64
+
+typedef struct {
+    _Alignas(CHAN_LINE) _Atomic uint32_t head; // next slot to fill (producer)
+    _Alignas(CHAN_LINE) _Atomic uint32_t tail; // next slot to read (consumer)
+    _Alignas(CHAN_LINE) uint32_t mask;
+    uint32_t esz;
+    uint8_t *buf;
+    int efd;                                   // eventfd, readable while work may be queued
+} spsc_t;
+
+// cap is rounded up to a power of two. 0 ok, -1 on allocation/eventfd failure.
+int  spsc_init(spsc_t *q, uint32_t cap, uint32_t esz);
+void spsc_free(spsc_t *q);
+
+// Producer side. 0 ok, -1 ring full (entry dropped).
+int spsc_push(spsc_t *q, const void *e);
+
+// Consumer side. 0 ok, -1 empty.
+int spsc_pop(spsc_t *q, void *e);
+
+// Consumer side: clear the eventfd before draining with spsc_pop.
+void spsc_ack(spsc_t *q);
+
+static inline int spsc_fd(const spsc_t *q) { return q->efd; }
+
+typedef struct {
+    _Atomic uint32_t seq; // odd while a write is in progress
+} seqlock_t;
+
+#define SEQLOCK_INIT { 0 }
+
+// Single writer: copy n bytes of src into the published object.
+void seqlock_write(seqlock_t *l, void *obj, const void *src, size_t n);
+
+// Copy the published object into dst. Returns the (even) sequence of the
+// copy; it only changes when the writer publishes, so a reader can skip
+// work for a snapshot it has already seen.
+uint32_t seqlock_read(const seqlock_t *l, void *dst, const void *obj, size_t n);
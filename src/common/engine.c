@@ -0,0 +1,248 @@
+#include "engine.h"
+#include "evlog.h"
+#include <string.h>
+
+/* ---------- Game helpers ---------- */
+
+void apply_damage(int16_t *hp, int16_t *shield, int dmg) {
+    if (dmg <= 0) return;
+
+    if (*shield > 0) {
+        int s = (int)(*shield);
+        int used = (dmg < s) ? dmg : s;
+        *shield = (int16_t)(*shield - used);
+        dmg -= used;
+    }
+    if (dmg > 0) {
+        *hp = (int16_t)(*hp - dmg);
+        if (*hp < 0) *hp = 0;
+    }
+}
+
+void tick_poison(state_t *st, evlog_t *log) {
+    if (st->p_poison > 0) {
+        st->p_poison--;
+        st->p_hp = (int16_t)(st->p_hp - 2);
+        if (st->p_hp < 0) st->p_hp = 0;
+        if (log) evlog_push(log, EV_POISON_TICK, 0, 0, 2, st->mana);
+    }
+    if (st->ai_poison > 0) {
+        st->ai_poison--;
+        st->ai_hp = (int16_t)(st->ai_hp - 2);
+        if (st->ai_hp < 0) st->ai_hp = 0;
+        if (log) evlog_push(log, EV_POISON_TICK, 1, 0, 2, st->mana);
+    }
+}
+
+void check_game_over(state_t *st, evlog_t *log) {
+    if (st->game_over) return;
+    if (st->p_hp <= 0 || st->ai_hp <= 0) {
+        st->game_over = 1;
+        if (st->p_hp > st->ai_hp) st->winner = 1;
+        else if (st->ai_hp > st->p_hp) st->winner = 2;
+        else st->winner = 0;
+        if (log) evlog_push(log, EV_GAME_OVER, 0, 0, 0, st->mana);
+    }
+}
+
+// Pool of new IDs (uniform draw)
+static const uint16_t g_draw_pool[DRAW_POOL_SIZE] = {
+    100, 101, 102, // ATK
+    200, 201,      // HEAL
+    300, 301,      // SHIELD
+    400, 401,      // BUFF
+    500, 501       // POISON
+};
+
+const uint16_t* engine_draw_pool(void) {
+    return g_draw_pool;
+}
+
+uint32_t engine_rand(uint32_t *rng) {
+    // xorshift32: tiny, and the whole game replays from its seed
+    uint32_t x = *rng ? *rng : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *rng = x;
+}
+
+uint16_t rand_card_id(uint32_t *rng) {
+    return g_draw_pool[engine_rand(rng) % DRAW_POOL_SIZE];
+}
+
+void deal_hand(hand_t *h, uint32_t *rng) {
+    memset(h, 0, sizeof(*h));
+    h->n = HAND_DRAW;
+    for (int i = 0; i < HAND_DRAW; i++) h->card_ids[i] = rand_card_id(rng);
+}
+
+// Out of line: rare, and it would cost the common effects registers
+__attribute__((noinline))
+static void draw_cards(hand_t *hand, int n, uint32_t *rng) {
+    if (!rng) return; // prediction / search: the draw is unknown, skip it
+    for (; n > 0 && hand->n < 8; n--) hand->card_ids[hand->n++] = rand_card_id(rng);
+}
+
+int engine_play_card(state_t *st, hand_t *hand, int is_player, uint8_t idx, uint32_t *rng,
+                     evlog_t *log) {
+    if (idx >= hand->n) return -1;
+
+    uint16_t cid = hand->card_ids[idx];
+    if (cid == 0) return -3;
+
+    const card_def_t *c = get_card_def(cid);
+    if (!c) return -3;
+
+    if (c->cost > st->mana) return -2;
+    st->mana = (uint8_t)(st->mana - c->cost);
+
+    int16_t *self_hp     = is_player ? &st->p_hp     : &st->ai_hp;
+    int16_t *enemy_hp    = is_player ? &st->ai_hp    : &st->p_hp;
+    int16_t *self_shield = is_player ? &st->p_shield : &st->ai_shield;
+    int16_t *enemy_shield= is_player ? &st->ai_shield: &st->p_shield;
+    int16_t *self_buff   = is_player ? &st->p_buff   : &st->ai_buff;
+    uint8_t *enemy_poison= is_player ? &st->ai_poison : &st->p_poison;
+    uint8_t actor = is_player ? 0 : 1;
+
+    // The card's effect program. get_card_def only hands out programs that
+    // were validated by cards_init, so every op is known and args are in range.
+    int shown = 0; // the headline effect's amount for the log (every amount is >= 1)
+    for (const effect_t *e = c->prog, *end = c->prog + c->nprog; e < end; e++) {
+        int v = e->arg;
+        switch (e->op) {
+            case EF_DAMAGE:
+                v += *self_buff;
+                *self_buff = 0; // consume buff
+                apply_damage(enemy_hp, enemy_shield, v);
+                break;
+            case EF_HEAL:   *self_hp = (int16_t)(*self_hp + v); break;
+            case EF_SHIELD: *self_shield = (int16_t)(*self_shield + v); break;
+            case EF_BUFF:   *self_buff = (int16_t)(*self_buff + v); break;   // adds to NEXT attack
+            case EF_POISON: *enemy_poison = (uint8_t)(*enemy_poison + v); break; // adds TURNS
+            case EF_DRAW:   draw_cards(hand, v, rng); continue;
+            case EF_MANA: {
+                int m = st->mana + v;
+                st->mana = (uint8_t)(m > 99 ? 99 : m);
+            } continue;
+            default: __builtin_unreachable(); // ops checked at load
+        }
+        if (!shown) shown = v;
+    }
+    if (log) evlog_push(log, EV_PLAY, actor, cid, (int16_t)shown, st->mana);
+
+    check_game_over(st, log);
+    return 0;
+}
+
+int handle_play_card(state_t *st, hand_t *hand, int is_player, uint8_t idx, evlog_t *log) {
+    return engine_play_card(st, hand, is_player, idx, NULL, log);
+}
+
+int engine_play_quiet(state_t *st, hand_t *hand, int is_player, uint8_t idx) {
+    return engine_play_card(st, hand, is_player, idx, NULL, NULL);
+}
+
+void engine_end_quiet(state_t *st) {
+    st->phase = PHASE_END;
+    tick_poison(st, NULL);
+    check_game_over(st, NULL);
+}
+
+/* ---------- FSM ---------- */
+
+void enter_turn(state_t *st, hand_t *hand, int side, uint32_t *rng, evlog_t *log) {
+    st->turn = (uint8_t)side;
+    st->phase = PHASE_DRAW;
+    phase_draw(st, hand, rng, log);
+}
+
+void phase_draw(state_t *st, hand_t *hand, uint32_t *rng, evlog_t *log) {
+    st->mana = st->max_mana;
+    deal_hand(hand, rng);
+    if (log) evlog_push(log, EV_DRAW_PHASE, st->turn ? 1 : 0, 0, 0, st->mana);
+    st->phase = PHASE_MAIN;
+}
+
+void phase_end(state_t *st, hand_t *hand, uint32_t *rng, evlog_t *log) {
+    st->phase = PHASE_END;
+    if (log) evlog_push(log, EV_END_PHASE, st->turn ? 1 : 0, 0, 0, st->mana);
+    tick_poison(st, log);
+    check_game_over(st, log);
+    if (st->game_over) return;
+    int next_side = (st->turn == 0) ? 1 : 0;
+    enter_turn(st, hand, next_side, rng, log);
+}
+
+/* ---------- AI ---------- */
+
+int ai_eval_card(const state_t *st, const card_def_t *c) {
+    int score = 0;
+    if (st->ai_hp < 10 && c->type == CT_HEAL) score += 100;
+    if (st->p_shield > 0 && c->type == CT_BUFF) score += 40; // Break shield setup
+
+    switch (c->type) {
+        case CT_ATK: score += c->value; break;
+        case CT_POISON: if (st->p_poison == 0) score += 30; break;
+        case CT_SHIELD: if (st->ai_shield == 0) score += 20; break;
+        default: break;
+    }
+    score -= (c->cost * 2);
+    return score;
+}
+
+int ai_pick_greedy(const state_t *st, const hand_t *hand, void *ctx) {
+    (void)ctx;
+    int best_idx = -1;
+    int best_score = -9999;
+
+    for (int i = 0; i < hand->n; i++) {
+        uint16_t cid = hand->card_ids[i];
+        if (cid == 0) continue;
+        const card_def_t *c = get_card_def(cid);
+        if (!c) continue;
+        if (c->cost <= st->mana) {
+            int score = ai_eval_card(st, c);
+            // ties go to the lower card id, not the earlier slot: the pick
+            // depends on the hand's contents only
+            if (best_idx < 0 || score > best_score ||
+                (score == best_score && cid < hand->card_ids[best_idx])) {
+                best_score = score;
+                best_idx = i;
+            }
+        }
+    }
+    return best_idx;
+}
+
+void state_mirror(const state_t *in, state_t *out) {
+    *out = *in;
+    out->p_hp = in->ai_hp;         out->ai_hp = in->p_hp;
+    out->p_shield = in->ai_shield; out->ai_shield = in->p_shield;
+    out->p_buff = in->ai_buff;     out->ai_buff = in->p_buff;
+    out->p_poison = in->ai_poison; out->ai_poison = in->p_poison;
+    out->turn = (uint8_t)(in->turn ? 0 : 1);
+    if (in->winner == 1) out->winner = 2;
+    else if (in->winner == 2) out->winner = 1;
+}
+
+int ai_turn_step(state_t *st, hand_t *hand, const ai_policy_t *pol, uint32_t *rng,
+                 evlog_t *log) {
+    if (st->phase != PHASE_MAIN || st->game_over) return 0;
+    int best_idx = pol->pick(st, hand, pol->ctx);
+    if (best_idx < 0 || best_idx >= hand->n ||
+        engine_play_card(st, hand, 0, (uint8_t)best_idx, rng, log) != 0) return 0;
+    hand->card_ids[best_idx] = 0;
+    return 1;
+}
+
+void process_ai_turn_with(state_t *st, hand_t *hand, const ai_policy_t *pol, uint32_t *rng,
+                          evlog_t *log) {
+    while (ai_turn_step(st, hand, pol, rng, log)) {}
+    if (!st->game_over) phase_end(st, hand, rng, log);
+}
+
+void process_ai_turn(state_t *st, hand_t *hand, uint32_t *rng, evlog_t *log) {
+    static const ai_policy_t greedy = { ai_pick_greedy, NULL };
+    process_ai_turn_with(st, hand, &greedy, rng, log);
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "proto.h"
+#include "cards.h"
+
+/* ---------------------------
+ *  Game rules (authoritative)
+ * ---------------------------
+ * Shared by the server and any tool that needs to simulate games.
+ */
+
+void apply_damage(int16_t *hp, int16_t *shield, int dmg);
+// log: where the events go, NULL = none (search / simulation)
+void tick_poison(state_t *st, evlog_t *log);
+void check_game_over(state_t *st, evlog_t *log);
+
+#define DRAW_POOL_SIZE 11
+#define HAND_DRAW      3
+
+const uint16_t* engine_draw_pool(void); // DRAW_POOL_SIZE ids, drawn uniformly
+
+// Per-game RNG: all draws come from *rng, so a game replays from its seed
+uint32_t engine_rand(uint32_t *rng);
+uint16_t rand_card_id(uint32_t *rng);
+void deal_hand(hand_t *h, uint32_t *rng);
+
+// 0 ok, -1 invalid idx, -2 not enough mana, -3 invalid card
+int handle_play_card(state_t *st, hand_t *hand, int is_player, uint8_t idx, evlog_t *log);
+// Same, with the game's rng for draw effects (handle_play_card: no draws)
+int engine_play_card(state_t *st, hand_t *hand, int is_player, uint8_t idx, uint32_t *rng,
+                     evlog_t *log);
+
+// FSM
+void enter_turn(state_t *st, hand_t *hand, int side, uint32_t *rng, evlog_t *log);
+void phase_draw(state_t *st, hand_t *hand, uint32_t *rng, evlog_t *log);
+void phase_end(state_t *st, hand_t *hand, uint32_t *rng, evlog_t *log);
+
+// Same rules without events (search / simulation hot loops)
+int  engine_play_quiet(state_t *st, hand_t *hand, int is_player, uint8_t idx);
+void engine_end_quiet(state_t *st); // END phase: poison tick + game over check, no draw
+
+/* ---------------------------
+ *  AI
+ * ---------------------------
+ * A policy picks the next hand index to play for the AI side, or -1 to end the turn.
+ */
+typedef int (*ai_pick_fn)(const state_t *st, const hand_t *hand, void *ctx);
+
+typedef struct {
+    ai_pick_fn pick;
+    void *ctx;
+} ai_policy_t;
+
+int ai_eval_card(const state_t *st, const card_def_t *c);
+int ai_pick_greedy(const state_t *st, const hand_t *hand, void *ctx); // ties: lowest card id
+
+// Same position seen from the other seat (p_* <-> ai_*, turn and winner
+// flipped), so AI policies can choose the player's moves.
+void state_mirror(const state_t *in, state_t *out);
+
+// One AI play: 1 a card was played, 0 the turn's plays are over (the
+// policy passed, its pick was refused, or the game ended). The caller ends
+// the turn with phase_end unless the game is over. rng as engine_play_card.
+int ai_turn_step(state_t *st, hand_t *hand, const ai_policy_t *pol, uint32_t *rng,
+                 evlog_t *log);
+
+void process_ai_turn(state_t *st, hand_t *hand, uint32_t *rng, evlog_t *log); // greedy
+void process_ai_turn_with(state_t *st, hand_t *hand, const ai_policy_t *pol, uint32_t *rng,
+                          evlog_t *log);
@@ -0,0 +1,122 @@
+#include "evlog.h"
+#include "cards.h"
+#include <stdio.h>
+#include <string.h>
+
+void evlog_push(evlog_t *log, uint8_t kind, uint8_t actor, uint16_t card_id, int16_t amount,
+                uint8_t mana) {
+    game_event_t *ev = &log->events[log->head % LOG_LINES];
+    ev->kind = kind;
+    ev->actor = actor;
+    ev->card_id = card_id;
+    ev->amount = amount;
+    ev->mana = mana;
+    log->head = (uint8_t)((log->head + 1) % LOG_LINES);
+}
+
+const game_event_t* evlog_at(const evlog_t *log, int i) {
+    return &log->events[(log->head + i) % LOG_LINES];
+}
+
+int evlog_format(const game_event_t *ev, char *buf, size_t n) {
+    const char *who = ev->actor ? "AI" : "P";
+
+    switch (ev->kind) {
+        case EV_PLAY: {
+            const card_def_t *c = get_card_def(ev->card_id);
+            int type = c ? c->type : 0;
+            switch (type) {
+                case CT_ATK:
+                    return snprintf(buf, n, "%s ATK (%d) [mana %u]", who, ev->amount, ev->mana);
+                case CT_HEAL:
+                    return snprintf(buf, n, "%s HEAL (+%d) [mana %u]", who, ev->amount, ev->mana);
+                case CT_SHIELD:
+                    return snprintf(buf, n, "%s SHIELD (+%d) [mana %u]", who, ev->amount, ev->mana);
+                case CT_BUFF:
+                    return snprintf(buf, n, "%s BUFF (+%d next) [mana %u]", who, ev->amount, ev->mana);
+                case CT_POISON:
+                    return snprintf(buf, n, "%s POISON (+%d turns) [mana %u]", who, ev->amount, ev->mana);
+                default:
+                    return snprintf(buf, n, "%s PLAY #%u [mana %u]", who, ev->card_id, ev->mana);
+            }
+        }
+        case EV_POISON_TICK: return snprintf(buf, n, "%s takes poison (-%d)", who, ev->amount);
+        case EV_DRAW_PHASE:  return snprintf(buf, n, "%s: DRAW PHASE", who);
+        case EV_END_PHASE:   return snprintf(buf, n, "%s: END PHASE", who);
+        case EV_GAME_OVER:   return snprintf(buf, n, "GAME OVER");
+        case EV_RESUMED:     return snprintf(buf, n, "Player Resumed Session");
+        default:
+            if (n) buf[0] = '\0';
+            return 0;
+    }
+}
+
+void state_pack(const state_t *st, const evlog_t *log, state_wire_t *out) {
+    out->p_hp = st->p_hp;           out->ai_hp = st->ai_hp;
+    out->turn = st->turn;           out->phase = st->phase;
+    out->game_over = st->game_over; out->winner = st->winner;
+    out->mana = st->mana;           out->max_mana = st->max_mana;
+    out->p_shield = st->p_shield;   out->ai_shield = st->ai_shield;
+    out->p_buff = st->p_buff;       out->ai_buff = st->ai_buff;
+    out->p_poison = st->p_poison;   out->ai_poison = st->ai_poison;
+    out->ev_head = log->head;
+    memcpy(out->events, log->events, sizeof(out->events));
+}
+
+void state_unpack(const state_wire_t *in, state_t *st, evlog_t *log) {
+    st->p_hp = in->p_hp;           st->ai_hp = in->ai_hp;
+    st->turn = in->turn;           st->phase = in->phase;
+    st->game_over = in->game_over; st->winner = in->winner;
+    st->mana = in->mana;           st->max_mana = in->max_mana;
+    st->p_shield = in->p_shield;   st->ai_shield = in->ai_shield;
+    st->p_buff = in->p_buff;       st->ai_buff = in->ai_buff;
+    st->p_poison = in->p_poison;   st->ai_poison = in->ai_poison;
+    if (log) {
+        log->head = in->ev_head;
+        memcpy(log->events, in->events, sizeof(log->events));
+    }
+}
+
+void state_to_legacy(const state_t *st, const evlog_t *log, state_legacy_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->p_hp = st->p_hp;           out->ai_hp = st->ai_hp;
+    out->turn = st->turn;           out->phase = st->phase;
+    out->game_over = st->game_over; out->winner = st->winner;
+    out->mana = st->mana;           out->max_mana = st->max_mana;
+    out->p_shield = st->p_shield;   out->ai_shield = st->ai_shield;
+    out->p_buff = st->p_buff;       out->ai_buff = st->ai_buff;
+    out->p_poison = st->p_poison;   out->ai_poison = st->ai_poison;
+
+    // same ring position, so old clients read lines in the same order
+    out->log_head = log->head;
+    for (int i = 0; i < LOG_LINES; i++)
+        evlog_format(&log->events[i], out->logs[i], sizeof(out->logs[i]));
+}
+
+void state_from_legacy(const state_legacy_t *in, state_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->p_hp = in->p_hp;           out->ai_hp = in->ai_hp;
+    out->turn = in->turn;           out->phase = in->phase;
+    out->game_over = in->game_over; out->winner = in->winner;
+    out->mana = in->mana;           out->max_mana = in->max_mana;
+    out->p_shield = in->p_shield;   out->ai_shield = in->ai_shield;
+    out->p_buff = in->p_buff;       out->ai_buff = in->ai_buff;
+    out->p_poison = in->p_poison;   out->ai_poison = in->ai_poison;
+}
+
+int state_decode(const void *payload, uint32_t plen, state_t *st, evlog_t *log) {
+    if (plen == sizeof(state_wire_t)) {
+        state_wire_t w;
+        memcpy(&w, payload, sizeof(w));
+        state_unpack(&w, st, log);
+        return 0;
+    }
+    if (plen == sizeof(state_legacy_t)) {
+        state_legacy_t lg;
+        memcpy(&lg, payload, sizeof(lg));
+        state_from_legacy(&lg, st);
+        if (log) memset(log, 0, sizeof(*log));
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stddef.h>
+#include "proto.h"
+
+/* ---------------------------
+ *  Event log (evlog_t)
+ * ---------------------------
+ * The server only records binary events; text exists on the client side
+ * (or in the legacy wire path) and is produced on demand. The ring lives
+ * next to the game's state_t, not in it: the rules never read it.
+ */
+
+// mana: the mana left after the event (st->mana)
+void evlog_push(evlog_t *log, uint8_t kind, uint8_t actor, uint16_t card_id, int16_t amount,
+                uint8_t mana);
+
+// i = 0 is the oldest entry; kind == EV_NONE for unused slots
+const game_event_t* evlog_at(const evlog_t *log, int i);
+
+// Text of one event, same wording as the old server log lines ("" for EV_NONE)
+int evlog_format(const game_event_t *ev, char *buf, size_t n);
+
+// Wire forms (state_wire_t / state_legacy_t <-> state_t + evlog_t)
+void state_pack(const state_t *st, const evlog_t *log, state_wire_t *out);
+void state_unpack(const state_wire_t *in, state_t *st, evlog_t *log); // log may be NULL
+void state_to_legacy(const state_t *st, const evlog_t *log, state_legacy_t *out);
+void state_from_legacy(const state_legacy_t *in, state_t *out); // events are dropped
+
+// Accepts either OP_STATE payload; 0 ok, -1 unknown size.
+// log may be NULL; a legacy payload leaves it empty.
+int state_decode(const void *payload, uint32_t plen, state_t *st, evlog_t *log);
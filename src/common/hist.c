@@ -0,0 +1,60 @@
+#include "hist.h"
+#include <string.h>
+
+static unsigned bucket_of(uint64_t v) {
+    if (v < HIST_SUB) return (unsigned)v;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    unsigned shift = msb - HIST_SUB_BITS;
+    // (shift + 1) is the power-of-two group; the top HIST_SUB_BITS below msb pick the slot
+    return (shift + 1) * HIST_SUB + (unsigned)((v >> shift) & (HIST_SUB - 1));
+}
+
+static uint64_t bucket_top(unsigned i) {
+    if (i < HIST_SUB) return i;
+    unsigned shift = i / HIST_SUB - 1;
+    uint64_t base = (uint64_t)(HIST_SUB + i % HIST_SUB) << shift;
+    return base + (((uint64_t)1 << shift) - 1);
+}
+
+void hist_init(hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void hist_add(hist_t *h, uint64_t v) {
+    h->b[bucket_of(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+}
+
+void hist_merge(hist_t *dst, const hist_t *src) {
+    if (!src->count) return;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) dst->b[i] += src->b[i];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t hist_quantile(const hist_t *h, double q) {
+    if (!h->count) return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->count) rank = h->count;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->b[i];
+        if (seen >= rank) {
+            uint64_t top = bucket_top(i);
+            return top > h->max ? h->max : top;
+        }
+    }
+    return h->max;
+}
+
+double hist_mean(const hist_t *h) {
+    return h->count ? (double)h->sum / (double)h->count : 0.0;
+}
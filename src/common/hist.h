@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+/* ---------------------------
+ *  Latency histogram
+ * ---------------------------
+ * Log-linear buckets (HdrHistogram style): 32 sub-buckets per power of two,
+ * so any recorded value is reported within ~3%. Fixed size, no allocation;
+ * histograms from different threads/processes merge by adding counts.
+ * Values are unsigned (ns for latencies).
+ */
+
+#define HIST_SUB_BITS 5
+#define HIST_SUB      (1u << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min, max;
+    uint64_t b[HIST_BUCKETS];
+} hist_t;
+
+void hist_init(hist_t *h);
+void hist_add(hist_t *h, uint64_t v);
+void hist_merge(hist_t *dst, const hist_t *src);
+
+// Value at quantile q (0..1): upper edge of the bucket, clamped to max. 0 if empty.
+uint64_t hist_quantile(const hist_t *h, double q);
+double   hist_mean(const hist_t *h);
@@ -1,3 +1,4 @@
+#define _DEFAULT_SOURCE
 #include "ipc.h"
 #include "proto.h"
 #include <sys/mman.h>
@@ -6,6 +7,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
 
 shm_stats_t* ipc_stats_init(int create) {
     int oflags = O_RDWR;
@@ -37,6 +41,29 @@ void ipc_stats_inc_conn(shm_stats_t *s) {
 void ipc_stats_inc_pkt(shm_stats_t *s) {
     __sync_fetch_and_add(&s->total_packets, 1);
 }
+void ipc_stats_inc_flush(shm_stats_t *s) {
+    __sync_fetch_and_add(&s->total_flushes, 1);
+}
+void ipc_stats_add_ai(shm_stats_t *s, uint64_t searches, uint64_t nodes,
+                      uint64_t probes, uint64_t hits, uint64_t ns) {
+    __sync_fetch_and_add(&s->ai_searches, searches);
+    __sync_fetch_and_add(&s->ai_nodes, nodes);
+    __sync_fetch_and_add(&s->ai_tt_probes, probes);
+    __sync_fetch_and_add(&s->ai_tt_hits, hits);
+    __sync_fetch_and_add(&s->ai_search_ns, ns);
+}
+
+void ipc_stats_add_ai_turn(shm_stats_t *s, uint64_t ns) {
+    __sync_fetch_and_add(&s->ai_turns, 1);
+    __sync_fetch_and_add(&s->ai_turn_ns, ns);
+}
+void ipc_stats_add_spec(shm_stats_t *s, int take_rc, uint64_t runs, uint64_t cancels) {
+    if (take_rc > 0) __sync_fetch_and_add(&s->spec_hits, 1);
+    else __sync_fetch_and_add(&s->spec_misses, 1);
+    if (take_rc == 2) __sync_fetch_and_add(&s->spec_late, 1);
+    if (runs) __sync_fetch_and_add(&s->spec_runs, runs);
+    if (cancels) __sync_fetch_and_add(&s->spec_cancels, cancels);
+}
 
 shm_store_t* ipc_store_init(int create) {
     int oflags = O_RDWR;
@@ -45,76 +72,296 @@ shm_store_t* ipc_store_init(int create) {
     int fd = shm_open(STORE_MAGIC_SHM, oflags, 0600);
     if (fd < 0) return NULL;
 
+    // truncating to 0 first zeroes an old object without touching its pages:
+    // slots (and logs) take memory only once a game has used them
     if (create) {
-        if (ftruncate(fd, sizeof(shm_store_t)) != 0) { close(fd); return NULL; }
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof(shm_store_t)) != 0) { close(fd); return NULL; }
     }
 
     void *p = mmap(NULL, sizeof(shm_store_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
     close(fd);
     if (p == MAP_FAILED) return NULL;
 
+    shm_store_t *store = p;
+    if (create) store->keep_log = 1;
+    return store;
+}
+
+// The low bits of a session id are its slot, so lookups are O(1).
+static session_entry_t* find_session(shm_store_t *store, uint64_t sid) {
+    session_entry_t *e = &store->sessions[sid & (MAX_SESSIONS - 1)];
+    return (e->valid && e->session_id == sid) ? e : NULL;
+}
+
+// session_id of a slot being claimed: no lookup matches it, no other
+// worker takes the slot over
+#define SID_CLAIMING UINT64_MAX
+
+uint64_t ipc_alloc_session(shm_store_t *store, uint8_t tier) {
+    uint32_t now = (uint32_t)time(NULL);
+    uint32_t start = (uint32_t)rand();
+
+    for (uint32_t k = 0; k < MAX_SESSIONS; k++) {
+        uint32_t i = (start + k) & (MAX_SESSIONS - 1);
+        session_entry_t *e = &store->sessions[i];
+
+        // Claim a free slot, or take over one whose game was abandoned.
+        // Workers race here: the one CAS on session_id (old -> SID_CLAIMING)
+        // decides. session_id is read first: a winner publishes it last, so
+        // whoever sees the new id also sees its valid flag and last_seen.
+        uint64_t old = __atomic_load_n(&e->session_id, __ATOMIC_ACQUIRE);
+        if (old == SID_CLAIMING) continue;
+        int free_slot = !__atomic_load_n(&e->valid, __ATOMIC_ACQUIRE);
+        uint32_t seen = __atomic_load_n(&e->last_seen, __ATOMIC_RELAXED);
+        int expired = (int32_t)(now - seen) > SESSION_TTL_SEC; // signed: a save may postdate now
+        if (!free_slot && !expired) continue;
+        if (!__sync_bool_compare_and_swap(&e->session_id, old, SID_CLAIMING)) continue;
+        if (!free_slot && __atomic_load_n(&e->last_seen, __ATOMIC_ACQUIRE) != seen) {
+            // its owner came back just before the claim: leave the game be
+            __atomic_store_n(&e->session_id, old, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        uint64_t r = ((uint64_t)rand() << 31) ^ (uint64_t)rand() ^ ((uint64_t)getpid() << 40);
+        uint64_t sid = (r << STORE_SLOT_BITS) | i;
+        if (sid == 0 || sid == SID_CLAIMING) sid = ((uint64_t)1 << STORE_SLOT_BITS) | i;
+
+        e->last_seen = now;
+        e->tier = tier;
+        e->valid = 1;
+        __atomic_store_n(&e->session_id, sid, __ATOMIC_RELEASE);
+        return sid;
+    }
+    return 0; // full: every slot is in use by a live game
+}
+
+void ipc_release_session(shm_store_t *store, uint64_t sid) {
+    session_entry_t *e = find_session(store, sid);
+    if (e) __sync_bool_compare_and_swap(&e->valid, 1, 0);
+}
+
+int ipc_save_session(shm_store_t *store, uint64_t sid, const state_t *st, const evlog_t *log,
+                     const hand_t *h, uint32_t rng) {
+    session_entry_t *e = find_session(store, sid);
+    if (!e || snap_encode(&e->snap, st, h, rng) != 0) return -1;
+    if (store->keep_log) store->logs[e - store->sessions] = *log;
+    e->last_seen = (uint32_t)time(NULL);
+    return 0;
+}
+
+int ipc_load_session(shm_store_t *store, uint64_t sid, state_t *st, evlog_t *log,
+                     hand_t *h, uint32_t *rng) {
+    session_entry_t *e = find_session(store, sid);
+    if (!e) return -1;
+    snap_decode(&e->snap, st, h, rng);
+    if (store->keep_log) *log = store->logs[e - store->sessions];
+    else memset(log, 0, sizeof(*log));
+    e->last_seen = (uint32_t)time(NULL);
+    return 0;
+}
+
+int ipc_touch_session(shm_store_t *store, uint64_t sid) {
+    session_entry_t *e = find_session(store, sid);
+    if (!e) return -1;
+    e->last_seen = (uint32_t)time(NULL);
+    return 0;
+}
+
+int ipc_session_tier(shm_store_t *store, uint64_t sid) {
+    session_entry_t *e = find_session(store, sid);
+    return e ? e->tier : -1;
+}
+
+/* --- AI Decision Cache --- */
+
+shm_aicache_t* ipc_aicache_init(int create) {
+    int oflags = O_RDWR;
+    if (create) oflags |= O_CREAT;
+
+    int fd = shm_open(AICACHE_MAGIC_SHM, oflags, 0600);
+    if (fd < 0) return NULL;
+
     if (create) {
-        shm_store_t zero;
-        memset(&zero, 0, sizeof(zero));
-        memcpy(p, &zero, sizeof(zero));
+        if (ftruncate(fd, sizeof(shm_aicache_t)) != 0) { close(fd); return NULL; }
+    }
+
+    void *p = mmap(NULL, sizeof(shm_aicache_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+
+    if (create) memset(p, 0, sizeof(shm_aicache_t));
+    return (shm_aicache_t*)p;
+}
+
+static aicache_set_t* aicache_set_for(shm_aicache_t *c, uint64_t k0, uint64_t k1) {
+    uint64_t h = (k0 ^ (k1 * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+    return &c->sets[(h >> 32) % AICACHE_SETS];
+}
+
+int ipc_aicache_get(shm_aicache_t *c, uint64_t k0, uint64_t k1, int32_t *value_out) {
+    aicache_set_t *set = aicache_set_for(c, k0, k1);
+    if (__sync_lock_test_and_set(&set->lock, 1)) {
+        __sync_fetch_and_add(&c->busy, 1);
+        __sync_fetch_and_add(&c->misses, 1);
+        return -1;
     }
-    return (shm_store_t*)p;
-}
-
-uint64_t ipc_alloc_session(shm_store_t *store) {
-    // simple linear search for empty slot
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        // Warning: this check is not atomic against other processes, 
-        // but since we only have one main parent deciding (or low concurrency fork), it's acceptable for MVP.
-        // Actually forks are per connection. Collision possible if multiple logins happen EXACTLY same time.
-        // But store is pre-check. 
-        if (!store->sessions[i].valid) {
-            store->sessions[i].valid = 1;
-            uint64_t sid = (uint64_t)time(NULL) + (uint64_t)i + (uint64_t)getpid(); 
-            // Better random SID
-            sid = sid ^ ((uint64_t)rand() << 32);
-            if (sid == 0) sid = 1;
-            
-            store->sessions[i].session_id = sid;
-            store->sessions[i].last_seen = time(NULL);
-            return sid;
+
+    int rc = -1;
+    for (int i = 0; i < AICACHE_WAYS; i++) {
+        aicache_slot_t *sl = &set->slot[i];
+        if (sl->k0 == k0 && sl->k1 == k1) {
+            sl->ref = 1;
+            *value_out = sl->value;
+            rc = 0;
+            break;
         }
     }
-    // Try to recycle oldest? 
-    // For now return 0 (fail) if full.
-    return 0;
+    __sync_lock_release(&set->lock);
+
+    __sync_fetch_and_add(rc == 0 ? &c->hits : &c->misses, 1);
+    return rc;
 }
 
-int ipc_save_session(shm_store_t *store, uint64_t sid, const state_t *st, const hand_t *h) {
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (store->sessions[i].valid && store->sessions[i].session_id == sid) {
-            store->sessions[i].st = *st;
-            store->sessions[i].hand = *h;
-            store->sessions[i].last_seen = time(NULL);
-            return 0;
+void ipc_aicache_put(shm_aicache_t *c, uint64_t k0, uint64_t k1, int32_t value) {
+    if (k0 == 0) return;
+    aicache_set_t *set = aicache_set_for(c, k0, k1);
+    if (__sync_lock_test_and_set(&set->lock, 1)) {
+        __sync_fetch_and_add(&c->busy, 1);
+        return;
+    }
+
+    aicache_slot_t *victim = NULL;
+    for (int i = 0; i < AICACHE_WAYS; i++) {
+        aicache_slot_t *sl = &set->slot[i];
+        if ((sl->k0 == k0 && sl->k1 == k1) || sl->k0 == 0) { victim = sl; break; }
+    }
+
+    if (!victim) {
+        // CLOCK: clear reference bits until an unreferenced slot comes up
+        for (;;) {
+            aicache_slot_t *sl = &set->slot[set->hand];
+            set->hand = (set->hand + 1) % AICACHE_WAYS;
+            if (sl->ref) { sl->ref = 0; continue; }
+            victim = sl;
+            break;
         }
+        __sync_fetch_and_add(&c->evictions, 1);
     }
-    return -1;
+
+    victim->k0 = k0;
+    victim->k1 = k1;
+    victim->value = value;
+    victim->ref = 1;
+    __sync_lock_release(&set->lock);
+
+    __sync_fetch_and_add(&c->inserts, 1);
 }
 
-int ipc_load_session(shm_store_t *store, uint64_t sid, state_t *st, hand_t *h) {
-    for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (store->sessions[i].valid && store->sessions[i].session_id == sid) {
-            *st = store->sessions[i].st;
-            *h  = store->sessions[i].hand;
-            store->sessions[i].last_seen = time(NULL);
-            return 0;
+/* --- AI CPU budget --- */
+
+shm_aisched_t* ipc_aisched_init(int create) {
+    int oflags = O_RDWR;
+    if (create) oflags |= O_CREAT;
+
+    int fd = shm_open(AISCHED_MAGIC_SHM, oflags, 0600);
+    if (fd < 0) return NULL;
+
+    if (create) {
+        if (ftruncate(fd, sizeof(shm_aisched_t)) != 0) { close(fd); return NULL; }
+    }
+
+    void *p = mmap(NULL, sizeof(shm_aisched_t), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return NULL;
+
+    shm_aisched_t *s = (shm_aisched_t*)p;
+    if (create) {
+        memset(s, 0, sizeof(*s));
+        pthread_mutexattr_t ma;
+        pthread_mutexattr_init(&ma);
+        pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&s->mu, &ma);
+        pthread_mutexattr_destroy(&ma);
+
+        pthread_condattr_t ca;
+        pthread_condattr_init(&ca);
+        pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+        pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+        pthread_cond_init(&s->cv, &ca);
+        pthread_condattr_destroy(&ca);
+
+        s->slots = 1;
+        s->deadline_ms = 100;
+    }
+    return s;
+}
+
+static void aisched_lock(shm_aisched_t *s) {
+    // the previous owner died in here: the counters are still usable
+    if (pthread_mutex_lock(&s->mu) == EOWNERDEAD) pthread_mutex_consistent(&s->mu);
+}
+
+static long long mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// A free slot, after taking back those of workers that are gone; -1 none
+static int aisched_claim(shm_aisched_t *s) {
+    uint32_t n = s->slots < AISCHED_MAX_SLOTS ? s->slots : AISCHED_MAX_SLOTS;
+    for (uint32_t i = 0; i < n; i++) {
+        if (s->owner[i] && kill(s->owner[i], 0) != 0 && errno == ESRCH) {
+            s->owner[i] = 0;
+            s->running--;
+            s->reclaimed++;
+        }
+        if (s->owner[i] == 0) {
+            s->owner[i] = (int32_t)getpid();
+            s->running++;
+            s->admitted++;
+            return (int)i;
         }
     }
     return -1;
 }
 
-int ipc_touch_session(shm_store_t *store, uint64_t sid) {
-     for (int i = 0; i < MAX_SESSIONS; i++) {
-        if (store->sessions[i].valid && store->sessions[i].session_id == sid) {
-            store->sessions[i].last_seen = time(NULL);
-            return 0;
+int ipc_aisched_acquire(shm_aisched_t *s) {
+    aisched_lock(s);
+    int slot = s->queued ? -1 : aisched_claim(s); // no overtaking the queue
+    if (slot >= 0) { pthread_mutex_unlock(&s->mu); return slot; }
+    if (s->queue_max && s->queued >= s->queue_max) {
+        s->shed++;
+        pthread_mutex_unlock(&s->mu);
+        return -2;
+    }
+
+    long long t0 = mono_ns(), end = t0 + (long long)s->deadline_ms * 1000000LL;
+    struct timespec ts = { .tv_sec = end / 1000000000LL, .tv_nsec = end % 1000000000LL };
+    if (++s->queued > s->queued_peak) s->queued_peak = s->queued;
+    for (;;) {
+        int rc = pthread_cond_timedwait(&s->cv, &s->mu, &ts);
+        if (rc == EOWNERDEAD) pthread_mutex_consistent(&s->mu);
+        if ((slot = aisched_claim(s)) >= 0) {
+            s->waited++;
+            s->wait_ns += (uint64_t)(mono_ns() - t0);
+            break;
         }
+        if (rc == ETIMEDOUT || mono_ns() >= end) { s->deadline_misses++; break; }
     }
-    return -1;
-}
\ No newline at end of file
+    s->queued--;
+    pthread_mutex_unlock(&s->mu);
+    return slot >= 0 ? slot : -1;
+}
+
+void ipc_aisched_release(shm_aisched_t *s, int slot) {
+    if (slot < 0 || slot >= AISCHED_MAX_SLOTS) return;
+    aisched_lock(s);
+    if (s->owner[slot] == (int32_t)getpid()) {
+        s->owner[slot] = 0;
+        s->running--;
+    }
+    pthread_cond_signal(&s->cv);
+    pthread_mutex_unlock(&s->mu);
+}
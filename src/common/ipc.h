@@ -1,36 +1,135 @@
 #pragma once
 #include <stdint.h>
+#include <pthread.h>
 
 typedef struct {
     uint64_t total_connections;
     uint64_t total_packets;
+    uint64_t total_flushes;   // response writes: total_packets / total_flushes = requests per write
+
+    // search AI (server --ai search)
+    uint64_t ai_searches;
+    uint64_t ai_nodes;
+    uint64_t ai_tt_probes;
+    uint64_t ai_tt_hits;
+    uint64_t ai_search_ns;
+
+    // every AI turn, any policy
+    uint64_t ai_turns;
+    uint64_t ai_turn_ns;
+
+    // AI speculation: END_TURNs whose AI turn was precomputed (late = had to
+    // wait for the run to finish); runs finished, and stopped because the
+    // position changed
+    uint64_t spec_hits;
+    uint64_t spec_late;
+    uint64_t spec_misses;
+    uint64_t spec_runs;
+    uint64_t spec_cancels;
 } shm_stats_t;
 
 // Session Store
 #include "proto.h"
+#include "snap.h"
 #include <time.h>
 
-#define MAX_SESSIONS 128
-#define STORE_MAGIC_SHM "/tcg_store_v1"
+#define STORE_SLOT_BITS 16
+#define MAX_SESSIONS    (1u << STORE_SLOT_BITS)  // session_id & (MAX_SESSIONS-1) = slot
+#define SESSION_TTL_SEC 120                      // idle unfinished games can be resumed this long
+#define STORE_MAGIC_SHM "/tcg_store_v4"
 
+// 48 bytes: what slot scans and every save touch
 typedef struct {
     uint64_t session_id;
-    time_t   last_seen;
-    state_t  st;
-    hand_t   hand;
-    int      valid;
+    uint32_t last_seen; // time(NULL)
+    uint8_t  tier;      // ai_tier_t from the login: a resumed game keeps its AI
+    uint8_t  valid;
+    snap_t   snap;      // state (no events), hand and game RNG
 } session_entry_t;
 
 typedef struct {
+    uint32_t keep_log;  // 0: logs[] is never written, resumed games start with an empty log
     session_entry_t sessions[MAX_SESSIONS];
+    evlog_t         logs[MAX_SESSIONS];  // the event rings, kept apart: only a resume reads them
 } shm_store_t;
 
+// AI Decision Cache (set-associative, CLOCK eviction within a set)
+#define AICACHE_MAGIC_SHM "/tcg_aicache_v1"
+#define AICACHE_SETS 4096
+#define AICACHE_WAYS 8
+
+typedef struct {
+    uint64_t k0, k1;   // canonical key, k0 == 0 means empty
+    int32_t  value;    // cached decision
+    uint32_t ref;      // CLOCK reference bit
+} aicache_slot_t;
+
+typedef struct {
+    uint32_t lock;     // try-lock only: a busy set is a miss, never a wait
+    uint32_t hand;     // CLOCK hand
+    aicache_slot_t slot[AICACHE_WAYS];
+} aicache_set_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+    uint64_t evictions;
+    uint64_t busy;
+    aicache_set_t sets[AICACHE_SETS];
+} shm_aicache_t;
+
+// AI CPU budget: at most `slots` AI turns search at once, server-wide. A
+// turn that cannot get a slot within its deadline, or finds the queue full,
+// plays greedy instead. Lives in shm so that every worker and the monitor
+// see the same queue; mu/cv are process-shared.
+#define AISCHED_MAGIC_SHM "/tcg_aisched_v1"
+#define AISCHED_MAX_SLOTS 64
+
+typedef struct {
+    pthread_mutex_t mu;        // robust: a worker may die holding it
+    pthread_cond_t  cv;        // CLOCK_MONOTONIC
+    uint32_t slots;            // the budget, set before fork
+    uint32_t queue_max;        // waiting turns beyond this are shed at once
+    uint32_t deadline_ms;      // longest wait for a slot
+
+    // guarded by mu
+    int32_t  owner[AISCHED_MAX_SLOTS]; // pid holding each slot, 0 = free
+    uint32_t running;
+    uint32_t queued;
+    uint32_t queued_peak;
+    uint64_t admitted;         // turns that got a slot
+    uint64_t waited;           // ... after queueing
+    uint64_t wait_ns;
+    uint64_t deadline_misses;  // waited past the deadline: played greedy
+    uint64_t shed;             // queue full: played greedy at once
+    uint64_t reclaimed;        // slots of workers that died holding them
+} shm_aisched_t;
+
 shm_stats_t* ipc_stats_init(int create);
 void ipc_stats_inc_conn(shm_stats_t *s);
 void ipc_stats_inc_pkt(shm_stats_t *s);
+void ipc_stats_inc_flush(shm_stats_t *s);
+void ipc_stats_add_ai(shm_stats_t *s, uint64_t searches, uint64_t nodes,
+                      uint64_t probes, uint64_t hits, uint64_t ns);
+void ipc_stats_add_ai_turn(shm_stats_t *s, uint64_t ns);
+void ipc_stats_add_spec(shm_stats_t *s, int take_rc, uint64_t runs, uint64_t cancels); // take_rc: ai_spec_take
+
+shm_store_t* ipc_store_init(int create); // create: keep_log on
+uint64_t ipc_alloc_session(shm_store_t *store, uint8_t tier);
+int ipc_save_session(shm_store_t *store, uint64_t sid, const state_t *st, const evlog_t *log,
+                     const hand_t *h, uint32_t rng);
+int ipc_load_session(shm_store_t *store, uint64_t sid, state_t *st, evlog_t *log,
+                     hand_t *h, uint32_t *rng); // log: emptied without keep_log
+int ipc_touch_session(shm_store_t *store, uint64_t sid);
+int ipc_session_tier(shm_store_t *store, uint64_t sid); // ai_tier_t, -1 unknown sid
+void ipc_release_session(shm_store_t *store, uint64_t sid); // finished game: slot is free again
+
+shm_aisched_t* ipc_aisched_init(int create); // create: 1 slot, no queue limit, 100 ms
+// A slot for one AI turn: its index, -1 deadline passed, -2 queue full
+int  ipc_aisched_acquire(shm_aisched_t *s);
+void ipc_aisched_release(shm_aisched_t *s, int slot);
 
-shm_store_t* ipc_store_init(int create);
-uint64_t ipc_alloc_session(shm_store_t *store);
-int ipc_save_session(shm_store_t *store, uint64_t sid, const state_t *st, const hand_t *h);
-int ipc_load_session(shm_store_t *store, uint64_t sid, state_t *st, hand_t *h);
-int ipc_touch_session(shm_store_t *store, uint64_t sid);
\ No newline at end of file
+shm_aicache_t* ipc_aicache_init(int create);
+int  ipc_aicache_get(shm_aicache_t *c, uint64_t k0, uint64_t k1, int32_t *value_out); // 0 hit, -1 miss
+void ipc_aicache_put(shm_aicache_t *c, uint64_t k0, uint64_t k1, int32_t value);
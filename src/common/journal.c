@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+#include "journal.h"
+#include "evlog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static long long real_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long long mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void journal_init(journal_t *j, const char *dir) {
+    memset(j, 0, sizeof(*j));
+    j->dir = dir;
+    j->fd = -1;
+    j->last_flush_ns = mono_ns();
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+static int open_segment(journal_t *j) {
+    long long created = real_ns();
+    char path[512];
+    snprintf(path, sizeof(path), "%s/seg-%d-%lld.tcgj", j->dir, (int)getpid(), created);
+
+    j->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (j->fd < 0) {
+        perror("journal open");
+        j->dir = NULL; // give up quietly for the rest of this worker
+        return -1;
+    }
+
+    journal_hdr_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, JOURNAL_MAGIC, 4);
+    h.version = JOURNAL_VERSION;
+    h.rec_size = sizeof(journal_rec_t);
+    h.pid = (uint32_t)getpid();
+    h.created_ns = (uint64_t)created;
+    return write_all(j->fd, &h, sizeof(h));
+}
+
+int journal_flush(journal_t *j) {
+    j->last_flush_ns = mono_ns();
+    if (!j->dir || j->n == 0) return 0;
+    if (j->fd < 0 && open_segment(j) != 0) { j->n = 0; return -1; }
+
+    int rc = write_all(j->fd, j->buf, j->n * sizeof(journal_rec_t));
+    j->n = 0;
+    return rc;
+}
+
+void journal_maybe_flush(journal_t *j) {
+    if (j->n == 0) return;
+    if (j->n >= JOURNAL_BATCH / 2 ||
+        mono_ns() - j->last_flush_ns >= JOURNAL_FLUSH_MS * 1000000LL)
+        journal_flush(j);
+}
+
+void journal_close(journal_t *j) {
+    journal_flush(j);
+    if (j->fd >= 0) close(j->fd);
+    j->fd = -1;
+}
+
+void journal_log(journal_t *j, uint64_t sid, uint8_t type, int8_t arg, uint32_t value) {
+    if (!j->dir) return;
+    if (j->n == JOURNAL_BATCH) journal_flush(j); // only if the client outruns the idle flush
+
+    journal_rec_t *r = &j->buf[j->n++];
+    r->session_id = sid;
+    r->ts_ns = (uint64_t)real_ns();
+    r->type = type;
+    r->arg = arg;
+    r->reserved = 0;
+    r->value = value;
+}
+
+void journal_log_state(journal_t *j, uint64_t sid, uint8_t type, int8_t arg,
+                       const state_t *st, const evlog_t *log, const hand_t *hand) {
+    if (!j->dir) return;
+    journal_log(j, sid, type, arg, journal_state_hash(st, log, hand));
+}
+
+static uint32_t fnv1a(uint32_t h, const void *p, size_t n) {
+    const uint8_t *b = p;
+    for (size_t i = 0; i < n; i++) {
+        h ^= b[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint32_t journal_state_hash(const state_t *st, const evlog_t *log, const hand_t *hand) {
+    state_wire_t w;
+    state_pack(st, log, &w);
+    uint32_t h = fnv1a(2166136261u, &w, sizeof(w));
+    return fnv1a(h, hand, sizeof(*hand));
+}
+
+int journal_pick(const state_t *st, const hand_t *hand, void *ctx) {
+    journal_policy_t *jp = ctx;
+    int idx = jp->inner.pick(st, hand, jp->inner.ctx);
+    journal_log(jp->j, jp->sid, JR_AI_PICK, (int8_t)(idx < 0 ? -1 : idx), 0);
+    return idx;
+}
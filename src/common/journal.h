@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include "proto.h"
+#include "engine.h"
+
+/* ---------------------------
+ *  Game journal (append-only)
+ * ---------------------------
+ * Each worker appends fixed-size records to its own segment file
+ * (<dir>/seg-<pid>-<ns>.tcgj). A game is its seed plus the actions that
+ * reached the engine; the replay tool rebuilds every state from that.
+ * AI picks are recorded too, since the AI cache and search TT make them
+ * depend on other games. Records after an action carry a hash of the
+ * resulting state/hand so replays are verified step by step.
+ */
+
+#define JOURNAL_MAGIC   "TCGJ"
+#define JOURNAL_VERSION 1
+#define JOURNAL_BATCH   64   // records buffered per worker
+#define JOURNAL_FLUSH_MS 1000
+
+typedef enum {
+    JR_START    = 1, // value = seed
+    JR_RESUME   = 2, // value = hash of the state loaded from the store
+    JR_PLAY     = 3, // arg = hand idx, value = hash after the play
+    JR_END_TURN = 4, // value = hash after the player's END phase
+    JR_AI_PICK  = 5, // arg = idx returned by the AI policy (-1 = end turn)
+    JR_AI_DONE  = 6, // value = hash after the AI turn
+} jr_type_t;
+
+typedef struct __attribute__((packed)) {
+    char     magic[4];
+    uint16_t version;
+    uint16_t rec_size;
+    uint32_t pid;
+    uint32_t reserved;
+    uint64_t created_ns;   // CLOCK_REALTIME
+} journal_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t session_id;
+    uint64_t ts_ns;        // CLOCK_REALTIME
+    uint8_t  type;         // jr_type_t
+    int8_t   arg;
+    uint16_t reserved;
+    uint32_t value;
+} journal_rec_t;
+
+typedef struct {
+    const char *dir;       // NULL = journaling off
+    int fd;                // opened on first flush
+    uint32_t n;
+    long long last_flush_ns;
+    journal_rec_t buf[JOURNAL_BATCH];
+} journal_t;
+
+void journal_init(journal_t *j, const char *dir);
+void journal_close(journal_t *j); // flushes
+
+void journal_log(journal_t *j, uint64_t sid, uint8_t type, int8_t arg, uint32_t value);
+void journal_log_state(journal_t *j, uint64_t sid, uint8_t type, int8_t arg,
+                       const state_t *st, const evlog_t *log, const hand_t *hand);
+
+// Call once responses are sent: writes the batch when full or old enough
+void journal_maybe_flush(journal_t *j);
+int  journal_flush(journal_t *j);
+
+// FNV-1a over the state's wire form (state_wire_t, log included) and hand_t
+uint32_t journal_state_hash(const state_t *st, const evlog_t *log, const hand_t *hand);
+
+// Records every pick of the inner policy as JR_AI_PICK. ai_pick_fn compatible;
+// ctx is journal_policy_t*
+typedef struct {
+    journal_t *j;
+    uint64_t sid;
+    ai_policy_t inner;
+} journal_policy_t;
+
+int journal_pick(const state_t *st, const hand_t *hand, void *ctx);
@@ -11,6 +11,7 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <sys/time.h>
+#include <poll.h>
 
 void conn_init(connection_t *c, int fd, SSL *ssl) {
     if (c) {
@@ -54,6 +55,31 @@ ssize_t conn_readn(connection_t *c, void *buf, size_t n) {
     }
 }
 
+ssize_t conn_read_some(connection_t *c, void *buf, size_t cap) {
+    if (!c) return -1;
+    if (c->ssl) {
+        for (;;) {
+            int r = SSL_read(c->ssl, buf, (int)cap);
+            if (r > 0) return r;
+            int err = SSL_get_error(c->ssl, r);
+            if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) continue;
+            return err == SSL_ERROR_ZERO_RETURN ? 0 : -1;
+        }
+    }
+    for (;;) {
+        ssize_t r = read(c->fd, buf, cap);
+        if (r < 0 && errno == EINTR) continue;
+        return r;
+    }
+}
+
+int conn_readable(connection_t *c) {
+    if (!c) return 0;
+    if (c->ssl && SSL_pending(c->ssl) > 0) return 1;
+    struct pollfd pf = { .fd = c->fd, .events = POLLIN };
+    return poll(&pf, 1, 0) > 0;
+}
+
 ssize_t conn_writen(connection_t *c, const void *buf, size_t n) {
     if (!c) return -1;
     if (c->ssl) {
@@ -230,16 +256,6 @@ int tcp_connect(const char *host, uint16_t port) {
     return fd;
 }
 
-int net_set_timeout(int fd, int seconds) {
-    struct timeval tv;
-    tv.tv_sec = seconds;
-    tv.tv_usec = 0;
-    
-    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) return -1;
-    if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) return -1;
-    return 0;
-}
-
 /* --- SSL Helpers --- */
 
 void ssl_msg_init(void) {
@@ -281,4 +297,38 @@ SSL_CTX* ssl_init_server_ctx(const char *cert_path, const char *key_path) {
         return NULL;
     }
     return ctx;
-}
\ No newline at end of file
+}
+
+int ssl_ctx_set_profile(SSL_CTX *ctx, const char *ciphersuites, const char *groups, int tls13_only) {
+    if (ciphersuites && SSL_CTX_set_ciphersuites(ctx, ciphersuites) != 1) {
+        fprintf(stderr, "bad TLS 1.3 ciphersuites: %s\n", ciphersuites);
+        ERR_print_errors_fp(stderr);
+        return -1;
+    }
+    if (groups && SSL_CTX_set1_groups_list(ctx, groups) != 1) {
+        fprintf(stderr, "bad TLS groups: %s\n", groups);
+        ERR_print_errors_fp(stderr);
+        return -1;
+    }
+    if (tls13_only && SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION) != 1) {
+        ERR_print_errors_fp(stderr);
+        return -1;
+    }
+    return 0;
+}
+
+const char* ssl_ctx_key_name(SSL_CTX *ctx, char *buf, size_t n) {
+    EVP_PKEY *pk = SSL_CTX_get0_privatekey(ctx);
+    if (!pk) {
+        snprintf(buf, n, "none");
+    } else if (EVP_PKEY_get_base_id(pk) == EVP_PKEY_RSA) {
+        snprintf(buf, n, "rsa%d", EVP_PKEY_get_bits(pk));
+    } else if (EVP_PKEY_get_base_id(pk) == EVP_PKEY_EC) {
+        snprintf(buf, n, "ecdsa-p%d", EVP_PKEY_get_bits(pk));
+    } else if (EVP_PKEY_get_base_id(pk) == EVP_PKEY_ED25519) {
+        snprintf(buf, n, "ed25519");
+    } else {
+        snprintf(buf, n, "%s", OBJ_nid2sn(EVP_PKEY_get_base_id(pk)));
+    }
+    return buf;
+}
@@ -21,6 +21,10 @@ void conn_close(connection_t *c);
 // Wrapper for read/write
 ssize_t conn_readn(connection_t *c, void *buf, size_t n);
 ssize_t conn_writen(connection_t *c, const void *buf, size_t n);
+// One read of whatever is there (blocks only while nothing is): >0 bytes, 0 closed, -1 error
+ssize_t conn_read_some(connection_t *c, void *buf, size_t cap);
+// 1 if a read would return data (or EOF) without waiting
+int conn_readable(connection_t *c);
 
 // Legacy helpers (still used potentially)
 ssize_t readn(int fd, void *buf, size_t n);
@@ -46,4 +50,12 @@ int tcp_connect(const char *host, uint16_t port);
 // SSL Init Helpers
 void ssl_msg_init(void); // Init lib
 SSL_CTX* ssl_init_server_ctx(const char *cert_path, const char *key_path);
-SSL_CTX* ssl_init_client_ctx(void);
\ No newline at end of file
+SSL_CTX* ssl_init_client_ctx(void);
+
+// TLS profile on either side: TLS 1.3 suites ("TLS_AES_128_GCM_SHA256:..."),
+// key-exchange groups ("X25519:P-256") and TLS 1.3 only. NULL/0 keeps the
+// OpenSSL default. 0 ok, -1 if OpenSSL rejects a list.
+int ssl_ctx_set_profile(SSL_CTX *ctx, const char *ciphersuites, const char *groups, int tls13_only);
+
+// "rsa2048", "ecdsa-p256", "ed25519", ... for the ctx's certificate key
+const char* ssl_ctx_key_name(SSL_CTX *ctx, char *buf, size_t n);
\ No newline at end of file
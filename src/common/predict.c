@@ -0,0 +1,97 @@
+#include "predict.h"
+#include "engine.h"
+#include <string.h>
+
+void pred_init(predict_t *p) {
+    memset(p, 0, sizeof(*p));
+    p->next_seq = 1;
+}
+
+static int same_hand(const hand_t *a, const hand_t *b) {
+    if (a->n != b->n) return 0;
+    int n = a->n > 8 ? 8 : a->n;
+    return memcmp(a->card_ids, b->card_ids, (size_t)n * sizeof(a->card_ids[0])) == 0;
+}
+
+// view = base + every pending play, in order
+static void rebuild(predict_t *p) {
+    p->st = p->base_st;
+    p->log = p->base_log;
+    p->hand = p->base_hand;
+    int keep = 0;
+    for (int i = 0; i < p->npending; i++) {
+        pred_play_t *q = &p->pending[i];
+        // a play that no longer applies on the new base is dropped; the
+        // server will refuse it as well and ack it with an error
+        if (handle_play_card(&p->st, &p->hand, 1, q->idx, &p->log) != 0) continue;
+        q->st = p->st;
+        q->log = p->log;
+        q->hand = p->hand;
+        p->pending[keep++] = *q;
+    }
+    p->npending = keep;
+}
+
+int pred_play(predict_t *p, uint8_t idx, uint32_t *seq) {
+    if (p->npending == PRED_MAX) return -1;
+    state_t st = p->st;
+    evlog_t log = p->log;
+    hand_t hand = p->hand;
+    int rc = handle_play_card(&st, &hand, 1, idx, &log);
+    if (rc != 0) return rc;
+
+    pred_play_t *q = &p->pending[p->npending++];
+    q->seq = p->next_seq++;
+    q->idx = idx;
+    q->st = p->st = st;
+    q->log = p->log = log;
+    q->hand = p->hand = hand;
+    p->predicted++;
+    *seq = q->seq;
+    return 0;
+}
+
+void pred_ack(predict_t *p, const play_ack_t *ack) {
+    int n = 0;
+    while (n < p->npending && p->pending[n].seq <= ack->seq) n++;
+    if (n == 0) return; // dropped by rebuild, or from before a reconnect
+
+    if (ack->rc == 0 && p->pending[n - 1].seq == ack->seq) {
+        p->check = p->pending[n - 1];
+        p->has_check = 1;
+    } else {
+        p->rollbacks++;
+        p->has_check = 0;
+    }
+    memmove(p->pending, p->pending + n, (size_t)(p->npending - n) * sizeof(p->pending[0]));
+    p->npending -= n;
+    if (ack->rc != 0) rebuild(p);
+}
+
+void pred_state(predict_t *p, const state_t *st, const evlog_t *log) {
+    p->base_st = *st;
+    p->base_log = *log;
+    p->has_base = 1;
+}
+
+void pred_hand(predict_t *p, const hand_t *hand) {
+    p->base_hand = *hand;
+    if (p->has_check) {
+        int same = memcmp(&p->check.st, &p->base_st, sizeof(state_t)) == 0 &&
+                   memcmp(&p->check.log, &p->base_log, sizeof(evlog_t)) == 0 &&
+                   same_hand(&p->check.hand, &p->base_hand);
+        if (same) p->confirmed++;
+        else p->rollbacks++;
+        p->has_check = 0;
+    }
+    rebuild(p);
+}
+
+void pred_drop_pending(predict_t *p) {
+    if (p->npending > 0) p->rollbacks++;
+    p->npending = 0;
+    p->has_check = 0;
+    p->st = p->base_st;
+    p->log = p->base_log;
+    p->hand = p->base_hand;
+}
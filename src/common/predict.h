@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include "proto.h"
+
+/* ---------------------------
+ *  Client-side prediction
+ * ---------------------------
+ * A card play is applied locally with the engine rules as soon as it is
+ * made, and sent tagged with a sequence number (CAP_PLAY_SEQ). The server
+ * answers OP_PLAY_ACK(seq) before the STATE/HAND of that play. The view is
+ * always the last authoritative state with the still unacknowledged plays
+ * replayed on top; when the server's result for an acknowledged play differs
+ * from what was predicted, the view snaps to the server's (a rollback).
+ * Only plays are predicted: END_TURN draws cards and runs the AI.
+ */
+
+#define PRED_MAX 16  // plays in flight
+
+typedef struct {
+    uint32_t seq;
+    uint8_t  idx;
+    state_t  st;      // predicted result of this play
+    evlog_t  log;
+    hand_t   hand;
+} pred_play_t;
+
+typedef struct {
+    // what the UI shows
+    state_t st;
+    evlog_t log;
+    hand_t  hand;
+
+    // last authoritative state
+    state_t base_st;
+    evlog_t base_log;
+    hand_t  base_hand;
+    int has_base;
+
+    pred_play_t pending[PRED_MAX];
+    int npending;
+    uint32_t next_seq;
+
+    pred_play_t check;  // acknowledged play waiting for its STATE/HAND
+    int has_check;
+
+    uint64_t predicted, confirmed, rollbacks;
+} predict_t;
+
+void pred_init(predict_t *p);
+
+// Applies play idx to the view. 0 ok (*seq to send), -1 no room, or the
+// engine's rc when the local rules refuse it (nothing to send).
+int pred_play(predict_t *p, uint8_t idx, uint32_t *seq);
+
+// OP_PLAY_ACK. Plays up to seq leave the pending list; rc != 0 is a
+// rollback right away (the server did not apply it).
+void pred_ack(predict_t *p, const play_ack_t *ack);
+
+// Authoritative OP_STATE / OP_HAND. The view is rebuilt on HAND, which
+// the server always sends last.
+void pred_state(predict_t *p, const state_t *st, const evlog_t *log);
+void pred_hand(predict_t *p, const hand_t *hand);
+
+// Link lost: unacknowledged plays may or may not have reached the server,
+// so they are dropped and the view goes back to the last server state.
+void pred_drop_pending(predict_t *p);
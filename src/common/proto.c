@@ -1,5 +1,6 @@
 #include "proto.h"
 #include "net.h"
+#include "wire.h"
 #include <string.h>
 #include <arpa/inet.h>
 
@@ -11,30 +12,203 @@ uint16_t proto_checksum16(const void *buf, size_t n) {
     return (uint16_t)(~sum);
 }
 
-int proto_send(connection_t *c, uint16_t opcode, const void *payload, uint32_t payload_len) {
-    if (!c) return -1;
-
+int proto_encode(void *out, size_t cap, uint16_t opcode, const void *payload, uint32_t payload_len) {
     pkt_hdr_t h;
     uint32_t total_len = (uint32_t)sizeof(h) + payload_len;
+    if (total_len > cap) return -1;
 
     h.len = htonl(total_len);
     h.opcode = htons(opcode);
     h.cksum = htons(0);
 
-    // build temp buffer for checksum
-    uint8_t stackbuf[4096]; // increased size just in case
-    uint8_t *buf = stackbuf;
-    if (total_len > sizeof(stackbuf)) return -1; // keep it simple for MVP
-
+    uint8_t *buf = (uint8_t*)out;
     memcpy(buf, &h, sizeof(h));
     if (payload_len && payload) memcpy(buf + sizeof(h), payload, payload_len);
 
     // compute checksum with cksum=0 in header
     uint16_t cks = proto_checksum16(buf, total_len);
     ((pkt_hdr_t*)buf)->cksum = htons(cks);
+    return (int)total_len;
+}
+
+int proto_decode(const void *buf, size_t len, uint16_t *opcode_out,
+                 const uint8_t **payload_out, uint32_t *payload_len_out) {
+    pkt_hdr_t h;
+    if (len < sizeof(h)) return 0;
+    memcpy(&h, buf, sizeof(h));
+
+    uint32_t total_len = ntohl(h.len);
+    if (total_len < sizeof(h) || total_len > 4096) return -1;
+    if (len < total_len) return 0;
+
+    // checksum over the packet with cksum = 0: subtract the field instead of copying
+    const uint8_t *p = (const uint8_t*)buf;
+    uint16_t got_ck = ntohs(h.cksum);
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < total_len; i++) sum += p[i];
+    sum -= p[6] + p[7];
+    while (sum >> 16) sum = (sum & 0xFFFFu) + (sum >> 16);
+    if ((uint16_t)~sum != got_ck) return -1;
+
+    if (opcode_out) *opcode_out = ntohs(h.opcode);
+    if (payload_out) *payload_out = p + sizeof(h);
+    if (payload_len_out) *payload_len_out = total_len - (uint32_t)sizeof(h);
+    return (int)total_len;
+}
+
+/* ---------- v3 framing ---------- */
+
+// one-byte opcodes; 0 is free, V3_OP_ESC is followed by the 16-bit opcode
+static const uint16_t k_v3_ops[] = {
+    0, OP_LOGIN_REQ, OP_LOGIN_RESP, OP_PING, OP_PONG, OP_RESUME_REQ, OP_RESUME_RESP,
+    OP_PLAY_CARD, OP_END_TURN, OP_PLAY_ACK, OP_STATE, OP_HAND, OP_ERROR,
+    OP_AI_PLAY, // new opcodes go at the end: the indexes are the wire format
+};
+#define V3_NOPS   (sizeof(k_v3_ops) / sizeof(k_v3_ops[0]))
+#define V3_OP_ESC 0x7F
+#define V3_LAST   0x80
+
+static int encode_v3(uint8_t *out, size_t cap, uint16_t opcode, uint32_t seq,
+                     uint16_t flags, const void *payload, uint32_t payload_len) {
+    uint8_t head[16];
+    uint32_t hn = 0;
+    uint8_t code = V3_OP_ESC;
+    for (uint8_t i = 1; i < V3_NOPS; i++) if (k_v3_ops[i] == opcode) { code = i; break; }
+    head[hn++] = code | ((flags & PKT_F_LAST) ? V3_LAST : 0);
+    if (code == V3_OP_ESC) { head[hn++] = (uint8_t)(opcode >> 8); head[hn++] = (uint8_t)opcode; }
+    hn += (uint32_t)wire_put_varint(head + hn, sizeof(head) - hn, seq);
+
+    uint8_t packed[128];
+    const uint8_t *body = (const uint8_t*)payload;
+    uint32_t blen = payload_len;
+    if (wire_compact_op(opcode)) {
+        int k = wire_pack(opcode, payload, payload_len, packed, sizeof(packed));
+        if (k < 0) return -1;
+        body = packed;
+        blen = (uint32_t)k;
+    }
+
+    uint32_t rest = hn + blen;
+    int ln = wire_put_varint(out, cap, rest);
+    if (ln < 0 || (size_t)ln + rest > cap || ln + rest > 4096) return -1;
+    memcpy(out + ln, head, hn);
+    if (blen) memcpy(out + ln + hn, body, blen);
+    return ln + (int)rest;
+}
+
+static int decode_v3(const uint8_t *p, size_t len, proto_frame_t *f) {
+    uint32_t rest;
+    int ln = wire_get_varint(p, len > 3 ? 3 : len, &rest);
+    if (ln == 0) return len >= 3 ? -1 : 0;
+    if (ln < 0 || rest == 0 || ln + rest > 4096) return -1;
+    if (len < ln + rest) return 0;
+
+    const uint8_t *q = p + ln, *end = q + rest;
+    uint8_t code = *q++;
+    f->flags = (code & V3_LAST) ? PKT_F_LAST : 0;
+    code &= (uint8_t)~V3_LAST;
+    if (code == V3_OP_ESC) {
+        if (end - q < 2) return -1;
+        f->opcode = (uint16_t)(q[0] << 8 | q[1]);
+        q += 2;
+    } else {
+        if (code == 0 || code >= V3_NOPS) return -1;
+        f->opcode = k_v3_ops[code];
+    }
+    int k = wire_get_varint(q, (size_t)(end - q), &f->seq);
+    if (k <= 0) return -1;
+    q += k;
+
+    if (wire_compact_op(f->opcode)) {
+        int n = wire_unpack(f->opcode, q, (uint32_t)(end - q), f->body, sizeof(f->body));
+        if (n < 0) return -1;
+        f->payload = f->body;
+        f->plen = (uint32_t)n;
+    } else {
+        f->payload = q;
+        f->plen = (uint32_t)(end - q);
+    }
+    return ln + (int)rest;
+}
+
+int proto_encode_ver(uint16_t ver, void *out, size_t cap, uint16_t opcode, uint32_t seq,
+                     uint16_t flags, const void *payload, uint32_t payload_len) {
+    if (ver < PROTO_V2) return proto_encode(out, cap, opcode, payload, payload_len);
+    if (ver >= PROTO_V3) return encode_v3((uint8_t*)out, cap, opcode, seq, flags, payload, payload_len);
+
+    pkt_hdr2_t h;
+    uint32_t total_len = (uint32_t)sizeof(h) + payload_len;
+    if (total_len > cap) return -1;
+
+    h.len = htonl(total_len);
+    h.opcode = htons(opcode);
+    h.cksum = htons(0);
+    h.seq = htonl(seq);
+    h.flags = htons(flags);
+
+    uint8_t *buf = (uint8_t*)out;
+    memcpy(buf, &h, sizeof(h));
+    if (payload_len && payload) memcpy(buf + sizeof(h), payload, payload_len);
+    ((pkt_hdr2_t*)buf)->cksum = htons(proto_checksum16(buf, total_len));
+    return (int)total_len;
+}
+
+int proto_decode_ver(uint16_t ver, const void *buf, size_t len, proto_frame_t *f) {
+    if (ver < PROTO_V2) {
+        f->seq = 0;
+        f->flags = 0;
+        return proto_decode(buf, len, &f->opcode, &f->payload, &f->plen);
+    }
+    if (ver >= PROTO_V3) return decode_v3((const uint8_t*)buf, len, f);
+
+    pkt_hdr2_t h;
+    if (len < sizeof(h)) return 0;
+    memcpy(&h, buf, sizeof(h));
+
+    uint32_t total_len = ntohl(h.len);
+    if (total_len < sizeof(h) || total_len > 4096) return -1;
+    if (len < total_len) return 0;
+
+    const uint8_t *p = (const uint8_t*)buf;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < total_len; i++) sum += p[i];
+    sum -= p[6] + p[7];
+    while (sum >> 16) sum = (sum & 0xFFFFu) + (sum >> 16);
+    if ((uint16_t)~sum != ntohs(h.cksum)) return -1;
+
+    f->opcode = ntohs(h.opcode);
+    f->seq = ntohl(h.seq);
+    f->flags = ntohs(h.flags);
+    f->payload = p + sizeof(h);
+    f->plen = total_len - (uint32_t)sizeof(h);
+    return (int)total_len;
+}
+
+void proto_set_flags(uint16_t ver, void *pkt, uint16_t flags) {
+    if (ver >= PROTO_V3) {
+        // the flag is the opcode byte's high bit, right after the length
+        uint8_t *p = (uint8_t*)pkt;
+        uint32_t rest;
+        int ln = wire_get_varint(p, 3, &rest);
+        if (ln <= 0) return;
+        if (flags & PKT_F_LAST) p[ln] |= V3_LAST; else p[ln] &= (uint8_t)~V3_LAST;
+        return;
+    }
+    pkt_hdr2_t *h = (pkt_hdr2_t*)pkt;
+    h->flags = htons(flags);
+    h->cksum = htons(0);
+    h->cksum = htons(proto_checksum16(pkt, ntohl(h->len)));
+}
+
+int proto_send(connection_t *c, uint16_t opcode, const void *payload, uint32_t payload_len) {
+    if (!c) return -1;
+
+    uint8_t buf[4096]; // increased size just in case
+    int total_len = proto_encode(buf, sizeof(buf), opcode, payload, payload_len);
+    if (total_len < 0) return -1; // keep it simple for MVP
 
     // write out using conn_writen
-    if (conn_writen(c, buf, total_len) != (ssize_t)total_len) return -1;
+    if (conn_writen(c, buf, (size_t)total_len) != (ssize_t)total_len) return -1;
     return 0;
 }
 
@@ -72,4 +246,11 @@ int proto_recv(connection_t *c, uint16_t *opcode_out, void *payload_buf, uint32_
     if (opcode_out) *opcode_out = opcode;
     if (payload_len_out) *payload_len_out = payload_len;
     return 0;
-}
\ No newline at end of file
+}
+
+int proto_ai_tier(const char *name) {
+    static const char *names[AI_TIER_COUNT] = { "default", "easy", "normal", "hard" };
+    for (int k = 0; k < AI_TIER_COUNT; k++)
+        if (strcmp(name, names[k]) == 0) return k;
+    return -1;
+}
@@ -17,10 +17,12 @@ enum opcode_t {
     OP_RESUME_REQ = 0x0003,   // client->server (payload: resume_req_t)
     OP_RESUME_RESP= 0x8003,   // server->client (payload: resume_resp_t)
 
-    OP_PLAY_CARD  = 0x0101,   // client->server (payload: play_req_t)
+    OP_PLAY_CARD  = 0x0101,   // client->server (payload: play_req_t, or play_seq_req_t with CAP_PLAY_SEQ)
     OP_END_TURN   = 0x0102,   // client->server (no payload)
+    OP_PLAY_ACK   = 0x8101,   // server->client (payload: play_ack_t), first reply to a tagged play
+    OP_AI_PLAY    = 0x8102,   // server->client (payload: ai_play_t), CAP_AI_STREAM
 
-    OP_STATE      = 0x0201,   // server->client (payload: state_t)
+    OP_STATE      = 0x0201,   // server->client (payload: state_wire_t)
     OP_HAND       = 0x0202,   // server->client (payload: hand_t)
 
     OP_ERROR      = 0xFFFF,   // server->client (payload: error_t optional)
@@ -34,6 +36,65 @@ typedef struct {
 } pkt_hdr_t;
 #pragma pack(pop)
 
+/* ---------------------------
+ *  Protocol versions
+ * ---------------------------
+ * v1: pkt_hdr_t. Responses come in request order, but nothing in them says
+ *     which request they answer.
+ * v2: pkt_hdr2_t adds the request's seq to every packet and marks the last
+ *     response to each request with PKT_F_LAST, so a client can keep several
+ *     requests in flight. The server handles every request it has buffered
+ *     before it writes, and sends their responses in one write.
+ * v3: same fields as v2, compact: a varint length, a one-byte opcode (high
+ *     bit = PKT_F_LAST), a varint seq, then the payload in the compact form
+ *     of common/wire.c. No checksum: every link is TLS, whose MAC already
+ *     rejects a damaged record. Needs CAP_EVENT_LOG (no legacy state).
+ * The client offers its highest version in LOGIN_REQ / RESUME_REQ (absent =
+ * v1) and RESUME_RESP.version is the one the server picked. RESUME_RESP and
+ * everything before it are v1 frames; after an ok RESUME_RESP both sides use
+ * the picked version. A failed resume stays in v1 for the LOGIN that follows.
+ */
+#define PROTO_V1      1
+#define PROTO_V2      2
+#define PROTO_V3      3
+#define PROTO_VERSION PROTO_V3   // highest version this build speaks
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t len;      // total packet length (header+payload), network byte order
+    uint16_t opcode;   // network byte order
+    uint16_t cksum;    // checksum over entire packet with this field = 0, network byte order
+    uint32_t seq;      // request: client counter; response: seq it answers, 0 = pushed
+    uint16_t flags;    // PKT_F_*
+} pkt_hdr2_t;
+#pragma pack(pop)
+
+#define PKT_F_LAST 0x0001u  // last response to this seq
+
+// Client capabilities (OP_LOGIN_REQ payload, optional)
+#define CAP_EVENT_LOG  0x00000001u  // OP_STATE carries state_wire_t (events), not state_legacy_t
+#define CAP_PLAY_SEQ   0x00000002u  // plays may carry a seq, answered by OP_PLAY_ACK
+#define CAP_AI_STREAM  0x00000004u  // END_TURN is answered at once, AI plays follow as OP_AI_PLAY
+
+#define SERVER_CAPS    (CAP_EVENT_LOG | CAP_PLAY_SEQ | CAP_AI_STREAM)
+
+// AI difficulty asked for at login; the server maps each to a search budget
+typedef enum {
+    AI_TIER_DEFAULT = 0,  // whatever the server runs (--ai, --ai-depth)
+    AI_TIER_EASY    = 1,  // greedy
+    AI_TIER_NORMAL  = 2,  // shallow search
+    AI_TIER_HARD    = 3,  // deep search
+    AI_TIER_COUNT
+} ai_tier_t;
+
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t caps;     // CAP_* bits; an empty LOGIN_REQ means 0
+    uint16_t version;  // optional: highest PROTO_V* the client speaks
+    uint8_t  tier;     // optional: ai_tier_t, kept for the session's life
+} login_req_t;
+#pragma pack(pop)
+
 typedef struct {
     int32_t ok;        // 1=ok, 0=fail
 } login_resp_t;
@@ -41,11 +102,15 @@ typedef struct {
 #pragma pack(push, 1)
 typedef struct {
     uint64_t session_id;
+    uint32_t caps;      // optional: old clients send only session_id
+    uint16_t version;   // optional, as in login_req_t
 } resume_req_t;
 
 typedef struct {
     int32_t ok;         // 1 ok, 0 fail
     uint64_t session_id;
+    uint32_t caps;      // optional: the client's CAP_* bits this server honours
+    uint16_t version;   // optional: PROTO_V* used after this packet (absent = v1)
 } resume_resp_t;
 #pragma pack(pop)
 
@@ -66,14 +131,37 @@ typedef enum {
     CT_POISON
 } card_type_t;
 
+/* Card effects: what a card does is a short program of these, run in
+ * order by the engine. The actor is the side playing the card. */
+typedef enum {
+    EF_END = 0,   // stops the program early
+    EF_DAMAGE,    // arg + the actor's buff (used up) to the enemy, shield first
+    EF_HEAL,      // arg hp to the actor
+    EF_SHIELD,    // arg shield to the actor
+    EF_BUFF,      // arg added to the actor's next damage
+    EF_POISON,    // arg turns of poison on the enemy (2 hp per END phase)
+    EF_DRAW,      // arg cards from the draw pool into the actor's hand
+    EF_MANA,      // arg mana for this turn
+    EF_COUNT
+} effect_op_t;
+
+typedef struct {
+    uint8_t op;   // effect_op_t
+    int8_t  arg;
+} effect_t;
+
+#define CARD_PROG_MAX 4
+
 /* Card Definition (Static Data) */
 typedef struct {
     uint16_t id;
-    uint8_t  type;    // card_type_t
+    uint8_t  type;    // card_type_t of the first effect (icon, AI hints)
     uint8_t  cost;
-    int16_t  value;   // dmg/heal/shield/buff_val
+    int16_t  value;   // the first effect's arg: dmg/heal/shield/buff_val
     uint8_t  duration;
     const char *name;
+    uint8_t  nprog;   // effects in prog, validated at load
+    effect_t prog[CARD_PROG_MAX];
 } card_def_t;
 
 /* Hand (Instance Data) - NOW USES IDs */
@@ -87,6 +175,20 @@ typedef struct {
 typedef struct {
     uint8_t hand_idx;  // 0..n-1
 } play_req_t;
+
+// Same play tagged for client-side prediction (CAP_PLAY_SEQ)
+typedef struct {
+    uint8_t  hand_idx;
+    uint32_t seq;      // client counter, increasing
+} play_seq_req_t;
+
+// Sent before the ERROR/STATE/HAND of a tagged play: the server has
+// processed every play up to seq. rc as handle_play_card (0 ok), or the
+// OP_ERROR code when the play was refused before reaching the engine.
+typedef struct {
+    uint32_t seq;
+    int32_t  rc;
+} play_ack_t;
 #pragma pack(pop)
 
 typedef enum {
@@ -95,15 +197,60 @@ typedef enum {
     PHASE_END  = 2,
 } phase_t;
 
-// state includes resources + statuses + ring-buffer logs
+/* Structured game events: the server records these, clients format them
+ * (evlog_format) only when they display the log. */
+typedef enum {
+    EV_NONE = 0,
+    EV_PLAY,        // actor played card_id; amount = dmg/heal/shield/buff/turns
+    EV_POISON_TICK, // actor took amount poison damage
+    EV_DRAW_PHASE,
+    EV_END_PHASE,
+    EV_GAME_OVER,
+    EV_RESUMED,
+} event_kind_t;
+
+#pragma pack(push, 1)
+typedef struct {
+    uint8_t  kind;     // event_kind_t
+    uint8_t  actor;    // 0=player, 1=AI
+    uint16_t card_id;
+    int16_t  amount;
+    uint8_t  mana;     // mana left after the event
+} game_event_t;
+#pragma pack(pop)
+
+// With CAP_AI_STREAM, END_TURN is answered with STATE (the AI's turn has
+// begun) at once, then one OP_AI_PLAY per AI card as it is played, then the
+// usual STATE + HAND. Each goes out on its own write. The AI_PLAYs are for
+// showing the turn as it happens; the final STATE is authoritative.
+#pragma pack(push, 1)
+typedef struct {
+    uint8_t      step;        // 1.. within this AI turn
+    game_event_t ev;          // the EV_PLAY: card, amount, AI mana left
+    int16_t      p_hp, ai_hp; // after the play
+    int16_t      p_shield, ai_shield;
+} ai_play_t;
+#pragma pack(pop)
+
+// state includes resources + statuses; the event ring is kept apart (evlog_t)
 #define LOG_LINES 6
 #define LOG_LEN   64
 
-#pragma pack(push, 1)
+// The rules' working copy: only what the rules read, naturally aligned, no
+// padding (20 bytes, so search / simulation copies are cheap and several
+// states share a cache line). It is never sent as is: OP_STATE carries
+// state_wire_t, built in send_state / state_pack.
 typedef struct {
     int16_t p_hp;      // player HP
     int16_t ai_hp;     // AI HP
 
+    // statuses
+    int16_t p_shield;  // absorbs damage first
+    int16_t ai_shield;
+
+    int16_t p_buff;    // next attack +X then consumed
+    int16_t ai_buff;
+
     uint8_t turn;      // 0=player, 1=ai
     uint8_t phase;     // 0=DRAW, 1=MAIN, 2=END
     uint8_t game_over; // 0/1
@@ -113,20 +260,61 @@ typedef struct {
     uint8_t mana;      // current mana of current turn side (MVP)
     uint8_t max_mana;  // usually 3
 
-    // statuses
-    int16_t p_shield;  // absorbs damage first
-    int16_t ai_shield;
+    uint8_t p_poison;  // remaining poison turns (ticks at end turn)
+    uint8_t ai_poison;
+} state_t;
+_Static_assert(sizeof(state_t) == 20, "state_t: no padding");
 
-    int16_t p_buff;    // next attack +X then consumed
+// event ring buffer: written by the server, read by clients for display
+typedef struct {
+    uint8_t      head;     // next write index (0..LOG_LINES-1)
+    game_event_t events[LOG_LINES];
+} evlog_t;
+
+#pragma pack(push, 1)
+// OP_STATE payload with CAP_EVENT_LOG (the wire layout of earlier releases)
+typedef struct {
+    int16_t p_hp;
+    int16_t ai_hp;
+    uint8_t turn;
+    uint8_t phase;
+    uint8_t game_over;
+    uint8_t winner;
+    uint8_t mana;
+    uint8_t max_mana;
+    int16_t p_shield;
+    int16_t ai_shield;
+    int16_t p_buff;
     int16_t ai_buff;
+    uint8_t p_poison;
+    uint8_t ai_poison;
 
-    uint8_t p_poison;  // remaining poison turns (ticks at end turn)
+    uint8_t      ev_head;  // next write index (0..LOG_LINES-1)
+    game_event_t events[LOG_LINES];
+} state_wire_t;
+
+// Pre-event wire format (text log lines), still sent to clients that do
+// not announce CAP_EVENT_LOG at login.
+typedef struct {
+    int16_t p_hp;
+    int16_t ai_hp;
+    uint8_t turn;
+    uint8_t phase;
+    uint8_t game_over;
+    uint8_t winner;
+    uint8_t mana;
+    uint8_t max_mana;
+    int16_t p_shield;
+    int16_t ai_shield;
+    int16_t p_buff;
+    int16_t ai_buff;
+    uint8_t p_poison;
     uint8_t ai_poison;
 
     // log ring buffer
     uint8_t log_head;  // next write index (0..LOG_LINES-1)
     char    logs[LOG_LINES][LOG_LEN];
-} state_t;
+} state_legacy_t;
 #pragma pack(pop)
 
 // optional: error payload
@@ -146,3 +334,32 @@ uint16_t proto_checksum16(const void *buf, size_t n);
 int proto_send(connection_t *c, uint16_t opcode, const void *payload, uint32_t payload_len);
 int proto_recv(connection_t *c, uint16_t *opcode_out, void *payload_buf, uint32_t payload_buf_cap, uint32_t *payload_len_out);
 
+// Buffer-level framing for non-blocking I/O (no connection_t involved).
+// encode: bytes written to out, -1 if cap is too small.
+int proto_encode(void *out, size_t cap, uint16_t opcode, const void *payload, uint32_t payload_len);
+// decode one packet from the front of buf: bytes consumed, 0 = need more, -1 = bad packet.
+// *payload_out points into buf.
+int proto_decode(const void *buf, size_t len, uint16_t *opcode_out,
+                 const uint8_t **payload_out, uint32_t *payload_len_out);
+
+// Same for any version (seq/flags are ignored / read as 0 in v1). Payloads
+// are always the packed structs: v3 packs and unpacks them here.
+typedef struct {
+    uint16_t opcode;
+    uint16_t flags;
+    uint32_t seq;
+    const uint8_t *payload;  // into the decoded buffer, or body (v3)
+    uint32_t plen;
+    uint8_t body[96];        // v3: the unpacked struct (state_wire_t, error_t, ...)
+} proto_frame_t;
+
+int proto_encode_ver(uint16_t ver, void *out, size_t cap, uint16_t opcode, uint32_t seq,
+                     uint16_t flags, const void *payload, uint32_t payload_len);
+int proto_decode_ver(uint16_t ver, const void *buf, size_t len, proto_frame_t *f);
+
+// Sets the flags of an encoded v2/v3 packet (and fixes the v2 checksum)
+void proto_set_flags(uint16_t ver, void *pkt, uint16_t flags);
+
+// ai_tier_t by name ("default", "easy", "normal", "hard"), -1 if unknown
+int proto_ai_tier(const char *name);
+
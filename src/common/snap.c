@@ -0,0 +1,71 @@
+#include "snap.h"
+#include "cards.h"
+#include <stddef.h>
+#include <string.h>
+
+/*  w[0]  state bytes 0..7: p_hp ai_hp p_shield ai_shield
+ *  w[1]  state bytes 8..11: p_buff ai_buff | rng << 32
+ *  w[2]  state bytes 16..19: mana max_mana p_poison ai_poison
+ *        turn:1 phase:2 game_over:1 winner:2 n:4 card[0]:10 card[1]:10  (62 bits)
+ *  w[3]  card[2..7]:10 each                                        (60 bits)
+ *
+ * The numbers are moved as whole byte runs of state_t, in host order: a
+ * snapshot never leaves the machine (shm store).
+ */
+_Static_assert(offsetof(state_t, turn) == 12 && offsetof(state_t, mana) == 16 &&
+               sizeof(state_t) == 20, "snap.c copies state_t byte runs");
+_Static_assert(CARD_ID_MAX == 1024, "card ids are packed in 10 bits");
+
+#define FLAG_BITS 0x03010301u              // turn, phase, game_over, winner bytes: allowed bits
+#define ID_HIGH   0xFC00FC00FC00FC00ull    // 4 card ids: bits that must be 0
+
+// 4 x 16-bit card ids -> 40 bits
+static uint64_t pack4(uint64_t a) {
+    return (a & 0x3FF) | (a >> 6 & 0xFFC00) | (a >> 12 & 0x3FF00000) | (a >> 18 & 0xFFC0000000ull);
+}
+
+static uint64_t unpack4(uint64_t c) {
+    return (c & 0x3FF) | (c << 6 & 0x3FF0000) | (c << 12 & 0x3FF00000000ull) |
+           (c << 18 & 0x3FF000000000000ull);
+}
+
+int snap_encode(snap_t *out, const state_t *st, const hand_t *h, uint32_t rng) {
+    const uint8_t *s = (const uint8_t *)st;
+    uint32_t buff, f, tail;
+    uint64_t head, a, b;
+    memcpy(&head, s, 8);
+    memcpy(&buff, s + 8, 4);
+    memcpy(&f, s + 12, 4);
+    memcpy(&tail, s + 16, 4);
+    memcpy(&a, &h->card_ids[0], 8);
+    memcpy(&b, &h->card_ids[4], 8);
+    if ((f & ~FLAG_BITS) || h->n > 8 || ((a | b) & ID_HIGH)) return -1;
+
+    uint64_t flags = (f & 1) | (f >> 7 & 6) | (f >> 13 & 8) | (f >> 20 & 0x30);
+    uint64_t lo = pack4(a), hi = pack4(b);
+    out->w[0] = head;
+    out->w[1] = buff | (uint64_t)rng << 32;
+    out->w[2] = tail | flags << 32 | (uint64_t)h->n << 38 | (lo & 0xFFFFF) << 42;
+    out->w[3] = lo >> 20 | hi << 20;
+    return 0;
+}
+
+void snap_decode(const snap_t *in, state_t *st, hand_t *h, uint32_t *rng) {
+    uint8_t *s = (uint8_t *)st;
+    uint64_t w2 = in->w[2];
+    uint32_t tail = (uint32_t)w2, buff = (uint32_t)in->w[1];
+    uint32_t x = (uint32_t)(w2 >> 32);
+    uint32_t f = (x & 1) | (x & 6) << 7 | (x & 8) << 13 | (x & 0x30) << 20;
+
+    memcpy(s, &in->w[0], 8);
+    memcpy(s + 8, &buff, 4);
+    memcpy(s + 12, &f, 4);
+    memcpy(s + 16, &tail, 4);
+    if (rng) *rng = (uint32_t)(in->w[1] >> 32);
+
+    uint64_t lo = (w2 >> 42) | (in->w[3] & 0xFFFFF) << 20, hi = in->w[3] >> 20;
+    uint64_t a = unpack4(lo), b = unpack4(hi);
+    h->n = (uint8_t)(x >> 6 & 0xF);
+    memcpy(&h->card_ids[0], &a, 8);
+    memcpy(&h->card_ids[4], &b, 8);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include "proto.h"
+
+/* ---------------------------
+ *  Game snapshot (session store)
+ * ---------------------------
+ * The numbers of a game (state_t), the hand and the
+ * RNG, bit-packed into four 64-bit words. Fields keep their full range,
+ * except the ones the engine bounds: turn and game_over take 1 bit, phase
+ * and winner 2, the hand size 4, a card id 10 (CARD_ID_MAX). Unused bits are
+ * 0, so equal games have equal snapshots. The event ring is left to the
+ * caller: it is display history, not game state.
+ */
+#define SNAP_BYTES 32
+
+typedef struct {
+    uint64_t w[SNAP_BYTES / 8];
+} snap_t;
+
+// 0 ok, -1 a bounded field is out of range (out is left unchanged)
+int snap_encode(snap_t *out, const state_t *st, const hand_t *h, uint32_t rng);
+// The inverse
+void snap_decode(const snap_t *in, state_t *st, hand_t *h, uint32_t *rng);
@@ -0,0 +1,173 @@
+#define _DEFAULT_SOURCE
+#include "spec.h"
+#include <sched.h>
+#include <string.h>
+
+#ifndef SCHED_IDLE
+#define SCHED_IDLE 5
+#endif
+
+typedef struct {
+    ai_spec_t *sp;
+    ai_plan_t *plan;
+    int overflow;
+} rec_ctx_t;
+
+// the worker's policy, recording every answer
+static int rec_pick(const state_t *st, const hand_t *hand, void *ctx) {
+    rec_ctx_t *r = (rec_ctx_t*)ctx;
+    int idx = r->sp->pol.pick(st, hand, r->sp->pol.ctx);
+    if (r->plan->n == SPEC_MAX_PICKS) { r->overflow = 1; return -1; }
+    r->plan->idx[r->plan->n++] = (int8_t)idx;
+    return idx;
+}
+
+static int stopped(ai_spec_t *sp) {
+    return __atomic_load_n(&sp->stop, __ATOMIC_RELAXED);
+}
+
+// The AI turn after END_TURN from this position; 1 if it ran to the end
+static int spec_run(ai_spec_t *sp, state_t st, hand_t hand, uint32_t rng, ai_plan_t *plan) {
+    rec_ctx_t r = { sp, plan, 0 };
+    ai_policy_t pol = { rec_pick, &r };
+    memset(plan, 0, sizeof(*plan));
+    phase_end(&st, &hand, &rng, NULL);
+    if (st.turn != 1 || st.game_over) return 1;
+    while (!stopped(sp) && ai_turn_step(&st, &hand, &pol, &rng, NULL)) {}
+    return !stopped(sp) && !r.overflow;
+}
+
+// SCHED_IDLE: the worker only gets CPU nobody else wants
+static void set_idle(pthread_t th, int idle) {
+    struct sched_param p = { .sched_priority = 0 };
+    pthread_setschedparam(th, idle ? SCHED_IDLE : SCHED_OTHER, &p);
+}
+
+static void* spec_main(void *arg) {
+    ai_spec_t *sp = (ai_spec_t*)arg;
+    pthread_mutex_lock(&sp->mu);
+    for (;;) {
+        while (!sp->quit && sp->done_gen == sp->gen) pthread_cond_wait(&sp->cv, &sp->mu);
+        if (sp->quit) break;
+
+        uint64_t gen = sp->gen;
+        state_t st = sp->st;
+        hand_t hand = sp->hand;
+        uint32_t rng = sp->rng;
+        __atomic_store_n(&sp->stop, 0, __ATOMIC_RELAXED);
+        sp->busy = 1;
+        set_idle(pthread_self(), !sp->urgent);
+        pthread_mutex_unlock(&sp->mu);
+        // whatever our reply woke goes first: SCHED_IDLE only wins wakeups,
+        // a task that is already runnable could wait a tick behind us
+        sched_yield();
+
+        ai_plan_t plan;
+        int ok = spec_run(sp, st, hand, rng, &plan);
+
+        pthread_mutex_lock(&sp->mu);
+        sp->busy = 0;
+        if (ok) sp->runs++; else sp->cancelled++;
+        if (gen == sp->gen) {
+            // a stopped run is not retried: only a new post starts another
+            sp->done_gen = gen;
+            sp->valid = ok;
+            sp->plan = plan;
+        }
+        pthread_cond_broadcast(&sp->cv);
+    }
+    pthread_mutex_unlock(&sp->mu);
+    return NULL;
+}
+
+int ai_spec_start(ai_spec_t *sp, ai_policy_t pol) {
+    memset(sp, 0, sizeof(*sp));
+    sp->pol = pol;
+    pthread_mutex_init(&sp->mu, NULL);
+    pthread_cond_init(&sp->cv, NULL);
+    if (pthread_create(&sp->th, NULL, spec_main, sp) != 0) {
+        pthread_cond_destroy(&sp->cv);
+        pthread_mutex_destroy(&sp->mu);
+        return -1;
+    }
+    return 0;
+}
+
+void ai_spec_stop(ai_spec_t *sp) {
+    pthread_mutex_lock(&sp->mu);
+    sp->quit = 1;
+    __atomic_store_n(&sp->stop, 1, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&sp->cv);
+    pthread_mutex_unlock(&sp->mu);
+    pthread_join(sp->th, NULL);
+    pthread_cond_destroy(&sp->cv);
+    pthread_mutex_destroy(&sp->mu);
+}
+
+static int same_pos(const ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng) {
+    return sp->rng == rng && memcmp(&sp->st, st, sizeof(*st)) == 0 &&
+           memcmp(&sp->hand, hand, sizeof(*hand)) == 0;
+}
+
+void ai_spec_post(ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng) {
+    pthread_mutex_lock(&sp->mu);
+    if (sp->gen == 0 || !same_pos(sp, st, hand, rng)) {
+        sp->st = *st;
+        sp->hand = *hand;
+        sp->rng = rng;
+        sp->gen++;
+        __atomic_store_n(&sp->stop, 1, __ATOMIC_RELAXED); // the old position is gone
+        pthread_cond_broadcast(&sp->cv);
+    }
+    pthread_mutex_unlock(&sp->mu);
+}
+
+// stops the run in progress and leaves the worker idle; sp->mu held
+static void spec_cancel(ai_spec_t *sp) {
+    __atomic_store_n(&sp->stop, 1, __ATOMIC_RELAXED);
+    sp->urgent = 1;
+    if (sp->busy) set_idle(sp->th, 0);
+    while (sp->busy) pthread_cond_wait(&sp->cv, &sp->mu);
+    sp->urgent = 0;
+    sp->done_gen = sp->gen;
+    sp->valid = 0;
+}
+
+int ai_spec_ready(ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng) {
+    pthread_mutex_lock(&sp->mu);
+    int ready = sp->gen != 0 && sp->done_gen == sp->gen && sp->valid && same_pos(sp, st, hand, rng);
+    pthread_mutex_unlock(&sp->mu);
+    return ready;
+}
+
+int ai_spec_take(ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng, int wait,
+                 ai_plan_t *out) {
+    pthread_mutex_lock(&sp->mu);
+    if (sp->gen == 0 || !same_pos(sp, st, hand, rng) ||
+        (!wait && sp->done_gen != sp->gen)) {
+        // not what was posted, or not done and no CPU to finish it on
+        spec_cancel(sp);
+        pthread_mutex_unlock(&sp->mu);
+        return 0;
+    }
+    int waited = 0;
+    while (sp->done_gen != sp->gen) { // queued or running: it has a head start
+        if (!waited) {
+            sp->urgent = 1; // the player is waiting for it now
+            if (sp->busy) set_idle(sp->th, 0);
+        }
+        waited = 1;
+        pthread_cond_wait(&sp->cv, &sp->mu);
+    }
+    sp->urgent = 0;
+    int hit = sp->valid;
+    if (hit) *out = sp->plan;
+    pthread_mutex_unlock(&sp->mu);
+    return hit ? 1 + waited : 0;
+}
+
+int ai_pick_plan(const state_t *st, const hand_t *hand, void *ctx) {
+    (void)st; (void)hand;
+    ai_plan_cursor_t *c = (ai_plan_cursor_t*)ctx;
+    return c->i < c->plan->n ? c->plan->idx[c->i++] : -1;
+}
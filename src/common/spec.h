@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include <pthread.h>
+#include "engine.h"
+
+/* ---------------------------
+ *  AI speculation
+ * ---------------------------
+ * While the player thinks, a worker thread plays the AI turn that would
+ * follow an END_TURN from the current position (state, hand, rng): the END
+ * phase, the AI's draw, then the policy's picks. That turn is fully decided
+ * by the position, so its picks stay good for as long as the position does.
+ * Posting a new position stops the run in progress: the policy should watch
+ * `stop` (ai_search_t.stop, ai_cached_t.stop). On END_TURN, ai_spec_take
+ * hands over the picks if they were made for exactly the current position,
+ * and the AI turn only replays them (ai_pick_plan). The worker runs under
+ * SCHED_IDLE, so it only uses CPU that requests do not need; a take that
+ * has to wait for it puts it back to normal priority, so the caller must
+ * hold whatever CPU budget a search of its own would need.
+ */
+
+#define SPEC_MAX_PICKS 8
+
+typedef struct {
+    uint8_t n;
+    int8_t  idx[SPEC_MAX_PICKS]; // what the policy returned, in order
+} ai_plan_t;
+
+typedef struct {
+    pthread_t th;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    ai_policy_t pol;     // runs on the worker; its ctx belongs to the worker
+    int stop;            // set with __atomic: abandon the current run
+    int quit;
+
+    // guarded by mu
+    state_t st;          // position of gen
+    hand_t hand;
+    uint32_t rng;
+    uint64_t gen;        // bumped by every post
+    uint64_t done_gen;   // the last gen the worker is finished with
+    int busy;
+    int urgent;          // a take is waiting: run at normal priority
+    int valid;           // plan is the complete turn for done_gen
+    ai_plan_t plan;
+
+    uint64_t runs, cancelled; // finished / stopped runs
+} ai_spec_t;
+
+// Starts the worker. 0 ok, -1 no thread
+int  ai_spec_start(ai_spec_t *sp, ai_policy_t pol);
+void ai_spec_stop(ai_spec_t *sp);
+
+// Position the player is looking at now; the same one again is a no-op
+void ai_spec_post(ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng);
+
+// 1 if the picks for exactly this position are finished: a take would not wait
+int ai_spec_ready(ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng);
+
+// Picks for exactly this position: 1 ready, 2 ready after waiting for the
+// run to finish, 0 none (another position, or the run was stopped). With
+// wait 0 an unfinished run is stopped instead of waited on: the caller has
+// no CPU budget to finish it with. The worker is idle when it returns, so
+// the policy's ctx may be read.
+int ai_spec_take(ai_spec_t *sp, const state_t *st, const hand_t *hand, uint32_t rng, int wait,
+                 ai_plan_t *out);
+
+// ai_pick_fn replaying a plan; ctx is ai_plan_cursor_t*
+typedef struct {
+    const ai_plan_t *plan;
+    int i;
+} ai_plan_cursor_t;
+
+int ai_pick_plan(const state_t *st, const hand_t *hand, void *ctx);
@@ -0,0 +1,297 @@
+#include "wire.h"
+#include <string.h>
+
+int wire_put_varint(uint8_t *out, size_t cap, uint32_t v) {
+    size_t n = 0;
+    do {
+        if (n == cap) return -1;
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        out[n++] = b | (v ? 0x80 : 0);
+    } while (v);
+    return (int)n;
+}
+
+int wire_get_varint(const uint8_t *in, size_t len, uint32_t *v) {
+    uint32_t x = 0;
+    for (size_t i = 0; i < 5; i++) {
+        if (i == len) return 0;
+        x |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) { *v = x; return (int)i + 1; }
+    }
+    return -1;
+}
+
+static uint32_t zz(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int32_t unzz(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+/* ---------- Cursor over a compact payload ---------- */
+
+typedef struct {
+    uint8_t *p;
+    const uint8_t *q;
+    uint32_t n, cap;
+    int bad;
+} wcur_t;
+
+static void put_u(wcur_t *w, uint32_t v) {
+    int k = wire_put_varint(w->p + w->n, w->cap - w->n, v);
+    if (k < 0) w->bad = 1; else w->n += (uint32_t)k;
+}
+static void put_s(wcur_t *w, int32_t v) { put_u(w, zz(v)); }
+static void put_b(wcur_t *w, uint8_t v) {
+    if (w->n == w->cap) w->bad = 1; else w->p[w->n++] = v;
+}
+
+static uint32_t get_u(wcur_t *r) {
+    uint32_t v = 0;
+    int k = r->bad ? -1 : wire_get_varint(r->q + r->n, r->cap - r->n, &v);
+    if (k <= 0) { r->bad = 1; return 0; }
+    r->n += (uint32_t)k;
+    return v;
+}
+static int32_t get_s(wcur_t *r) { return unzz(get_u(r)); }
+static uint8_t get_b(wcur_t *r) {
+    if (r->bad || r->n == r->cap) { r->bad = 1; return 0; }
+    return r->q[r->n++];
+}
+
+/* ---------- Per opcode ---------- */
+
+int wire_compact_op(uint16_t op) {
+    return op == OP_STATE || op == OP_HAND || op == OP_ERROR ||
+           op == OP_PLAY_ACK || op == OP_PLAY_CARD || op == OP_AI_PLAY;
+}
+
+static void put_event(wcur_t *w, const game_event_t *e) {
+    put_u(w, e->kind);
+    put_u(w, e->actor);
+    put_u(w, e->card_id);
+    put_s(w, e->amount);
+    put_u(w, e->mana);
+}
+
+static void get_event(wcur_t *r, game_event_t *e) {
+    e->kind = (uint8_t)get_u(r);
+    e->actor = (uint8_t)get_u(r);
+    e->card_id = (uint16_t)get_u(r);
+    e->amount = (int16_t)get_s(r);
+    e->mana = (uint8_t)get_u(r);
+}
+
+// turn/phase/game_over/winner share one byte, the event slots in use a mask
+static void pack_state(wcur_t *w, const state_wire_t *st) {
+    put_s(w, st->p_hp);
+    put_s(w, st->ai_hp);
+    if (st->turn > 1 || st->phase > 3 || st->game_over > 1 || st->winner > 3) {
+        put_b(w, 0xFF); // not representable in the flag byte
+        put_b(w, st->turn); put_b(w, st->phase); put_b(w, st->game_over); put_b(w, st->winner);
+    } else {
+        put_b(w, (uint8_t)(st->turn | st->phase << 1 | st->game_over << 3 | st->winner << 4));
+    }
+    put_u(w, st->mana);
+    put_u(w, st->max_mana);
+    put_s(w, st->p_shield);
+    put_s(w, st->ai_shield);
+    put_s(w, st->p_buff);
+    put_s(w, st->ai_buff);
+    put_u(w, st->p_poison);
+    put_u(w, st->ai_poison);
+
+    uint8_t used = 0;
+    for (int i = 0; i < LOG_LINES; i++)
+        if (memcmp(&st->events[i], &(game_event_t){0}, sizeof(game_event_t)) != 0) used |= (uint8_t)(1u << i);
+    put_b(w, st->ev_head);
+    put_b(w, used);
+    for (int i = 0; i < LOG_LINES; i++) {
+        if (!(used & (1u << i))) continue;
+        put_event(w, &st->events[i]);
+    }
+}
+
+static void unpack_state(wcur_t *r, state_wire_t *st) {
+    memset(st, 0, sizeof(*st));
+    st->p_hp = (int16_t)get_s(r);
+    st->ai_hp = (int16_t)get_s(r);
+    uint8_t f = get_b(r);
+    if (f == 0xFF) {
+        st->turn = get_b(r); st->phase = get_b(r); st->game_over = get_b(r); st->winner = get_b(r);
+    } else {
+        st->turn = f & 1;
+        st->phase = (f >> 1) & 3;
+        st->game_over = (f >> 3) & 1;
+        st->winner = (f >> 4) & 3;
+    }
+    st->mana = (uint8_t)get_u(r);
+    st->max_mana = (uint8_t)get_u(r);
+    st->p_shield = (int16_t)get_s(r);
+    st->ai_shield = (int16_t)get_s(r);
+    st->p_buff = (int16_t)get_s(r);
+    st->ai_buff = (int16_t)get_s(r);
+    st->p_poison = (uint8_t)get_u(r);
+    st->ai_poison = (uint8_t)get_u(r);
+
+    st->ev_head = get_b(r);
+    uint8_t used = get_b(r);
+    for (int i = 0; i < LOG_LINES; i++) {
+        if (!(used & (1u << i))) continue;
+        get_event(r, &st->events[i]);
+    }
+}
+
+int wire_pack(uint16_t op, const void *in, uint32_t len, uint8_t *out, uint32_t cap) {
+    wcur_t w = { .p = out, .cap = cap };
+    switch (op) {
+        case OP_STATE:
+            if (len != sizeof(state_wire_t)) return -1;
+            pack_state(&w, (const state_wire_t*)in);
+            break;
+        case OP_HAND: {
+            if (len != sizeof(hand_t)) return -1;
+            const hand_t *h = (const hand_t*)in;
+            uint8_t n = h->n > 8 ? 8 : h->n;
+            put_b(&w, n);
+            for (int i = 0; i < n; i++) put_u(&w, h->card_ids[i]);
+            break;
+        }
+        case OP_ERROR: {
+            if (len != sizeof(error_t)) return -1;
+            int32_t code;
+            memcpy(&code, in, sizeof(code));
+            put_s(&w, code);
+            break;
+        }
+        case OP_PLAY_ACK: {
+            if (len != sizeof(play_ack_t)) return -1;
+            play_ack_t a;
+            memcpy(&a, in, sizeof(a));
+            put_u(&w, a.seq);
+            put_s(&w, a.rc);
+            break;
+        }
+        case OP_PLAY_CARD: {
+            // hand_idx << 1 | tagged, then the seq of a tagged play. The bit,
+            // not the length, says whether a seq follows: bytes appended
+            // after an untagged play must stay skippable
+            if (len != sizeof(play_req_t) && len != sizeof(play_seq_req_t)) return -1;
+            put_u(&w, (uint32_t)((const uint8_t*)in)[0] << 1 | (len == sizeof(play_seq_req_t)));
+            if (len == sizeof(play_seq_req_t)) {
+                play_seq_req_t pr;
+                memcpy(&pr, in, sizeof(pr));
+                put_u(&w, pr.seq);
+            }
+            break;
+        }
+        case OP_AI_PLAY: {
+            if (len != sizeof(ai_play_t)) return -1;
+            ai_play_t ap;
+            memcpy(&ap, in, sizeof(ap));
+            put_u(&w, ap.step);
+            put_event(&w, &ap.ev);
+            put_s(&w, ap.p_hp);
+            put_s(&w, ap.ai_hp);
+            put_s(&w, ap.p_shield);
+            put_s(&w, ap.ai_shield);
+            break;
+        }
+        default:
+            if (len > cap) return -1;
+            if (len) memcpy(out, in, len);
+            return (int)len;
+    }
+    return w.bad ? -1 : (int)w.n;
+}
+
+int wire_unpack(uint16_t op, const uint8_t *in, uint32_t len, void *out, uint32_t cap) {
+    wcur_t r = { .q = in, .cap = len };
+    uint32_t size;
+    switch (op) {
+        case OP_STATE:
+            if (cap < sizeof(state_wire_t)) return -1;
+            unpack_state(&r, (state_wire_t*)out);
+            size = sizeof(state_wire_t);
+            break;
+        case OP_HAND: {
+            if (cap < sizeof(hand_t)) return -1;
+            hand_t h;
+            memset(&h, 0, sizeof(h));
+            h.n = get_b(&r);
+            if (h.n > 8) return -1;
+            for (int i = 0; i < h.n; i++) h.card_ids[i] = (uint16_t)get_u(&r);
+            memcpy(out, &h, sizeof(h));
+            size = sizeof(hand_t);
+            break;
+        }
+        case OP_ERROR: {
+            if (cap < sizeof(error_t)) return -1;
+            error_t e;
+            memset(&e, 0, sizeof(e));
+            e.code = get_s(&r);
+            strncpy(e.msg, wire_error_text(e.code), sizeof(e.msg) - 1);
+            memcpy(out, &e, sizeof(e));
+            size = sizeof(error_t);
+            break;
+        }
+        case OP_PLAY_ACK: {
+            if (cap < sizeof(play_ack_t)) return -1;
+            play_ack_t a;
+            a.seq = get_u(&r);
+            a.rc = get_s(&r);
+            memcpy(out, &a, sizeof(a));
+            size = sizeof(play_ack_t);
+            break;
+        }
+        case OP_PLAY_CARD: {
+            if (cap < sizeof(play_seq_req_t)) return -1;
+            play_seq_req_t pr;
+            uint32_t v = get_u(&r);
+            if (v >> 1 > 0xFF) return -1;
+            pr.hand_idx = (uint8_t)(v >> 1);
+            if (!(v & 1)) { // untagged
+                if (r.bad) return -1;
+                memcpy(out, &pr, sizeof(play_req_t));
+                size = sizeof(play_req_t);
+                break;
+            }
+            pr.seq = get_u(&r);
+            memcpy(out, &pr, sizeof(pr));
+            size = sizeof(play_seq_req_t);
+            break;
+        }
+        case OP_AI_PLAY: {
+            if (cap < sizeof(ai_play_t)) return -1;
+            ai_play_t ap;
+            ap.step = (uint8_t)get_u(&r);
+            get_event(&r, &ap.ev);
+            ap.p_hp = (int16_t)get_s(&r);
+            ap.ai_hp = (int16_t)get_s(&r);
+            ap.p_shield = (int16_t)get_s(&r);
+            ap.ai_shield = (int16_t)get_s(&r);
+            memcpy(out, &ap, sizeof(ap));
+            size = sizeof(ai_play_t);
+            break;
+        }
+        default:
+            if (len > cap) return -1;
+            if (len) memcpy(out, in, len);
+            return (int)len;
+    }
+    // trailing bytes: fields a newer sender appended, skipped
+    if (r.bad) return -1;
+    return (int)size;
+}
+
+const char* wire_error_text(int32_t code) {
+    switch (code) {
+        case -1:   return "invalid hand idx";
+        case -2:   return "not enough mana";
+        case -3:   return "invalid card";
+        case -10:  return "bad payload";
+        case -11:  return "not your turn";
+        case -12:  return "phase error";
+        case -14:  return "already in a session";
+        case -99:  return "unknown opcode";
+        case -999: return "server full";
+        default:   return "error";
+    }
+}
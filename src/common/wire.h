@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "proto.h"
+
+/* ---------------------------
+ *  Compact payloads (protocol v3)
+ * ---------------------------
+ * The packed structs stay the in-memory form on both sides; v3 only changes
+ * how they travel. Numbers are LEB128 varints (signed ones zigzag first),
+ * a hand carries n ids instead of 8 slots, an error is just its code (the
+ * text comes from wire_error_text) and a state sends only the used event
+ * slots. Unpacking gives back the exact bytes that were packed, so the
+ * prediction's memcmp against server states keeps working. Bytes after the
+ * fields this build knows are skipped, so a later version can append some.
+ * Opcodes without a compact form travel as their raw bytes.
+ */
+
+// bytes written / read; get: 0 = need more, -1 = malformed
+int wire_put_varint(uint8_t *out, size_t cap, uint32_t v);
+int wire_get_varint(const uint8_t *in, size_t len, uint32_t *v);
+
+// 1 if op's payload has a compact form
+int wire_compact_op(uint16_t op);
+
+// struct -> compact: bytes written, -1 if it does not fit or has the wrong size
+int wire_pack(uint16_t op, const void *in, uint32_t len, uint8_t *out, uint32_t cap);
+// compact -> struct: struct size written, -1 malformed
+int wire_unpack(uint16_t op, const uint8_t *in, uint32_t len, void *out, uint32_t cap);
+
+// Text for an OP_ERROR code ("error" for unknown codes)
+const char* wire_error_text(int32_t code);
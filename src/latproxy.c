@@ -0,0 +1,252 @@
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * latproxy: TCP relay that adds latency, to try clients over a "mobile" link
+ * on one machine.
+ *
+ *   ./latproxy LISTEN_PORT HOST PORT [--delay MS] [--jitter MS]
+ *
+ * Every chunk read from one side is delivered to the other side --delay ms
+ * later (each direction, so a round trip gains twice that), plus a uniform
+ * 0..--jitter ms. Chunks never overtake each other, as on a real TCP path.
+ * TLS passes through untouched.
+ *
+ *   ./server 9000 &
+ *   ./latproxy 9200 127.0.0.1 9000 --delay 75 --jitter 20 &
+ *   ./client --app 127.0.0.1 9200
+ */
+
+#define MAX_PAIRS 64
+#define CHUNK     4096
+
+typedef struct chunk {
+    struct chunk *next;
+    long long due;
+    uint32_t len, off;   // len == 0: the source closed (deliver as FIN)
+    uint8_t data[];
+} chunk_t;
+
+typedef struct {
+    chunk_t *head, *tail;
+    long long last_due;
+    int eof_read;        // source reached EOF (FIN queued)
+    int eof_sent;        // FIN delivered
+} dir_t;
+
+typedef struct {
+    int fd[2];           // 0 = client side, 1 = server side
+    dir_t d[2];          // d[i]: bytes read from fd[i], written to fd[1 - i]
+    int used;
+} pair_t;
+
+static pair_t g_pairs[MAX_PAIRS];
+static double g_delay_ms = 50, g_jitter_ms = 0;
+static struct sockaddr_storage g_up;
+static socklen_t g_uplen;
+static uint32_t g_rng = 2463534242u;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double rand01(void) {
+    g_rng ^= g_rng << 13; g_rng ^= g_rng >> 17; g_rng ^= g_rng << 5;
+    return (g_rng >> 8) / 16777216.0;
+}
+
+static void set_nonblock(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static void dir_push(dir_t *d, const uint8_t *buf, uint32_t len) {
+    chunk_t *c = malloc(sizeof(chunk_t) + len);
+    if (!c) return;
+    long long due = now_ns() + (long long)((g_delay_ms + rand01() * g_jitter_ms) * 1e6);
+    if (due < d->last_due) due = d->last_due; // keep stream order
+    d->last_due = due;
+    c->next = NULL;
+    c->due = due;
+    c->len = len;
+    c->off = 0;
+    if (len) memcpy(c->data, buf, len);
+    if (d->tail) d->tail->next = c; else d->head = c;
+    d->tail = c;
+}
+
+static void pair_close(pair_t *p) {
+    for (int i = 0; i < 2; i++) {
+        if (p->fd[i] >= 0) close(p->fd[i]);
+        chunk_t *c = p->d[i].head;
+        while (c) { chunk_t *n = c->next; free(c); c = n; }
+    }
+    memset(p, 0, sizeof(*p));
+    p->fd[0] = p->fd[1] = -1;
+}
+
+static void on_accept(int lfd) {
+    int cfd = accept(lfd, NULL, NULL);
+    if (cfd < 0) return;
+    pair_t *p = NULL;
+    for (int i = 0; i < MAX_PAIRS; i++) if (!g_pairs[i].used) { p = &g_pairs[i]; break; }
+    if (!p) { close(cfd); return; }
+
+    // connecting upstream is not delayed: the handshake sees the delay anyway
+    int ufd = socket(g_up.ss_family, SOCK_STREAM, 0);
+    if (ufd < 0 || connect(ufd, (struct sockaddr*)&g_up, g_uplen) != 0) {
+        perror("upstream connect");
+        if (ufd >= 0) close(ufd);
+        close(cfd);
+        return;
+    }
+    set_nonblock(cfd);
+    set_nonblock(ufd);
+    memset(p, 0, sizeof(*p));
+    p->fd[0] = cfd;
+    p->fd[1] = ufd;
+    p->used = 1;
+}
+
+// Reads what is there from fd[i]. 0 ok, -1 pair broken
+static int pump_in(pair_t *p, int i) {
+    uint8_t buf[CHUNK];
+    for (;;) {
+        ssize_t r = read(p->fd[i], buf, sizeof(buf));
+        if (r > 0) { dir_push(&p->d[i], buf, (uint32_t)r); continue; }
+        if (r == 0) { p->d[i].eof_read = 1; dir_push(&p->d[i], NULL, 0); return 0; }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        if (errno == EINTR) continue;
+        return -1;
+    }
+}
+
+// Delivers due chunks of d[i] to fd[1 - i]. 0 ok, -1 pair broken
+static int pump_out(pair_t *p, int i, long long now) {
+    dir_t *d = &p->d[i];
+    int out = p->fd[1 - i];
+    while (d->head && d->head->due <= now) {
+        chunk_t *c = d->head;
+        if (c->len == 0) {
+            shutdown(out, SHUT_WR);
+            d->eof_sent = 1;
+        } else {
+            while (c->off < c->len) {
+                ssize_t w = write(out, c->data + c->off, c->len - c->off);
+                if (w < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+                    if (errno == EINTR) continue;
+                    return -1;
+                }
+                c->off += (uint32_t)w;
+            }
+        }
+        d->head = c->next;
+        if (!d->head) d->tail = NULL;
+        free(c);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s LISTEN_PORT HOST PORT [--delay MS] [--jitter MS]\n", argv[0]);
+        return 2;
+    }
+    uint16_t lport = (uint16_t)atoi(argv[1]);
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "--delay") == 0 && i + 1 < argc) g_delay_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) g_jitter_ms = atof(argv[++i]);
+        else { fprintf(stderr, "unknown option %s\n", argv[i]); return 2; }
+    }
+    if (g_delay_ms < 0) g_delay_ms = 0;
+    if (g_jitter_ms < 0) g_jitter_ms = 0;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(argv[2], argv[3], &hints, &res) != 0 || !res) {
+        fprintf(stderr, "cannot resolve %s\n", argv[2]);
+        return 1;
+    }
+    memcpy(&g_up, res->ai_addr, res->ai_addrlen);
+    g_uplen = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    signal(SIGPIPE, SIG_IGN);
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in la = { .sin_family = AF_INET, .sin_port = htons(lport), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&la, sizeof(la)) != 0 || listen(lfd, 64) != 0) {
+        perror("listen");
+        return 1;
+    }
+    for (int i = 0; i < MAX_PAIRS; i++) g_pairs[i].fd[0] = g_pairs[i].fd[1] = -1;
+    printf("[latproxy] :%u -> %s:%s, +%.0f ms each way (jitter %.0f ms)\n",
+           lport, argv[2], argv[3], g_delay_ms, g_jitter_ms);
+    fflush(stdout);
+
+    struct pollfd pf[1 + 2 * MAX_PAIRS];
+    int owner[1 + 2 * MAX_PAIRS];
+    for (;;) {
+        long long now = now_ns();
+        long long next_due = -1;
+        int n = 0;
+        pf[n].fd = lfd; pf[n].events = POLLIN; owner[n++] = -1;
+        for (int k = 0; k < MAX_PAIRS; k++) {
+            pair_t *p = &g_pairs[k];
+            if (!p->used) continue;
+            for (int i = 0; i < 2; i++) {
+                short ev = 0;
+                if (!p->d[i].eof_read) ev |= POLLIN;
+                const chunk_t *h = p->d[1 - i].head; // waiting to be written to fd[i]
+                if (h) {
+                    if (h->due <= now) ev |= POLLOUT;
+                    else if (next_due < 0 || h->due < next_due) next_due = h->due;
+                }
+                pf[n].fd = p->fd[i]; pf[n].events = ev; owner[n++] = k * 2 + i;
+            }
+        }
+        int timeout = -1;
+        if (next_due >= 0) timeout = (int)((next_due - now + 999999) / 1000000);
+        if (poll(pf, (nfds_t)n, timeout) < 0 && errno != EINTR) { perror("poll"); return 1; }
+
+        now = now_ns();
+        for (int j = 0; j < n; j++) {
+            if (owner[j] < 0) {
+                if (pf[j].revents & POLLIN) on_accept(lfd);
+                continue;
+            }
+            pair_t *p = &g_pairs[owner[j] / 2];
+            int i = owner[j] % 2;
+            if (!p->used) continue;
+            if ((pf[j].revents & (POLLIN | POLLHUP | POLLERR)) && !p->d[i].eof_read && pump_in(p, i) != 0) {
+                pair_close(p);
+                continue;
+            }
+        }
+        for (int k = 0; k < MAX_PAIRS; k++) {
+            pair_t *p = &g_pairs[k];
+            if (!p->used) continue;
+            if (pump_out(p, 0, now) != 0 || pump_out(p, 1, now) != 0) { pair_close(p); continue; }
+            if (p->d[0].eof_sent && p->d[1].eof_sent) pair_close(p);
+        }
+    }
+}
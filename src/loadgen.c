@@ -0,0 +1,1417 @@
+#define _DEFAULT_SOURCE
+#include "loadgen.h"
+#include "common/proto.h"
+#include "common/evlog.h"
+#include "common/hist.h"
+#include "common/cards.h"
+#include "common/ai.h"
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/err.h>
+
+#ifndef IP_BIND_ADDRESS_NO_PORT
+#define IP_BIND_ADDRESS_NO_PORT 24
+#endif
+
+#define LG_IN_CAP   512   // largest reply is state_legacy_t (we announce CAP_EVENT_LOG anyway)
+#define LG_OUT_CAP  64
+#define LG_MAX_BIND 16
+
+enum { LS_IDLE = 0, LS_CONNECT, LS_TLS, LS_RUN, LS_DONE };
+enum { RQ_LOGIN = 0, RQ_PLAY, RQ_END, RQ_PING, RQ_RESUME, RQ_INVALID };
+enum { FAIL_CONNECT = 0, FAIL_TLS, FAIL_IO, FAIL_TIMEOUT, FAIL_RESUME, FAIL_KINDS };
+
+// timed operations; a request's op is LG_OP_LOGIN + its RQ_* value
+// (end_first: END_TURN until its first reply packet, the streamed ack with CAP_AI_STREAM)
+enum { LG_OP_HANDSHAKE = 0, LG_OP_LOGIN, LG_OP_PLAY, LG_OP_END, LG_OP_PING, LG_OP_RESUME, LG_OP_INVALID,
+       LG_OP_END_FIRST, LG_OPS };
+
+static const char *g_fail_names[FAIL_KINDS] = { "connect", "tls", "io", "timeout", "resume" };
+static const char *g_op_names[LG_OPS] = { "handshake", "login", "play", "end_turn", "ping", "resume", "invalid", "end_first" };
+static const char *g_kind_names[] = { "rounds", "game", "idle" };
+static const char *g_policy_names[] = { "greedy", "search", "random", "first" };
+
+typedef struct {
+    int fd;
+    SSL *ssl;
+    uint8_t ls;            // LS_*
+    uint8_t rq;            // request in flight (RQ_*)
+    uint8_t next_rq;       // request to send next
+    uint8_t waiting;       // a request is in flight
+    uint8_t ready;         // logged in at least once (open loop)
+    uint8_t over;          // game over seen
+    uint8_t idx0;          // session 0: prints states
+    uint8_t beh;           // scenario behavior
+    uint8_t resuming;      // reconnected after a drop: RESUME instead of LOGIN
+    uint8_t stalled;       // silent on purpose, waiting for the server to hang up
+    uint8_t first_seen;    // the request in flight got its first reply packet
+    uint16_t end_op;       // opcode that completes the reply in flight
+    uint64_t sid;          // from the login's RESUME_RESP
+    int round;
+    int pings_left;
+    int plays_left;        // game: cards still to play this turn
+    long long idle_end;    // idle: leave at
+    long long due;         // think timer armed for this time (0 = none)
+    uint32_t events;       // current epoll interest
+    long long t_conn;      // connect() called
+    long long t_req;       // request due (open loop: intended send time)
+    long long t_sent;      // request actually written
+    long long t_drop;      // disconnected on purpose (resume latency starts here)
+    long long last_io;
+    long long lat_sum;
+    state_t st;            // last OP_STATE / OP_HAND, what the bot decides on
+    hand_t hand;
+    uint16_t in_len, out_len, out_off;
+    uint8_t in[LG_IN_CAP];
+    uint8_t out[LG_OUT_CAP];
+} lg_sess_t;
+
+// per scenario behavior
+typedef struct {
+    long long players, ok, fail, games, wins, errors, resumes;
+    long long abandons, stalls, timeouts; // timeouts: the server hung up on a stall
+} lg_beh_stats_t;
+
+typedef struct {
+    long long due;
+    int idx;
+} lg_timer_t;
+
+// one open-loop rate step
+typedef struct {
+    hist_t lat;            // from intended send time (includes queueing)
+    hist_t svc;            // from actual send time
+    long long offered, done, backlog_max;
+} lg_step_t;
+
+typedef struct {
+    const lg_config_t *cfg;
+    SSL_CTX *ctx;
+    int id;
+    int epfd;
+
+    lg_sess_t *sess;       // this thread's slice
+    int nsess;
+    int next_start;
+    long long next_start_ns;
+    long long interval_ns; // 0 = start as fast as possible
+
+    int active, finished;
+    long long ok, fail[FAIL_KINDS];
+    long long lat_sum, lat_min, lat_max;
+    long long last_start_ns;
+    hist_t hist[LG_OPS];   // per-thread, merged at the end
+    uint32_t rng;
+    lg_beh_stats_t bst[LG_MAX_BEHAVIORS];
+
+    // think timers: min-heap on due time; a re-armed session leaves its old
+    // entry behind until it pops, so the heap grows when it has to
+    lg_timer_t *timers;
+    int ntimers, timers_cap;
+
+    long long soak_end;    // closed loop: restart finished slots until then (0 = no)
+    long long restarts;
+
+    // open loop
+    int ready;             // sessions that logged in
+    int busy;              // scheduled requests in flight
+    int step;              // -1 = pool warming up, nrates = done generating
+    long long next_send_ns;
+    long long end_ns;      // generation stops here
+    long long *backlog;    // due times not yet sent (FIFO ring)
+    size_t bl_head, bl_len, bl_cap;
+    int *idle;             // idle session indices (FIFO ring, nsess slots)
+    int idle_head, idle_len;
+    long long reconnects, unfinished;
+    lg_step_t *steps;
+} lg_thread_t;
+
+static struct sockaddr_storage g_addr;
+static socklen_t g_addrlen;
+static struct sockaddr_storage g_bind[LG_MAX_BIND];
+static int g_nbind;
+
+static atomic_int g_active;
+static atomic_int g_peak;
+
+// open loop: all threads start the first step together
+static atomic_int g_threads_ready;
+static atomic_llong g_steps_t0;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int is_open(const lg_config_t *cfg) { return cfg->nrates > 0; }
+
+static const lg_behavior_t* beh_of(const lg_thread_t *t, const lg_sess_t *s) {
+    return &t->cfg->scenario->b[s->beh];
+}
+
+static double rand01(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    *s = x;
+    return ((double)x + 1.0) / 4294967297.0; // (0, 1)
+}
+
+/* ---------- session lifecycle ---------- */
+
+static void set_interest(lg_thread_t *t, lg_sess_t *s, uint32_t ev) {
+    if (s->events == ev) return;
+    struct epoll_event e = { .events = ev, .data.ptr = s };
+    epoll_ctl(t->epfd, s->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, s->fd, &e);
+    s->events = ev;
+}
+
+// abrupt: no close_notify, like a client that lost its network
+static void sess_release(lg_sess_t *s, int abrupt) {
+    if (s->ssl) {
+        if (s->ls == LS_RUN && !abrupt) SSL_shutdown(s->ssl); // best effort, non-blocking
+        SSL_free(s->ssl);
+        s->ssl = NULL;
+    }
+    if (s->fd >= 0) close(s->fd); // also leaves the epoll set
+    s->fd = -1;
+    s->events = 0;
+}
+
+static void timer_push(lg_thread_t *t, lg_sess_t *s, long long due);
+
+static void sess_close(lg_thread_t *t, lg_sess_t *s) {
+    if (s->waiting && s->rq != RQ_LOGIN && is_open(t->cfg)) t->busy--;
+    s->waiting = 0;
+    sess_release(s, 0);
+    t->active--;
+    atomic_fetch_sub(&g_active, 1);
+    long long now = now_ns();
+    if (t->soak_end && now < t->soak_end) {
+        // soak: a new player takes the slot shortly (lg_thread's timer loop)
+        s->ls = LS_IDLE;
+        timer_push(t, s, now + 10000000LL);
+        return;
+    }
+    s->ls = LS_DONE;
+    t->finished++;
+}
+
+static void sess_fail(lg_thread_t *t, lg_sess_t *s, int why) {
+    t->fail[why]++;
+    t->bst[s->beh].fail++;
+    sess_close(t, s);
+}
+
+static void sess_ok(lg_thread_t *t, lg_sess_t *s) {
+    t->ok++;
+    t->bst[s->beh].ok++;
+    t->lat_sum += s->lat_sum;
+    if (s->lat_sum < t->lat_min) t->lat_min = s->lat_sum;
+    if (s->lat_sum > t->lat_max) t->lat_max = s->lat_sum;
+    sess_close(t, s);
+}
+
+static uint32_t lg_caps(const lg_config_t *cfg) {
+    return CAP_EVENT_LOG | (cfg->no_ai_stream ? 0 : CAP_AI_STREAM);
+}
+
+static void queue_req(lg_sess_t *s, uint16_t op, const void *payload, uint32_t plen, uint8_t rq) {
+    int n = proto_encode(s->out + s->out_len, LG_OUT_CAP - s->out_len, op, payload, plen);
+    if (n > 0) s->out_len = (uint16_t)(s->out_len + n);
+    s->rq = rq;
+    s->end_op = (rq == RQ_PING) ? OP_PONG : OP_HAND;
+    s->waiting = 1;
+    s->first_seen = 0;
+    s->t_req = s->t_sent = now_ns();
+}
+
+// socket + non-blocking connect; the rest happens in drive()
+static int sess_connect(lg_thread_t *t, lg_sess_t *s) {
+    int idx = (int)(s - t->sess);
+    s->ls = LS_CONNECT;
+    s->in_len = s->out_len = s->out_off = 0;
+    s->over = 0;
+    s->due = 0;
+    s->last_io = s->t_conn = now_ns();
+
+    s->fd = socket(g_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s->fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (g_nbind > 0) {
+        // port chosen at connect(): each local address gets its own ephemeral range
+        setsockopt(s->fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+        const struct sockaddr_storage *b = &g_bind[(t->id + idx) % g_nbind];
+        socklen_t bl = (b->ss_family == AF_INET6) ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+        if (bind(s->fd, (const struct sockaddr*)b, bl) != 0) return -1;
+    }
+
+    if (connect(s->fd, (struct sockaddr*)&g_addr, g_addrlen) != 0 && errno != EINPROGRESS) return -1;
+    set_interest(t, s, EPOLLOUT);
+    return 0;
+}
+
+static void start_session(lg_thread_t *t, lg_sess_t *s) {
+    int idx = (int)(s - t->sess);
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+    s->idx0 = (t->cfg->verbose && t->id == 0 && idx == 0);
+
+    // weighted pick of this player's behavior
+    const lg_scenario_t *sc = t->cfg->scenario;
+    double total = 0;
+    for (int k = 0; k < sc->n; k++) total += sc->b[k].weight;
+    double x = rand01(&t->rng) * total;
+    while (s->beh + 1 < sc->n && x >= sc->b[s->beh].weight) x -= sc->b[s->beh++].weight;
+    t->bst[s->beh].players++;
+
+    t->active++;
+    int a = atomic_fetch_add(&g_active, 1) + 1;
+    int p = atomic_load(&g_peak);
+    while (a > p && !atomic_compare_exchange_weak(&g_peak, &p, a)) {}
+
+    if (sess_connect(t, s) != 0) sess_fail(t, s, FAIL_CONNECT);
+}
+
+/* ---------- open loop: backlog and idle pool ---------- */
+
+static void backlog_push(lg_thread_t *t, long long due, int front) {
+    if (t->bl_len == t->bl_cap) {
+        size_t cap = t->bl_cap ? t->bl_cap * 2 : 4096;
+        long long *nb = malloc(cap * sizeof(*nb));
+        for (size_t i = 0; i < t->bl_len; i++) nb[i] = t->backlog[(t->bl_head + i) % t->bl_cap];
+        free(t->backlog);
+        t->backlog = nb;
+        t->bl_cap = cap;
+        t->bl_head = 0;
+    }
+    if (front) {
+        t->bl_head = (t->bl_head + t->bl_cap - 1) % t->bl_cap;
+        t->backlog[t->bl_head] = due;
+    } else {
+        t->backlog[(t->bl_head + t->bl_len) % t->bl_cap] = due;
+    }
+    t->bl_len++;
+}
+
+static long long backlog_pop(lg_thread_t *t) {
+    long long due = t->backlog[t->bl_head];
+    t->bl_head = (t->bl_head + 1) % t->bl_cap;
+    t->bl_len--;
+    return due;
+}
+
+static void idle_push(lg_thread_t *t, lg_sess_t *s) {
+    t->idle[(t->idle_head + t->idle_len) % t->nsess] = (int)(s - t->sess);
+    t->idle_len++;
+}
+
+static lg_sess_t* idle_pop(lg_thread_t *t) {
+    while (t->idle_len > 0) {
+        lg_sess_t *s = &t->sess[t->idle[t->idle_head]];
+        t->idle_head = (t->idle_head + 1) % t->nsess;
+        t->idle_len--;
+        if (s->ls == LS_RUN && !s->waiting) return s; // skip sessions that died while idle
+    }
+    return NULL;
+}
+
+// Open loop: the server closed a connection (game over, idle timeout, error).
+// Reconnect it; a scheduled request that was in flight goes back to the head
+// of the backlog with its original due time, so the reconnect shows up in
+// its latency.
+static void sess_recycle(lg_thread_t *t, lg_sess_t *s) {
+    if (s->waiting && s->rq != RQ_LOGIN) {
+        t->busy--;
+        backlog_push(t, s->t_req, 1);
+    }
+    s->waiting = 0;
+    sess_release(s, 0);
+    s->round = 0;
+    s->resuming = 0;
+    t->reconnects++;
+    if (sess_connect(t, s) != 0) sess_fail(t, s, FAIL_CONNECT);
+}
+
+static int step_of(const lg_thread_t *t, long long when) {
+    long long t0 = atomic_load(&g_steps_t0);
+    if (when < t0) return 0;
+    int k = (int)((when - t0) / (long long)(t->cfg->step_s * 1e9));
+    return k < t->cfg->nrates ? k : t->cfg->nrates - 1;
+}
+
+/* ---------- think timers ---------- */
+
+static void timer_push(lg_thread_t *t, lg_sess_t *s, long long due) {
+    if (t->ntimers == t->timers_cap) {
+        int cap = t->timers_cap * 2;
+        lg_timer_t *nt = realloc(t->timers, (size_t)cap * sizeof(lg_timer_t));
+        if (!nt) return;
+        t->timers = nt;
+        t->timers_cap = cap;
+    }
+    s->due = due;
+    int i = t->ntimers++;
+    while (i > 0) {
+        int up = (i - 1) / 2;
+        if (t->timers[up].due <= due) break;
+        t->timers[i] = t->timers[up];
+        i = up;
+    }
+    t->timers[i] = (lg_timer_t){ due, (int)(s - t->sess) };
+}
+
+static lg_timer_t timer_pop(lg_thread_t *t) {
+    lg_timer_t top = t->timers[0];
+    lg_timer_t last = t->timers[--t->ntimers];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= t->ntimers) break;
+        if (c + 1 < t->ntimers && t->timers[c + 1].due < t->timers[c].due) c++;
+        if (last.due <= t->timers[c].due) break;
+        t->timers[i] = t->timers[c];
+        i = c;
+    }
+    if (t->ntimers > 0) t->timers[i] = last;
+    return top;
+}
+
+static long long think_ns(lg_thread_t *t, const lg_behavior_t *b) {
+    double ms;
+    switch (b->think) {
+        case LG_THINK_FIXED:   ms = b->think_a; break;
+        case LG_THINK_UNIFORM: ms = b->think_a + (b->think_b - b->think_a) * rand01(&t->rng); break;
+        case LG_THINK_EXP:     ms = -log(rand01(&t->rng)) * b->think_a; break;
+        default: return 0;
+    }
+    return (long long)(ms * 1e6);
+}
+
+/* ---------- protocol ---------- */
+
+static void on_state(lg_sess_t *s, const uint8_t *p, uint32_t plen) {
+    if (state_decode(p, plen, &s->st, NULL) != 0) return;
+    const state_t st = s->st;
+    if (st.game_over) s->over = 1;
+    if (s->idx0) {
+        static const char *tag[] = { "[login]", "[play] ", "[end]  ", "[ping] ", "[resume]", "[bad]  " };
+        printf("%s HP=%d AI=%d over=%u winner=%u\n", tag[s->rq], st.p_hp, st.ai_hp, st.game_over, st.winner);
+    }
+}
+
+// a round is [pings x PING] + PLAY_CARD + END_TURN
+static void advance(int pings, lg_sess_t *s) {
+    switch (s->rq) {
+        case RQ_PING:
+            s->next_rq = (--s->pings_left > 0) ? RQ_PING : RQ_PLAY;
+            return;
+        case RQ_PLAY:
+            s->next_rq = RQ_END;
+            return;
+        case RQ_END:
+            s->round++;
+            break;
+        default:
+            break;
+    }
+    s->pings_left = pings;
+    s->next_rq = (pings > 0) ? RQ_PING : RQ_PLAY;
+}
+
+// Closed loop: picks s->next_rq after the reply to s->rq. 1 = the player is done.
+static int plan_next(const lg_behavior_t *b, lg_sess_t *s, long long now) {
+    if (s->rq == RQ_RESUME || s->rq == RQ_INVALID) return 0; // carry on where we were
+    switch (b->kind) {
+        case LG_KIND_GAME:
+            if (s->rq == RQ_PLAY) {
+                // keep playing until the bot ends the turn (or the cap is hit);
+                // `first` never runs out of a card to pick, so it plays one
+                if (b->plays > 0 ? --s->plays_left <= 0 : b->policy == LG_POLICY_FIRST) s->next_rq = RQ_END;
+                return 0;
+            }
+            if (s->rq == RQ_END && b->rounds > 0 && ++s->round >= b->rounds) return 1;
+            s->plays_left = b->plays;
+            s->next_rq = RQ_PLAY;
+            return 0;
+        case LG_KIND_IDLE:
+            if (s->rq == RQ_LOGIN) s->idle_end = now + (long long)(b->idle_s * 1e9);
+            s->next_rq = RQ_PING;
+            return now + (long long)(b->ping_ms * 1e6) > s->idle_end;
+        default:
+            if (s->rq == RQ_LOGIN && b->rounds <= 0) return 1;
+            advance(b->pings, s);
+            return s->round >= b->rounds;
+    }
+}
+
+// The bot's card for this play, -1 = nothing worth playing (end the turn)
+static int bot_pick(lg_thread_t *t, lg_sess_t *s) {
+    const lg_behavior_t *b = beh_of(t, s);
+    state_t me;
+    switch (b->policy) {
+        case LG_POLICY_FIRST:
+            return 0;
+        case LG_POLICY_RANDOM: {
+            int ok[8], n = 0;
+            for (int i = 0; i < s->hand.n && i < 8; i++) {
+                const card_def_t *c = get_card_def(s->hand.card_ids[i]);
+                if (c && c->cost <= s->st.mana) ok[n++] = i;
+            }
+            return n ? ok[(int)(rand01(&t->rng) * n)] : -1;
+        }
+        case LG_POLICY_SEARCH: {
+            ai_search_t search = { .tt = NULL, .depth = b->depth, .max_nodes = 20000 };
+            state_mirror(&s->st, &me);
+            return ai_pick_search(&me, &s->hand, &search);
+        }
+        default:
+            state_mirror(&s->st, &me);
+            return ai_pick_greedy(&me, &s->hand, NULL);
+    }
+}
+
+static void send_next(lg_thread_t *t, lg_sess_t *s) {
+    int idx = (s->next_rq == RQ_PLAY) ? bot_pick(t, s) : 0;
+    if (s->next_rq == RQ_PING) {
+        queue_req(s, OP_PING, NULL, 0, RQ_PING);
+    } else if (s->next_rq == RQ_PLAY && idx >= 0) {
+        play_req_t pc = { .hand_idx = (uint8_t)idx };
+        queue_req(s, OP_PLAY_CARD, &pc, sizeof(pc), RQ_PLAY);
+    } else {
+        queue_req(s, OP_END_TURN, NULL, 0, RQ_END);
+    }
+}
+
+// Something the server must reject with err_send, in place of a PLAY_CARD
+static void send_invalid(lg_thread_t *t, lg_sess_t *s) {
+    switch ((int)(rand01(&t->rng) * 3)) {
+        case 0: { // hand idx out of range: OP_ERROR, then STATE + HAND
+            play_req_t pc = { .hand_idx = 0xFF };
+            queue_req(s, OP_PLAY_CARD, &pc, sizeof(pc), RQ_INVALID);
+            break;
+        }
+        case 1: // no payload: OP_ERROR only
+            queue_req(s, OP_PLAY_CARD, NULL, 0, RQ_INVALID);
+            s->end_op = OP_ERROR;
+            break;
+        default: // unknown opcode: OP_ERROR only
+            queue_req(s, 0x01FF, NULL, 0, RQ_INVALID);
+            s->end_op = OP_ERROR;
+            break;
+    }
+}
+
+static void fire(lg_thread_t *t, lg_sess_t *s) {
+    const lg_behavior_t *b = beh_of(t, s);
+    s->due = 0;
+    if (s->next_rq == RQ_PLAY && b->bad > 0 && rand01(&t->rng) < b->bad) send_invalid(t, s);
+    else send_next(t, s);
+}
+
+// sends the next request now, or arms the think timer (idle: the ping interval)
+static void schedule_next(lg_thread_t *t, lg_sess_t *s) {
+    const lg_behavior_t *b = beh_of(t, s);
+    long long d = (b->kind == LG_KIND_IDLE) ? (long long)(b->ping_ms * 1e6) : think_ns(t, b);
+    if (d <= 0) fire(t, s);
+    else timer_push(t, s, now_ns() + d);
+}
+
+// OP_HAND closes every reply group (LOGIN, RESUME, PLAY_CARD even on error,
+// END_TURN), OP_PONG closes a PING, OP_ERROR a request the server rejects
+// outright. Returns 1 when the session is finished, 2 when it must reconnect
+// (open loop, game over), 3 when it should drop and resume, 4 when it
+// abandons the game, 5 when it stalls.
+static int on_reply_done(lg_thread_t *t, lg_sess_t *s) {
+    const lg_config_t *cfg = t->cfg;
+    long long now = now_ns();
+    long long dt = now - s->t_req;
+    s->lat_sum += dt;
+    s->waiting = 0;
+    hist_add(&t->hist[LG_OP_LOGIN + s->rq], (uint64_t)dt);
+
+    if (is_open(cfg)) {
+        if (s->rq != RQ_LOGIN) {
+            lg_step_t *st = &t->steps[step_of(t, s->t_req)];
+            hist_add(&st->lat, (uint64_t)dt);
+            hist_add(&st->svc, (uint64_t)(now - s->t_sent));
+            if (now < t->end_ns) t->steps[step_of(t, now)].done++; // not the drain
+            t->busy--;
+        } else if (!s->ready) {
+            s->ready = 1;
+            t->ready++;
+        }
+        if (s->over) {
+            t->bst[s->beh].games++;
+            t->bst[s->beh].wins += (s->st.winner == 1);
+            return 2;
+        }
+        advance(cfg->pings, s);
+        idle_push(t, s); // the scheduler hands it the next due request
+        return 0;
+    }
+
+    const lg_behavior_t *b = beh_of(t, s);
+    if (s->rq == RQ_RESUME) t->bst[s->beh].resumes++;
+    if (s->over) {
+        t->bst[s->beh].games++;
+        t->bst[s->beh].wins += (s->st.winner == 1);
+        return 1;
+    }
+    if (plan_next(b, s, now)) return 1;
+    if (b->drop > 0 && s->sid && rand01(&t->rng) < b->drop) return 3;
+    if (b->abandon > 0 && rand01(&t->rng) < b->abandon) return 4;
+    if (b->stall > 0 && s->sid && rand01(&t->rng) < b->stall) return 5;
+    schedule_next(t, s);
+    return 0;
+}
+
+// Consumes whole packets from s->in. -1 bad stream, -2 resume refused,
+// 1 finished, 2 reconnect, 3 drop, 4 abandon, 5 stall, 0 continue.
+static int parse_input(lg_thread_t *t, lg_sess_t *s) {
+    uint16_t off = 0;
+    int rc = 0;
+    while (rc == 0) {
+        uint16_t op;
+        const uint8_t *p;
+        uint32_t plen;
+        int n = proto_decode(s->in + off, (size_t)(s->in_len - off), &op, &p, &plen);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        off = (uint16_t)(off + n);
+        if (!s->waiting) continue; // nothing asked for
+        if (!s->first_seen) {
+            s->first_seen = 1;
+            if (s->rq == RQ_END) hist_add(&t->hist[LG_OP_END_FIRST], (uint64_t)(now_ns() - s->t_req));
+        }
+
+        if (op == OP_RESUME_RESP && plen >= offsetof(resume_resp_t, caps)) {
+            resume_resp_t rr;
+            memset(&rr, 0, sizeof(rr));
+            memcpy(&rr, p, plen < sizeof(rr) ? plen : sizeof(rr));
+            if (rr.ok) s->sid = rr.session_id; // LOGIN announces it this way too
+            else if (s->rq == RQ_RESUME) return -2;
+        }
+        if (op == OP_ERROR) t->bst[s->beh].errors++;
+
+        if (op == OP_HAND && plen == sizeof(hand_t)) {
+            memcpy(&s->hand, p, sizeof(hand_t));
+            if (s->hand.n > 8) s->hand.n = 8;
+        }
+        if (op == OP_STATE) on_state(s, p, plen);
+        else if (op == s->end_op) rc = on_reply_done(t, s);
+    }
+    if (off > 0) {
+        memmove(s->in, s->in + off, (size_t)(s->in_len - off));
+        s->in_len = (uint16_t)(s->in_len - off);
+    }
+    if (rc == 0 && s->in_len == LG_IN_CAP) return -1; // packet larger than the buffer
+    return rc;
+}
+
+static int ssl_want(lg_thread_t *t, lg_sess_t *s, int r) {
+    int err = SSL_get_error(s->ssl, r);
+    if (err == SSL_ERROR_WANT_READ) { set_interest(t, s, EPOLLIN); return 1; }
+    if (err == SSL_ERROR_WANT_WRITE) { set_interest(t, s, EPOLLOUT); return 1; }
+    ERR_clear_error();
+    return 0;
+}
+
+// scenario drop: hang up without close_notify, then come back with OP_RESUME_REQ
+static void sess_drop(lg_thread_t *t, lg_sess_t *s) {
+    sess_release(s, 1);
+    s->resuming = 1;
+    s->stalled = 0;
+    s->t_drop = now_ns();
+    if (sess_connect(t, s) != 0) sess_fail(t, s, FAIL_CONNECT);
+}
+
+// an established open-loop session that breaks is reconnected, not failed;
+// a stalled one was expecting the server to hang up, and resumes
+static void io_error(lg_thread_t *t, lg_sess_t *s) {
+    if (s->stalled) {
+        t->bst[s->beh].timeouts++;
+        sess_drop(t, s);
+    } else if (is_open(t->cfg) && s->ready) {
+        sess_recycle(t, s);
+    } else {
+        sess_fail(t, s, FAIL_IO);
+    }
+}
+
+static void drive(lg_thread_t *t, lg_sess_t *s) {
+    s->last_io = now_ns();
+
+    if (s->ls == LS_CONNECT) {
+        int err = 0;
+        socklen_t el = sizeof(err);
+        if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &el) != 0 || err != 0) {
+            sess_fail(t, s, FAIL_CONNECT);
+            return;
+        }
+        s->ssl = SSL_new(t->ctx);
+        if (!s->ssl) { sess_fail(t, s, FAIL_TLS); return; }
+        SSL_set_fd(s->ssl, s->fd);
+        SSL_set_connect_state(s->ssl);
+        s->ls = LS_TLS;
+    }
+
+    if (s->ls == LS_TLS) {
+        int r = SSL_do_handshake(s->ssl);
+        if (r != 1) {
+            if (!ssl_want(t, s, r)) sess_fail(t, s, FAIL_TLS);
+            return;
+        }
+        s->ls = LS_RUN;
+        hist_add(&t->hist[LG_OP_HANDSHAKE], (uint64_t)(now_ns() - s->t_conn));
+        if (s->resuming) {
+            resume_req_t rr = { .session_id = s->sid, .caps = lg_caps(t->cfg) };
+            queue_req(s, OP_RESUME_REQ, &rr, sizeof(rr), RQ_RESUME);
+            s->t_req = s->t_drop; // time to recover, reconnect included
+        } else {
+            login_req_t lr = { .caps = lg_caps(t->cfg), .tier = (uint8_t)beh_of(t, s)->tier };
+            queue_req(s, OP_LOGIN_REQ, &lr, sizeof(lr), RQ_LOGIN);
+        }
+    }
+
+    for (;;) {
+        while (s->out_off < s->out_len) {
+            int w = SSL_write(s->ssl, s->out + s->out_off, s->out_len - s->out_off);
+            if (w <= 0) {
+                if (!ssl_want(t, s, w)) io_error(t, s);
+                return;
+            }
+            s->out_off = (uint16_t)(s->out_off + w);
+        }
+        s->out_off = s->out_len = 0;
+
+        int r = SSL_read(s->ssl, s->in + s->in_len, LG_IN_CAP - s->in_len);
+        if (r <= 0) {
+            if (!ssl_want(t, s, r)) io_error(t, s);
+            return;
+        }
+        s->in_len = (uint16_t)(s->in_len + r);
+
+        int pr = parse_input(t, s);
+        if (pr == -2) { sess_fail(t, s, FAIL_RESUME); return; }
+        if (pr < 0) { io_error(t, s); return; }
+        if (pr == 1) { sess_ok(t, s); return; }
+        if (pr == 2) { sess_recycle(t, s); return; }
+        if (pr == 3) { sess_drop(t, s); return; }
+        if (pr == 4) {
+            // gone for good: the slot stays taken on the server until the TTL
+            t->bst[s->beh].abandons++;
+            sess_release(s, 1);
+            sess_ok(t, s);
+            return;
+        }
+        if (pr == 5) {
+            // say nothing; the server's recv timeout should close the socket
+            const lg_behavior_t *b = beh_of(t, s);
+            t->bst[s->beh].stalls++;
+            s->stalled = 1;
+            set_interest(t, s, EPOLLIN);
+            timer_push(t, s, now_ns() + (long long)(b->stall_s * 1e9));
+            return;
+        }
+    }
+}
+
+/* ---------- open loop scheduler ---------- */
+
+// gap to this thread's next arrival at step k's rate
+static long long next_gap(lg_thread_t *t, int k) {
+    double mean_ns = 1e9 * t->cfg->threads / t->cfg->rates[k];
+    if (!t->cfg->poisson) return (long long)mean_ns;
+    return (long long)(-log(rand01(&t->rng)) * mean_ns);
+}
+
+static void close_all(lg_thread_t *t) {
+    for (int i = 0; i < t->next_start; i++) {
+        lg_sess_t *s = &t->sess[i];
+        if (s->ls == LS_DONE) continue;
+        if (s->ready) sess_ok(t, s);
+        else sess_fail(t, s, FAIL_TIMEOUT);
+    }
+    for (int i = t->next_start; i < t->nsess; i++) { t->sess[i].ls = LS_DONE; t->finished++; }
+}
+
+// Generates due arrivals and pairs them with idle sessions. Returns how long
+// the loop may sleep (ns) before the next arrival.
+static long long open_tick(lg_thread_t *t, long long now) {
+    const lg_config_t *cfg = t->cfg;
+
+    if (t->step < 0) {
+        // warm-up: the whole pool connects and logs in before the first step
+        if (t->next_start < t->nsess || t->ready + t->finished < t->nsess) return 100000000LL;
+        t->step = 0;
+        if (atomic_fetch_add(&g_threads_ready, 1) + 1 == cfg->threads)
+            atomic_store(&g_steps_t0, now + 10000000LL);
+    }
+
+    long long t0 = atomic_load(&g_steps_t0);
+    if (t0 == 0) return 1000000LL; // other threads still warming up
+    if (t->end_ns == 0) {
+        t->end_ns = t0 + (long long)(cfg->step_s * 1e9 * cfg->nrates);
+        // fixed arrivals: spread the threads over one interval
+        long long g = next_gap(t, 0);
+        t->next_send_ns = t0 + (cfg->poisson ? g : g * t->id / cfg->threads);
+    }
+
+    // arrivals due by now; their latency counts from the due time, not from
+    // when a session happens to be free (no coordinated omission)
+    while (t->step < cfg->nrates && t->next_send_ns <= now) {
+        if (t->next_send_ns >= t->end_ns) { t->step = cfg->nrates; break; }
+        int k = step_of(t, t->next_send_ns);
+        t->step = k;
+        t->steps[k].offered++;
+        backlog_push(t, t->next_send_ns, 0);
+        t->next_send_ns += next_gap(t, k);
+    }
+
+    lg_sess_t *s;
+    while (t->bl_len > 0 && (s = idle_pop(t)) != NULL) {
+        long long due = backlog_pop(t);
+        send_next(t, s);
+        s->t_req = due;
+        t->busy++;
+        drive(t, s);
+    }
+    if (t->step < cfg->nrates) {
+        lg_step_t *st = &t->steps[t->step];
+        if ((long long)t->bl_len > st->backlog_max) st->backlog_max = (long long)t->bl_len;
+        return t->next_send_ns - now;
+    }
+
+    // generation over: drain what was offered, then hang up
+    if ((t->bl_len == 0 && t->busy == 0) || now > t->end_ns + (long long)cfg->timeout_s * 1000000000LL) {
+        t->unfinished += (long long)t->bl_len + t->busy;
+        t->bl_len = 0;
+        close_all(t);
+    }
+    return 10000000LL;
+}
+
+/* ---------- event loop ---------- */
+
+static void expire_idle(lg_thread_t *t, long long now) {
+    long long limit = (long long)t->cfg->timeout_s * 1000000000LL;
+    for (int i = 0; i < t->next_start; i++) {
+        lg_sess_t *s = &t->sess[i];
+        int stalled = (s->ls == LS_CONNECT || s->ls == LS_TLS || (s->ls == LS_RUN && s->waiting));
+        if (!stalled || now - s->last_io <= limit) continue;
+        if (is_open(t->cfg) && s->ready) sess_recycle(t, s);
+        else sess_fail(t, s, FAIL_TIMEOUT);
+    }
+}
+
+static void* lg_thread(void *p) {
+    lg_thread_t *t = p;
+    struct epoll_event evs[256];
+    long long next_scan = now_ns() + 1000000000LL;
+
+    while (t->finished < t->nsess) {
+        long long now = now_ns();
+
+        // ramp: start whatever is due (bounded so I/O keeps being served)
+        int burst = 0;
+        while (t->next_start < t->nsess && now >= t->next_start_ns && burst < 256) {
+            start_session(t, &t->sess[t->next_start++]);
+            t->next_start_ns += t->interval_ns;
+            t->last_start_ns = now;
+            burst++;
+        }
+
+        // think timers that ran out
+        while (t->ntimers > 0 && t->timers[0].due <= now) {
+            lg_timer_t tm = timer_pop(t);
+            lg_sess_t *s = &t->sess[tm.idx];
+            if (s->due != tm.due) continue; // re-armed or restarted meanwhile
+            if (s->ls == LS_IDLE) {
+                // soak: next player in this slot, unless time is up
+                if (now < t->soak_end) {
+                    t->restarts++;
+                    start_session(t, s);
+                } else {
+                    s->ls = LS_DONE;
+                    t->finished++;
+                }
+                continue;
+            }
+            if (s->ls != LS_RUN || s->waiting) continue; // died meanwhile
+            if (s->stalled) {
+                // the server never hung up: come back anyway
+                sess_drop(t, s);
+                continue;
+            }
+            fire(t, s);
+            drive(t, s);
+        }
+
+        long long sleep_ns = 100000000LL;
+        if (t->ntimers > 0 && t->timers[0].due - now < sleep_ns) sleep_ns = t->timers[0].due - now;
+        if (is_open(t->cfg)) {
+            long long d = open_tick(t, now);
+            if (d < sleep_ns) sleep_ns = d;
+            if (t->finished >= t->nsess) break;
+        }
+        if (t->next_start < t->nsess) {
+            long long d = t->next_start_ns - now_ns();
+            if (d < sleep_ns) sleep_ns = d;
+        }
+        // round down: a sub-ms wait polls rather than oversleeping an arrival
+        int wait_ms = (sleep_ns <= 0) ? 0 : (int)(sleep_ns / 1000000);
+        if (wait_ms > 100) wait_ms = 100;
+
+        int n = epoll_wait(t->epfd, evs, 256, wait_ms);
+        for (int i = 0; i < n; i++) {
+            lg_sess_t *s = evs[i].data.ptr;
+            if (s->ls == LS_DONE) continue;
+            drive(t, s);
+        }
+
+        now = now_ns();
+        if (now >= next_scan) {
+            expire_idle(t, now);
+            next_scan = now + 1000000000LL;
+        }
+    }
+    return NULL;
+}
+
+/* ---------- scenario ---------- */
+
+static int kind_of(const char *name) {
+    for (int k = 0; k < (int)(sizeof(g_kind_names) / sizeof(g_kind_names[0])); k++)
+        if (strcmp(name, g_kind_names[k]) == 0) return k;
+    return -1;
+}
+
+int loadgen_policy(const char *name) {
+    for (int k = 0; k < (int)(sizeof(g_policy_names) / sizeof(g_policy_names[0])); k++)
+        if (strcmp(name, g_policy_names[k]) == 0) return k;
+    return -1;
+}
+
+static int parse_think(const char *v, lg_behavior_t *b) {
+    if (strcmp(v, "none") == 0) { b->think = LG_THINK_NONE; return 0; }
+    if (sscanf(v, "fixed:%lf", &b->think_a) == 1) { b->think = LG_THINK_FIXED; return 0; }
+    if (sscanf(v, "uniform:%lf:%lf", &b->think_a, &b->think_b) == 2 && b->think_b >= b->think_a) {
+        b->think = LG_THINK_UNIFORM;
+        return 0;
+    }
+    if (sscanf(v, "exp:%lf", &b->think_a) == 1) { b->think = LG_THINK_EXP; return 0; }
+    return -1;
+}
+
+// One behavior line. 1 = blank, 0 = ok, -1 = error
+static int parse_behavior(char *line, const lg_config_t *cfg, lg_behavior_t *b) {
+    char *save = NULL;
+    char *tok = strtok_r(line, " \t\r", &save);
+    if (!tok) return 1;
+
+    memset(b, 0, sizeof(*b));
+    snprintf(b->name, sizeof(b->name), "%s", tok);
+    b->kind = kind_of(tok);
+    b->weight = 1;
+    b->rounds = -1;
+    b->pings = cfg->pings;
+    b->policy = cfg->policy;
+    b->depth = 1;
+    b->tier = cfg->tier;
+    b->idle_s = 30;
+    b->ping_ms = 2000; // client_gui's heartbeat
+    b->stall_s = 8;    // past the server's 5 s recv timeout
+
+    while ((tok = strtok_r(NULL, " \t\r", &save)) != NULL) {
+        char *v = strchr(tok, '=');
+        if (!v) goto bad;
+        *v++ = '\0';
+        if (strcmp(tok, "kind") == 0) b->kind = kind_of(v);
+        else if (strcmp(tok, "weight") == 0) b->weight = atof(v);
+        else if (strcmp(tok, "think") == 0) { if (parse_think(v, b) != 0) goto bad; }
+        else if (strcmp(tok, "bad") == 0) b->bad = atof(v);
+        else if (strcmp(tok, "drop") == 0) b->drop = atof(v);
+        else if (strcmp(tok, "abandon") == 0) b->abandon = atof(v);
+        else if (strcmp(tok, "stall") == 0) b->stall = atof(v);
+        else if (strcmp(tok, "stall_s") == 0) b->stall_s = atof(v);
+        else if (strcmp(tok, "rounds") == 0 || strcmp(tok, "turns") == 0) b->rounds = atoi(v);
+        else if (strcmp(tok, "pings") == 0) b->pings = atoi(v);
+        else if (strcmp(tok, "plays") == 0) b->plays = atoi(v);
+        else if (strcmp(tok, "policy") == 0) { if ((b->policy = loadgen_policy(v)) < 0) goto bad; }
+        else if (strcmp(tok, "depth") == 0) b->depth = atoi(v);
+        else if (strcmp(tok, "tier") == 0) { if ((b->tier = proto_ai_tier(v)) < 0) goto bad; }
+        else if (strcmp(tok, "idle") == 0) b->idle_s = atof(v);
+        else if (strcmp(tok, "ping") == 0) b->ping_ms = atof(v);
+        else goto bad;
+    }
+    if (b->kind < 0) {
+        fprintf(stderr, "[loadgen] scenario '%s': unknown kind\n", b->name);
+        return -1;
+    }
+    if (b->weight <= 0 || b->ping_ms <= 0 || b->depth <= 0 || b->stall_s <= 0) {
+        fprintf(stderr, "[loadgen] scenario '%s': weight, ping, depth and stall_s must be > 0\n", b->name);
+        return -1;
+    }
+    if (b->rounds < 0) b->rounds = (b->kind == LG_KIND_GAME) ? 0 : cfg->rounds;
+    return 0;
+bad:
+    fprintf(stderr, "[loadgen] scenario '%s': bad option '%s'\n", b->name, tok);
+    return -1;
+}
+
+int loadgen_parse_scenario(const char *spec, const lg_config_t *cfg, lg_scenario_t *out) {
+    char buf[8192];
+    FILE *f = fopen(spec, "r");
+    if (f) {
+        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+        buf[n] = '\0';
+        fclose(f);
+    } else {
+        snprintf(buf, sizeof(buf), "%s", spec);
+    }
+
+    memset(out, 0, sizeof(*out));
+    char *save = NULL;
+    for (char *line = strtok_r(buf, "\n;", &save); line; line = strtok_r(NULL, "\n;", &save)) {
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        if (out->n == LG_MAX_BEHAVIORS) {
+            fprintf(stderr, "[loadgen] scenario: at most %d behaviors\n", LG_MAX_BEHAVIORS);
+            return -1;
+        }
+        int rc = parse_behavior(line, cfg, &out->b[out->n]);
+        if (rc < 0) return -1;
+        if (rc == 0) out->n++;
+    }
+    if (out->n == 0) {
+        fprintf(stderr, "[loadgen] scenario: no behaviors in '%s'\n", spec);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------- setup ---------- */
+
+static int resolve(const char *host, uint16_t port) {
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family = AF_UNSPEC;
+    char portstr[16];
+    snprintf(portstr, sizeof(portstr), "%u", (unsigned)port);
+    if (getaddrinfo(host, portstr, &hints, &res) != 0 || !res) return -1;
+    memcpy(&g_addr, res->ai_addr, res->ai_addrlen);
+    g_addrlen = res->ai_addrlen;
+    freeaddrinfo(res);
+    return 0;
+}
+
+static int parse_bind(const char *list) {
+    g_nbind = 0;
+    if (!list) return 0;
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", list);
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok && g_nbind < LG_MAX_BIND;
+         tok = strtok_r(NULL, ",", &save)) {
+        struct sockaddr_storage *b = &g_bind[g_nbind];
+        memset(b, 0, sizeof(*b));
+        struct sockaddr_in *v4 = (struct sockaddr_in*)b;
+        struct sockaddr_in6 *v6 = (struct sockaddr_in6*)b;
+        if (inet_pton(AF_INET, tok, &v4->sin_addr) == 1) v4->sin_family = AF_INET;
+        else if (inet_pton(AF_INET6, tok, &v6->sin6_addr) == 1) v6->sin6_family = AF_INET6;
+        else { fprintf(stderr, "[loadgen] bad --bind address: %s\n", tok); return -1; }
+        g_nbind++;
+    }
+    return 0;
+}
+
+static void raise_nofile(int want) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) return;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    if (rl.rlim_cur != RLIM_INFINITY && (rlim_t)want > rl.rlim_cur)
+        fprintf(stderr, "[loadgen] warning: fd limit %llu < %d sessions, "
+                        "only a ramped subset can be open at once\n",
+                (unsigned long long)rl.rlim_cur, want);
+}
+
+/* ---------- report ---------- */
+
+typedef struct {
+    long long ok, nfail, fail[FAIL_KINDS];
+    long long lat_sum, lat_min, lat_max;
+    long long reconnects, unfinished, restarts;
+    long long games, wins;
+    double total_s, ramp_s;
+    int threads, peak;
+    int knee;              // open loop: first saturated step, -1 = none
+    int show_scenario;
+    hist_t hist[LG_OPS];
+    lg_beh_stats_t bst[LG_MAX_BEHAVIORS];
+    lg_step_t *steps;
+} lg_totals_t;
+
+static const double g_quantiles[] = { 0.50, 0.90, 0.99, 0.999 };
+#define NQ (int)(sizeof(g_quantiles) / sizeof(g_quantiles[0]))
+
+static double ms(uint64_t ns) { return (double)ns / 1e6; }
+
+static double achieved(const lg_config_t *cfg, const lg_step_t *st) {
+    return (double)st->done / cfg->step_s;
+}
+
+// Saturated: completions fall short of the offered rate, or p99 blows up
+// compared with the lightest step.
+static int find_knee(const lg_config_t *cfg, const lg_totals_t *r) {
+    uint64_t base_p99 = hist_quantile(&r->steps[0].lat, 0.99);
+    for (int k = 0; k < cfg->nrates; k++) {
+        const lg_step_t *st = &r->steps[k];
+        if (achieved(cfg, st) < 0.95 * cfg->rates[k]) return k;
+        if (k > 0 && hist_quantile(&st->lat, 0.99) > 10 * base_p99 + 1000000) return k;
+    }
+    return -1;
+}
+
+static void print_summary(const lg_config_t *cfg, const lg_totals_t *r) {
+    printf("players=%d rounds=%d threads=%d ok=%lld fail=%lld",
+           cfg->sessions, cfg->rounds, r->threads, r->ok, r->nfail);
+    if (r->nfail) {
+        printf(" (");
+        for (int k = 0, first = 1; k < FAIL_KINDS; k++) {
+            if (!r->fail[k]) continue;
+            printf("%s%s=%lld", first ? "" : " ", g_fail_names[k], r->fail[k]);
+            first = 0;
+        }
+        printf(")");
+    }
+    printf("\n");
+    printf("ramp=%.1fs (%.0f conn/s) peak_concurrent=%d total=%.2fs\n",
+           r->ramp_s, r->ramp_s > 0 ? (double)cfg->sessions / r->ramp_s : 0.0, r->peak, r->total_s);
+    if (cfg->soak_s > 0)
+        printf("soak=%.0fs players_started=%lld (%lld slot restarts)\n",
+               cfg->soak_s, (long long)cfg->sessions + r->restarts, r->restarts);
+    if (r->games > 0)
+        printf("games=%lld (%.1f games/s) player_won=%.1f%%\n", r->games,
+               (double)r->games / r->total_s, 100.0 * (double)r->wins / (double)r->games);
+    if (r->ok > 0 && !is_open(cfg)) {
+        printf("latency(sum per player) avg=%.3f ms min=%.3f ms max=%.3f ms\n",
+               (double)r->lat_sum / (double)r->ok / 1e6, (double)r->lat_min / 1e6, (double)r->lat_max / 1e6);
+    }
+
+    printf("%-10s %9s %9s %9s %9s %9s %9s %9s %9s\n",
+           "op", "count", "ops/s", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int k = 0; k < LG_OPS; k++) {
+        const hist_t *h = &r->hist[k];
+        if (!h->count) continue;
+        printf("%-10s %9llu %9.0f %9.3f", g_op_names[k], (unsigned long long)h->count,
+               (double)h->count / r->total_s, hist_mean(h) / 1e6);
+        for (int q = 0; q < NQ; q++) printf(" %9.3f", ms(hist_quantile(h, g_quantiles[q])));
+        printf(" %9.3f\n", ms(h->max));
+    }
+    printf("(latencies in ms)\n");
+
+    if (r->show_scenario) {
+        const lg_scenario_t *sc = cfg->scenario;
+        double total = 0;
+        for (int k = 0; k < sc->n; k++) total += sc->b[k].weight;
+        printf("\n%-14s %-6s %-6s %6s %8s %8s %6s %8s %6s %8s %8s %8s %7s %7s\n", "scenario", "kind", "policy",
+               "weight", "players", "ok", "fail", "games", "won", "errors", "resumes", "abandon", "stalls", "srv_to");
+        for (int k = 0; k < sc->n; k++) {
+            const lg_beh_stats_t *b = &r->bst[k];
+            printf("%-14s %-6s %-6s %5.0f%% %8lld %8lld %6lld %8lld %6lld %8lld %8lld %8lld %7lld %7lld\n",
+                   sc->b[k].name, g_kind_names[sc->b[k].kind], g_policy_names[sc->b[k].policy],
+                   100.0 * sc->b[k].weight / total,
+                   b->players, b->ok, b->fail, b->games, b->wins, b->errors, b->resumes,
+                   b->abandons, b->stalls, b->timeouts);
+        }
+    }
+
+    if (!is_open(cfg)) return;
+
+    printf("\nopen loop: %s arrivals, %.1fs per step, reconnects=%lld unfinished=%lld\n",
+           cfg->poisson ? "poisson" : "fixed", cfg->step_s, r->reconnects, r->unfinished);
+    printf("%9s %9s %9s %9s %9s %9s %9s %9s %9s\n",
+           "offered", "achieved", "mean", "p50", "p99", "p99.9", "max", "svc_p99", "backlog");
+    for (int k = 0; k < cfg->nrates; k++) {
+        const lg_step_t *st = &r->steps[k];
+        printf("%9.0f %9.0f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9lld%s\n",
+               cfg->rates[k], achieved(cfg, st), hist_mean(&st->lat) / 1e6,
+               ms(hist_quantile(&st->lat, 0.50)), ms(hist_quantile(&st->lat, 0.99)),
+               ms(hist_quantile(&st->lat, 0.999)), ms(st->lat.max),
+               ms(hist_quantile(&st->svc, 0.99)), st->backlog_max,
+               k == r->knee ? "  <- knee" : "");
+    }
+    if (r->knee > 0)
+        printf("saturation between %.0f and %.0f req/s\n", cfg->rates[r->knee - 1], cfg->rates[r->knee]);
+    else if (r->knee == 0)
+        printf("saturated at the lowest rate (%.0f req/s)\n", cfg->rates[0]);
+    else
+        printf("no saturation up to %.0f req/s\n", cfg->rates[cfg->nrates - 1]);
+    printf("(latency from intended send time; svc = from actual send)\n");
+}
+
+static void json_hist(FILE *f, const hist_t *h) {
+    fprintf(f, "\"count\":%llu,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p90_ms\":%.4f,"
+               "\"p99_ms\":%.4f,\"p999_ms\":%.4f,\"max_ms\":%.4f",
+            (unsigned long long)h->count, hist_mean(h) / 1e6,
+            ms(hist_quantile(h, 0.50)), ms(hist_quantile(h, 0.90)),
+            ms(hist_quantile(h, 0.99)), ms(hist_quantile(h, 0.999)), ms(h->max));
+}
+
+static void csv_hist(FILE *f, const hist_t *h) {
+    fprintf(f, "%.4f,%.4f,%.4f,%.4f,%.4f,%.4f", hist_mean(h) / 1e6,
+            ms(hist_quantile(h, 0.50)), ms(hist_quantile(h, 0.90)),
+            ms(hist_quantile(h, 0.99)), ms(hist_quantile(h, 0.999)), ms(h->max));
+}
+
+// JSON (one object) or CSV (header + one row per op, per rate step in open
+// loop); "-" = stdout
+static void write_report(const lg_config_t *cfg, const lg_totals_t *r, const char *path, int json) {
+    FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) { perror(path); return; }
+    const char *label = cfg->label ? cfg->label : "";
+
+    if (json) {
+        fprintf(f, "{\"label\":\"%s\",\"players\":%d,\"rounds\":%d,\"pings\":%d,\"threads\":%d,"
+                   "\"ramp\":%.1f,\"ok\":%lld,\"fail\":%lld,\"fail_by\":{",
+                label, cfg->sessions, cfg->rounds, cfg->pings, r->threads, cfg->ramp, r->ok, r->nfail);
+        for (int k = 0; k < FAIL_KINDS; k++)
+            fprintf(f, "%s\"%s\":%lld", k ? "," : "", g_fail_names[k], r->fail[k]);
+        fprintf(f, "},\"duration_s\":%.3f,\"ramp_s\":%.3f,\"peak_concurrent\":%d,"
+                   "\"games\":%lld,\"games_per_s\":%.2f,\"player_wins\":%lld,\"soak_s\":%.0f,"
+                   "\"restarts\":%lld,\"ops\":{",
+                r->total_s, r->ramp_s, r->peak, r->games, (double)r->games / r->total_s, r->wins,
+                cfg->soak_s, r->restarts);
+        for (int k = 0; k < LG_OPS; k++) {
+            const hist_t *h = &r->hist[k];
+            fprintf(f, "%s\"%s\":{\"ops_per_s\":%.1f,", k ? "," : "", g_op_names[k],
+                    (double)h->count / r->total_s);
+            json_hist(f, h);
+            fprintf(f, "}");
+        }
+        fprintf(f, "}");
+        if (r->show_scenario) {
+            const lg_scenario_t *sc = cfg->scenario;
+            fprintf(f, ",\"scenarios\":[");
+            for (int k = 0; k < sc->n; k++) {
+                const lg_beh_stats_t *b = &r->bst[k];
+                fprintf(f, "%s{\"name\":\"%s\",\"kind\":\"%s\",\"policy\":\"%s\",\"weight\":%.3f,"
+                           "\"players\":%lld,\"ok\":%lld,\"fail\":%lld,\"games\":%lld,\"wins\":%lld,"
+                           "\"errors\":%lld,\"resumes\":%lld,\"abandons\":%lld,\"stalls\":%lld,"
+                           "\"server_timeouts\":%lld}",
+                        k ? "," : "", sc->b[k].name, g_kind_names[sc->b[k].kind],
+                        g_policy_names[sc->b[k].policy], sc->b[k].weight,
+                        b->players, b->ok, b->fail, b->games, b->wins, b->errors, b->resumes,
+                        b->abandons, b->stalls, b->timeouts);
+            }
+            fprintf(f, "]");
+        }
+        if (is_open(cfg)) {
+            fprintf(f, ",\"open_loop\":{\"arrival\":\"%s\",\"step_s\":%.3f,\"reconnects\":%lld,"
+                       "\"unfinished\":%lld,\"knee_rps\":%.1f,\"steps\":[",
+                    cfg->poisson ? "poisson" : "fixed", cfg->step_s, r->reconnects, r->unfinished,
+                    r->knee >= 0 ? cfg->rates[r->knee] : 0.0);
+            for (int k = 0; k < cfg->nrates; k++) {
+                const lg_step_t *st = &r->steps[k];
+                fprintf(f, "%s{\"offered_rps\":%.1f,\"achieved_rps\":%.1f,\"backlog_max\":%lld,",
+                        k ? "," : "", cfg->rates[k], achieved(cfg, st), st->backlog_max);
+                json_hist(f, &st->lat);
+                fprintf(f, ",\"svc_p99_ms\":%.4f}", ms(hist_quantile(&st->svc, 0.99)));
+            }
+            fprintf(f, "]}");
+        }
+        fprintf(f, "}\n");
+    } else if (is_open(cfg)) {
+        fprintf(f, "label,offered_rps,achieved_rps,mean_ms,p50_ms,p90_ms,p99_ms,p999_ms,max_ms,svc_p99_ms,backlog_max\n");
+        for (int k = 0; k < cfg->nrates; k++) {
+            const lg_step_t *st = &r->steps[k];
+            fprintf(f, "%s,%.1f,%.1f,", label, cfg->rates[k], achieved(cfg, st));
+            csv_hist(f, &st->lat);
+            fprintf(f, ",%.4f,%lld\n", ms(hist_quantile(&st->svc, 0.99)), st->backlog_max);
+        }
+    } else {
+        fprintf(f, "label,op,count,ops_per_s,mean_ms,p50_ms,p90_ms,p99_ms,p999_ms,max_ms\n");
+        for (int k = 0; k < LG_OPS; k++) {
+            const hist_t *h = &r->hist[k];
+            fprintf(f, "%s,%s,%llu,%.1f,", label, g_op_names[k],
+                    (unsigned long long)h->count, (double)h->count / r->total_s);
+            csv_hist(f, h);
+            fprintf(f, "\n");
+        }
+    }
+    if (f != stdout) fclose(f);
+}
+
+static void step_init(lg_step_t *st, int n) {
+    for (int k = 0; k < n; k++) {
+        memset(&st[k], 0, sizeof(st[k]));
+        hist_init(&st[k].lat);
+        hist_init(&st[k].svc);
+    }
+}
+
+int loadgen_run(const lg_config_t *cfg_in, SSL_CTX *ctx) {
+    lg_config_t cfgv = *cfg_in;
+    lg_config_t *cfg = &cfgv;
+    if (cfg->threads <= 0) cfg->threads = 1;
+    if (cfg->threads > cfg->sessions) cfg->threads = cfg->sessions > 0 ? cfg->sessions : 1;
+    if (is_open(cfg) && cfg->step_s <= 0) cfg->step_s = 10;
+    int nthreads = cfg->threads;
+
+    if (is_open(cfg) && (cfg->scenario || cfg->soak_s > 0)) {
+        fprintf(stderr, "[loadgen] scenarios and soak run closed-loop; drop --rate/--sweep\n");
+        return 2;
+    }
+    // no scenario: everyone runs the classic rounds
+    lg_scenario_t classic = { .n = 1 };
+    if (!cfg->scenario) {
+        lg_behavior_t *b = &classic.b[0];
+        snprintf(b->name, sizeof(b->name), "rounds");
+        b->kind = LG_KIND_ROUNDS;
+        b->weight = 1;
+        b->rounds = cfg->rounds;
+        b->pings = cfg->pings;
+        b->policy = cfg->policy;
+        b->depth = 1;
+        b->tier = cfg->tier;
+        cfg->scenario = &classic;
+    }
+
+    if (resolve(cfg->host, cfg->port) != 0) {
+        fprintf(stderr, "[loadgen] cannot resolve %s\n", cfg->host);
+        return 1;
+    }
+    if (parse_bind(cfg->bind_ips) != 0) return 1;
+    raise_nofile(cfg->sessions + 64);
+
+    // idle sessions would otherwise keep 2 x 16KB TLS buffers each
+    SSL_CTX_set_mode(ctx, SSL_MODE_RELEASE_BUFFERS);
+
+    lg_sess_t *sess = calloc((size_t)(cfg->sessions > 0 ? cfg->sessions : 1), sizeof(lg_sess_t));
+    lg_thread_t *th = calloc((size_t)nthreads, sizeof(lg_thread_t));
+    pthread_t *tids = calloc((size_t)nthreads, sizeof(pthread_t));
+    if (!sess || !th || !tids) { fprintf(stderr, "[loadgen] out of memory\n"); return 1; }
+
+    atomic_store(&g_active, 0);
+    atomic_store(&g_peak, 0);
+    atomic_store(&g_threads_ready, 0);
+    atomic_store(&g_steps_t0, 0);
+
+    long long t0 = now_ns();
+    long long per_thread_ns = (cfg->ramp > 0) ? (long long)(1e9 * nthreads / cfg->ramp) : 0;
+    for (int i = 0; i < nthreads; i++) {
+        lg_thread_t *t = &th[i];
+        int lo = (int)((long long)cfg->sessions * i / nthreads);
+        int hi = (int)((long long)cfg->sessions * (i + 1) / nthreads);
+        t->cfg = cfg;
+        t->ctx = ctx;
+        t->id = i;
+        t->epfd = epoll_create1(EPOLL_CLOEXEC);
+        t->sess = sess + lo;
+        t->nsess = hi - lo;
+        t->interval_ns = per_thread_ns;
+        t->next_start_ns = t0 + per_thread_ns * i / nthreads; // interleave the threads
+        t->lat_min = (1LL << 62);
+        for (int k = 0; k < LG_OPS; k++) hist_init(&t->hist[k]);
+        t->rng = (0x9E3779B9u * (uint32_t)(i + 1)) ^ (uint32_t)t0;
+        if (t->rng == 0) t->rng = 1;
+        t->timers_cap = t->nsess + 1;
+        t->timers = malloc((size_t)t->timers_cap * sizeof(lg_timer_t));
+        if (cfg->soak_s > 0) t->soak_end = t0 + (long long)(cfg->soak_s * 1e9);
+        if (is_open(cfg)) {
+            t->step = -1;
+            t->idle = calloc((size_t)(t->nsess > 0 ? t->nsess : 1), sizeof(int));
+            t->steps = malloc((size_t)cfg->nrates * sizeof(lg_step_t));
+            step_init(t->steps, cfg->nrates);
+        }
+        pthread_create(&tids[i], NULL, lg_thread, t);
+    }
+
+    lg_totals_t r;
+    memset(&r, 0, sizeof(r));
+    r.lat_min = (1LL << 62);
+    r.knee = -1;
+    r.show_scenario = (cfg_in->scenario != NULL);
+    for (int k = 0; k < LG_OPS; k++) hist_init(&r.hist[k]);
+    if (is_open(cfg)) {
+        r.steps = malloc((size_t)cfg->nrates * sizeof(lg_step_t));
+        step_init(r.steps, cfg->nrates);
+    }
+
+    long long last_start = t0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        lg_thread_t *t = &th[i];
+        close(t->epfd);
+        r.ok += t->ok;
+        for (int k = 0; k < FAIL_KINDS; k++) r.fail[k] += t->fail[k];
+        r.lat_sum += t->lat_sum;
+        if (t->lat_min < r.lat_min) r.lat_min = t->lat_min;
+        if (t->lat_max > r.lat_max) r.lat_max = t->lat_max;
+        if (t->last_start_ns > last_start) last_start = t->last_start_ns;
+        for (int k = 0; k < LG_OPS; k++) hist_merge(&r.hist[k], &t->hist[k]);
+        for (int k = 0; k < cfg->scenario->n; k++) {
+            lg_beh_stats_t *d = &r.bst[k];
+            const lg_beh_stats_t *b = &t->bst[k];
+            d->players += b->players; d->ok += b->ok; d->fail += b->fail;
+            d->games += b->games; d->wins += b->wins;
+            d->errors += b->errors; d->resumes += b->resumes;
+            d->abandons += b->abandons; d->stalls += b->stalls; d->timeouts += b->timeouts;
+            r.games += b->games;
+            r.wins += b->wins;
+        }
+        r.reconnects += t->reconnects;
+        r.restarts += t->restarts;
+        r.unfinished += t->unfinished;
+        for (int k = 0; r.steps && k < cfg->nrates; k++) {
+            lg_step_t *d = &r.steps[k];
+            const lg_step_t *s = &t->steps[k];
+            hist_merge(&d->lat, &s->lat);
+            hist_merge(&d->svc, &s->svc);
+            d->offered += s->offered;
+            d->done += s->done;
+            d->backlog_max += s->backlog_max; // sum of per-thread peaks
+        }
+        free(t->timers);
+        free(t->idle);
+        free(t->steps);
+        free(t->backlog);
+    }
+    r.total_s = (double)(now_ns() - t0) / 1e9;
+    r.ramp_s = (double)(last_start - t0) / 1e9;
+    r.threads = nthreads;
+    r.peak = atomic_load(&g_peak);
+    for (int k = 0; k < FAIL_KINDS; k++) r.nfail += r.fail[k];
+    if (is_open(cfg)) r.knee = find_knee(cfg, &r);
+
+    print_summary(cfg, &r);
+    if (cfg->json_path) write_report(cfg, &r, cfg->json_path, 1);
+    if (cfg->csv_path) write_report(cfg, &r, cfg->csv_path, 0);
+
+    free(r.steps);
+    free(tids);
+    free(th);
+    free(sess);
+    return r.nfail ? 1 : 0;
+}
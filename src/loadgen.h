@@ -0,0 +1,118 @@
+#pragma once
+#include <stdint.h>
+#include <openssl/ssl.h>
+
+/*
+ * Event-driven load generator (client bench mode).
+ * A few threads, each with its own epoll loop, drive many non-blocking TLS
+ * sessions. Every session is a small state machine:
+ *   connect -> TLS handshake -> LOGIN -> rounds x ([PING..], PLAY_CARD, END_TURN) -> close
+ * New connections are started at a fixed aggregate rate (ramp). Each
+ * operation type is timed into its own histogram (p50..p99.9, max).
+ *
+ * Open loop (rates set): the sessions become a connection pool. Requests
+ * arrive at a target aggregate rate (fixed interval or Poisson), independent
+ * of how fast replies come back, and are handed to idle sessions in FIFO
+ * order. Latency runs from the intended send time, so time spent queued
+ * behind a slow server is counted (no coordinated omission). Each rate is a
+ * step of step_s seconds; the report shows where throughput stops keeping up.
+ *
+ * Scenario (closed loop): each player is assigned one behavior of a
+ * weighted mix. A behavior is a kind (rounds / game / idle) plus modifiers:
+ * think time before each request, invalid moves, abrupt disconnects that
+ * are followed by OP_RESUME_REQ, players who vanish for good, and players
+ * who go silent until the server times them out (then resume).
+ *
+ * Soak (closed loop, soak_s set): a slot whose player is done gets a new
+ * player right away, until soak_s has passed.
+ */
+
+typedef enum {
+    LG_KIND_ROUNDS = 0,    // rounds x ([PING..] PLAY_CARD END_TURN), the classic bench
+    LG_KIND_GAME,          // play until the game is over
+    LG_KIND_IDLE,          // login, then PING at GUI cadence for a while
+} lg_kind_t;
+
+typedef enum { LG_THINK_NONE = 0, LG_THINK_FIXED, LG_THINK_UNIFORM, LG_THINK_EXP } lg_think_t;
+
+// How a bot picks its card. The AI policies run on the mirrored state, so a
+// bot plays with the server AI's own evaluation (ai_eval_card / search).
+typedef enum {
+    LG_POLICY_GREEDY = 0,  // ai_pick_greedy
+    LG_POLICY_SEARCH,      // ai_pick_search, `depth` turns, no TT
+    LG_POLICY_RANDOM,      // any affordable card
+    LG_POLICY_FIRST,       // hand idx 0 whatever it costs (the old bench)
+} lg_policy_t;
+
+typedef struct {
+    char name[24];
+    int kind;              // lg_kind_t
+    double weight;
+    int think;             // lg_think_t, delay before every request after login
+    double think_a, think_b; // ms: fixed a, uniform [a, b], exp mean a
+    double bad;            // probability a PLAY_CARD is replaced by an invalid request
+    double drop;           // probability of disconnect + resume after a reply
+    double abandon;        // probability of disconnecting for good after a reply
+    double stall;          // probability of going silent after a reply, then resuming
+    double stall_s;        // how long (longer than the server's recv timeout)
+    int rounds;            // rounds: rounds; game: turn cap (0 = until over)
+    int pings;             // rounds: pings per round
+    int plays;             // game: cards played per turn at most (0 = while the policy finds one; first: 1)
+    int policy;            // lg_policy_t
+    int depth;             // search policy depth
+    int tier;              // ai_tier_t asked for at login: the server AI's difficulty
+    double idle_s;         // idle: how long to stay connected
+    double ping_ms;        // idle: ping interval
+} lg_behavior_t;
+
+#define LG_MAX_BEHAVIORS 16
+
+typedef struct {
+    lg_behavior_t b[LG_MAX_BEHAVIORS];
+    int n;
+} lg_scenario_t;
+
+typedef struct {
+    const char *host;
+    uint16_t port;
+    int sessions;          // simulated players
+    int rounds;            // PLAY_CARD + END_TURN per player
+    int threads;           // event loops
+    double ramp;           // new connections per second, all threads (0 = no limit)
+    int timeout_s;         // a session with no progress for this long fails
+    const char *bind_ips;  // comma-separated local addresses, more ephemeral ports (NULL = any)
+    int verbose;           // print session 0's states
+    int pings;             // OP_PING round trips at the start of each round
+    const char *json_path; // report files ("-" = stdout), NULL = none
+    const char *csv_path;
+    const char *label;     // tags the JSON/CSV rows (e.g. server build)
+
+    // open loop (nrates = 0: closed loop, every session runs rounds back to back)
+    const double *rates;   // requests/s, all threads; one step per entry
+    int nrates;
+    int poisson;           // exponential gaps instead of fixed intervals
+    double step_s;         // seconds per rate step
+
+    const lg_scenario_t *scenario; // NULL = every player runs `rounds`
+    int policy;            // lg_policy_t of the default `rounds` behavior
+    double soak_s;         // closed loop: keep replacing finished players this long (0 = once)
+    int no_ai_stream;      // log in without CAP_AI_STREAM: END_TURN answered in one piece
+    int tier;              // ai_tier_t of the default behavior (--tier)
+} lg_config_t;
+
+// Runs the whole load to completion, prints the summary and writes the reports. 0 if every session succeeded.
+int loadgen_run(const lg_config_t *cfg, SSL_CTX *ctx);
+
+// Parses a scenario from a file, or inline if spec is not a readable file.
+// One behavior per line (or ';'-separated):
+//   <name> [kind=rounds|game|idle] [weight=W] [think=fixed:MS|uniform:LO:HI|exp:MEAN]
+//          [bad=P] [drop=P] [abandon=P] [stall=P] [stall_s=S]
+//          [rounds=N] [pings=N] [plays=N] [idle=S] [ping=MS]
+//          [policy=greedy|search|random|first] [depth=N]
+//          [tier=default|easy|normal|hard]
+// kind defaults to the name when it is one of the kinds. rounds, pings,
+// policy and tier default to cfg's values. Returns 0, or -1 with a message on stderr.
+int loadgen_parse_scenario(const char *spec, const lg_config_t *cfg, lg_scenario_t *out);
+
+// lg_policy_t by name, -1 if unknown
+int loadgen_policy(const char *name);
@@ -0,0 +1,864 @@
+#define _DEFAULT_SOURCE
+#include "common/proto.h"
+#include "common/net.h"
+#include "common/ipc.h"
+#include "common/cards.h"
+#include "common/engine.h"
+#include "common/ai.h"
+#include "common/evlog.h"
+#include "common/chan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*
+ * microbench: ns/op of the hot primitives in isolation.
+ *
+ *   ./microbench [--filter STR] [--reps N] [--sample-ms MS]
+ *                [--json FILE] [--baseline FILE] [--threshold PCT] [--label STR]
+ *                [--tls-ciphers LIST] [--tls-groups LIST]
+ *
+ * Every benchmark is calibrated so one sample runs for about sample-ms, gets
+ * one untimed warmup sample, then `reps` timed samples. The report shows the
+ * median ns/op (the headline), min, and the coefficient of variation; a high
+ * cv means the machine was noisy and the row should not be trusted.
+ *
+ * With --baseline (a --json file of an earlier run), each row is compared by
+ * name and the exit status is 1 if any median got slower by more than
+ * threshold percent.
+ *
+ * TLS handshakes (full and resumed with a TLS 1.3 ticket) run once per
+ * certificate found in the working directory: server.crt and the
+ * server-<type>.crt files of `./gen_certs.sh all`. Both ends run in this
+ * thread; the time spent in the server's SSL calls is reported on its own
+ * (server_ns_op), which is what bounds handshakes/s per server core.
+ */
+
+#define MAX_BENCH   64
+#define MAX_REPS    101
+#define NAME_LEN    64
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return *s = x;
+}
+
+// results land here so the compiler cannot drop the loops
+static volatile uint64_t g_sink;
+
+typedef void (*bench_fn)(void *ctx, long iters);
+
+typedef struct {
+    char name[NAME_LEN];
+    double median, min, mean, cv;
+    long iters;          // per sample
+    double aux;          // median of g_aux over the samples, -1 = not set
+} result_t;
+
+static result_t g_res[MAX_BENCH];
+static int g_nres;
+
+static const char *g_filter;
+static int g_reps = 11;
+static double g_sample_ms = 20;
+static const char *g_tls_ciphers, *g_tls_groups;
+
+// a benchmark may set this to a second per-op figure of the last sample
+static double g_aux;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void run_bench(const char *name, bench_fn fn, void *ctx) {
+    if (g_filter && !strstr(name, g_filter)) return;
+    if (g_nres >= MAX_BENCH) return;
+
+    // calibrate: double the count until one sample takes a tenth of the
+    // target, then size it from the fastest of three such runs (a single
+    // preempted run would otherwise shrink every sample)
+    long iters = 1;
+    double ms = 0;
+    for (;;) {
+        long long t0 = now_ns();
+        fn(ctx, iters);
+        ms = (double)(now_ns() - t0) / 1e6;
+        if (ms >= g_sample_ms / 10 || iters >= (1L << 30)) break;
+        iters *= 2;
+    }
+    for (int k = 0; k < 2; k++) {
+        long long t0 = now_ns();
+        fn(ctx, iters);
+        double m = (double)(now_ns() - t0) / 1e6;
+        if (m < ms) ms = m;
+    }
+    double per = ms / (double)iters;
+    if (per > 0) iters = (long)(g_sample_ms / per);
+    if (iters < 1) iters = 1;
+
+    fn(ctx, iters); // warmup: caches, branch predictors, page faults
+
+    double ns[MAX_REPS], aux[MAX_REPS];
+    for (int r = 0; r < g_reps; r++) {
+        g_aux = -1;
+        long long t0 = now_ns();
+        fn(ctx, iters);
+        ns[r] = (double)(now_ns() - t0) / (double)iters;
+        aux[r] = g_aux;
+    }
+
+    double sum = 0, sq = 0;
+    for (int r = 0; r < g_reps; r++) sum += ns[r];
+    double mean = sum / g_reps;
+    for (int r = 0; r < g_reps; r++) sq += (ns[r] - mean) * (ns[r] - mean);
+    double sd = g_reps > 1 ? sqrt(sq / (g_reps - 1)) : 0;
+    qsort(ns, (size_t)g_reps, sizeof(double), cmp_double);
+    qsort(aux, (size_t)g_reps, sizeof(double), cmp_double);
+
+    result_t *res = &g_res[g_nres++];
+    snprintf(res->name, sizeof(res->name), "%s", name);
+    res->median = ns[g_reps / 2];
+    res->min = ns[0];
+    res->mean = mean;
+    res->cv = mean > 0 ? 100.0 * sd / mean : 0;
+    res->iters = iters;
+    res->aux = aux[g_reps / 2];
+    printf("%-40s %12.1f %12.1f %7.1f%% %12ld\n", res->name, res->median, res->min, res->cv, iters);
+    fflush(stdout);
+}
+
+/* ---------- proto ---------- */
+
+typedef struct {
+    uint8_t *buf;
+    size_t n;
+} cksum_ctx_t;
+
+static void b_checksum(void *ctx, long iters) {
+    cksum_ctx_t *c = ctx;
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++) {
+        c->buf[0] = (uint8_t)i; // a fresh input every time
+        acc += proto_checksum16(c->buf, c->n);
+    }
+    g_sink += acc;
+}
+
+typedef struct {
+    connection_t tx, rx;
+    uint16_t op;
+    const void *payload;
+    uint32_t len;
+    uint8_t in[4096];
+} rt_ctx_t;
+
+// send on one end, receive on the other: one packet is in flight, so a
+// single thread never blocks on the socket buffer
+static void b_roundtrip(void *ctx, long iters) {
+    rt_ctx_t *c = ctx;
+    uint16_t op;
+    uint32_t len;
+    for (long i = 0; i < iters; i++) {
+        if (proto_send(&c->tx, c->op, c->payload, c->len) != 0 ||
+            proto_recv(&c->rx, &op, c->in, sizeof(c->in), &len) != 0) {
+            fprintf(stderr, "round trip failed\n");
+            exit(1);
+        }
+        g_sink += len;
+    }
+}
+
+static void* accept_thread(void *arg) {
+    SSL *ssl = arg;
+    return (void*)(intptr_t)(SSL_accept(ssl) == 1 ? 0 : -1);
+}
+
+// both ends of a socketpair, TLS if ctx pair given
+static int rt_open(rt_ctx_t *c, SSL_CTX *sctx, SSL_CTX *cctx) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return -1;
+    if (!sctx) {
+        conn_init(&c->tx, sv[0], NULL);
+        conn_init(&c->rx, sv[1], NULL);
+        return 0;
+    }
+
+    SSL *srv = SSL_new(sctx), *cli = SSL_new(cctx);
+    SSL_set_fd(srv, sv[1]);
+    SSL_set_fd(cli, sv[0]);
+    pthread_t th;
+    pthread_create(&th, NULL, accept_thread, srv);
+    int ok = SSL_connect(cli) == 1;
+    void *rv;
+    pthread_join(th, &rv);
+    if (!ok || rv) {
+        ERR_print_errors_fp(stderr);
+        SSL_free(srv); SSL_free(cli);
+        close(sv[0]); close(sv[1]);
+        return -1;
+    }
+    conn_init(&c->tx, sv[0], cli);
+    conn_init(&c->rx, sv[1], srv);
+    return 0;
+}
+
+static void rt_close(rt_ctx_t *c) {
+    conn_close(&c->tx);
+    conn_close(&c->rx);
+}
+
+typedef struct {
+    uint16_t ver, op;
+    const void *payload;
+    uint32_t len;
+} codec_ctx_t;
+
+// encode one packet and decode it again, no I/O
+static void b_codec(void *ctx, long iters) {
+    codec_ctx_t *c = ctx;
+    uint8_t buf[512];
+    proto_frame_t f;
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++) {
+        int n = proto_encode_ver(c->ver, buf, sizeof(buf), c->op, (uint32_t)i, PKT_F_LAST, c->payload, c->len);
+        acc += (uint64_t)proto_decode_ver(c->ver, buf, (size_t)n, &f) + f.plen;
+    }
+    g_sink += acc;
+}
+
+static void bench_codec(void) {
+    // a mid-game state: full event ring, some shield and poison
+    state_t st;
+    evlog_t log;
+    memset(&st, 0, sizeof(st));
+    memset(&log, 0, sizeof(log));
+    st.p_hp = 22; st.ai_hp = 17; st.phase = PHASE_MAIN; st.mana = 2; st.max_mana = 3;
+    st.p_shield = 4; st.ai_poison = 2;
+    for (int i = 0; i < LOG_LINES; i++)
+        evlog_push(&log, EV_PLAY, (uint8_t)(i & 1), (uint16_t)(101 + i), (int16_t)(3 + i), st.mana);
+    state_wire_t w;
+    state_pack(&st, &log, &w);
+    hand_t hand = { .n = 3, .card_ids = { 101, 104, 107 } };
+    error_t err = { .code = -2, .msg = "not enough mana" };
+    play_ack_t ack = { .seq = 1234, .rc = 0 };
+
+    struct { const char *tag; uint16_t op; const void *p; uint32_t len; } shapes[] = {
+        { "state", OP_STATE, &w, sizeof(w) },
+        { "hand", OP_HAND, &hand, sizeof(hand) },
+        { "error", OP_ERROR, &err, sizeof(err) },
+        { "play_ack", OP_PLAY_ACK, &ack, sizeof(ack) },
+    };
+    for (uint16_t ver = PROTO_V2; ver <= PROTO_V3; ver++) {
+        for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+            char name[NAME_LEN];
+            snprintf(name, sizeof(name), "proto/codec/v%u/%s", ver, shapes[i].tag);
+            if (g_filter && !strstr(name, g_filter)) continue;
+            codec_ctx_t c = { ver, shapes[i].op, shapes[i].p, shapes[i].len };
+            uint8_t buf[512];
+            int n = proto_encode_ver(ver, buf, sizeof(buf), c.op, 1234, PKT_F_LAST, c.payload, c.len);
+            printf("  (%s: %d bytes on the wire)\n", name, n);
+            run_bench(name, b_codec, &c);
+        }
+    }
+}
+
+static void bench_proto(void) {
+    static const size_t sizes[] = { 8, 64, 256, 1024, 4096 };
+    cksum_ctx_t ck = { .buf = calloc(1, 4096) };
+    uint32_t seed = 1;
+    for (int i = 0; i < 4096; i++) ck.buf[i] = (uint8_t)xorshift32(&seed);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        char name[NAME_LEN];
+        ck.n = sizes[i];
+        snprintf(name, sizeof(name), "proto/checksum16/%zu", sizes[i]);
+        run_bench(name, b_checksum, &ck);
+    }
+    free(ck.buf);
+
+    // the three packet shapes the server sends most: PONG, STATE, legacy STATE
+    state_wire_t st;
+    state_legacy_t lg;
+    memset(&st, 0x5A, sizeof(st));
+    memset(&lg, 0x5A, sizeof(lg));
+    struct { const char *tag; uint16_t op; const void *p; uint32_t len; } shapes[] = {
+        { "pong", OP_PONG, NULL, 0 },
+        { "state", OP_STATE, &st, sizeof(st) },
+        { "state_legacy", OP_STATE, &lg, sizeof(lg) },
+    };
+
+    SSL_CTX *sctx = ssl_init_server_ctx("server.crt", "server.key");
+    SSL_CTX *cctx = sctx ? ssl_init_client_ctx() : NULL;
+    if (!sctx) fprintf(stderr, "(no server.crt/server.key here: TLS round trips skipped, see gen_certs.sh)\n");
+
+    for (int tls = 0; tls < 2; tls++) {
+        if (tls && !cctx) break;
+        rt_ctx_t *c = calloc(1, sizeof(*c));
+        if (rt_open(c, tls ? sctx : NULL, cctx) != 0) {
+            fprintf(stderr, "socketpair%s setup failed\n", tls ? " TLS" : "");
+            free(c);
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+            char name[NAME_LEN];
+            snprintf(name, sizeof(name), "proto/roundtrip/%s/%s", tls ? "tls" : "plain", shapes[i].tag);
+            c->op = shapes[i].op;
+            c->payload = shapes[i].p;
+            c->len = shapes[i].len;
+            run_bench(name, b_roundtrip, c);
+        }
+        rt_close(c);
+        free(c);
+    }
+    if (cctx) SSL_CTX_free(cctx);
+    if (sctx) SSL_CTX_free(sctx);
+}
+
+/* ---------- cards / engine ---------- */
+
+static void b_card_def(void *ctx, long iters) {
+    (void)ctx;
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++) {
+        const card_def_t *c = get_card_def((uint16_t)(i & 127)); // valid and invalid ids
+        acc += c ? c->cost : 1;
+    }
+    g_sink += acc;
+}
+
+typedef struct {
+    state_t st;
+    hand_t hand;
+    uint32_t rng;
+} game_ctx_t;
+
+// the state is reset from the template every op (a 20-byte copy), so each
+// play sees the same full-mana position; the events go to one ring, as in
+// the server
+static void b_play_card(void *ctx, long iters) {
+    const game_ctx_t *g = ctx;
+    evlog_t log;
+    memset(&log, 0, sizeof(log));
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++) {
+        state_t st = g->st;
+        hand_t h = g->hand;
+        acc += (uint64_t)handle_play_card(&st, &h, 1, (uint8_t)(i % h.n), &log) + (uint64_t)st.ai_hp;
+    }
+    g_sink += acc + log.head;
+}
+
+static void b_ai_turn(void *ctx, long iters) {
+    const game_ctx_t *g = ctx;
+    evlog_t log;
+    memset(&log, 0, sizeof(log));
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++) {
+        state_t st = g->st;
+        hand_t h = g->hand;
+        uint32_t rng = g->rng + (uint32_t)i * 2654435761u;
+        if (rng == 0) rng = 1;
+        process_ai_turn(&st, &h, &rng, &log);
+        acc += (uint64_t)st.p_hp;
+    }
+    g_sink += acc + log.head;
+}
+
+// a full depth-2 pick without a TT: every op searches the same tree again
+static void b_ai_search(void *ctx, long iters) {
+    const game_ctx_t *g = ctx;
+    ai_search_t cfg = { .depth = 2 };
+    for (long i = 0; i < iters; i++)
+        g_sink += (uint64_t)ai_pick_search(&g->st, &g->hand, &cfg);
+    g_sink += cfg.stats.nodes;
+}
+
+static void bench_engine(void) {
+    run_bench("cards/get_card_def", b_card_def, NULL);
+
+    game_ctx_t g;
+    memset(&g, 0, sizeof(g));
+    g.st.p_hp = 30; g.st.ai_hp = 30;
+    g.st.max_mana = 10; g.st.mana = 10;
+    g.st.phase = PHASE_MAIN;
+    g.rng = 12345;
+    deal_hand(&g.hand, &g.rng);
+    while (g.hand.n < 8) g.hand.card_ids[g.hand.n++] = rand_card_id(&g.rng);
+    run_bench("engine/handle_play_card", b_play_card, &g);
+
+    // two-effect cards (damage+shield, poison+buff): the interpreter's loop
+    game_ctx_t multi = g;
+    multi.hand.n = 2;
+    multi.hand.card_ids[0] = 600; multi.hand.card_ids[1] = 601;
+    run_bench("engine/play_card_multi", b_play_card, &multi);
+
+    g.st.turn = 1;
+    g.st.max_mana = 3; g.st.mana = 3;
+    run_bench("engine/process_ai_turn", b_ai_turn, &g);
+
+    deal_hand(&g.hand, &g.rng);
+    run_bench("engine/ai_search/depth=2", b_ai_search, &g);
+}
+
+/* ---------- ipc session store ---------- */
+
+// a private (calloc) store: same code as the shm one, without touching a
+// running server's /tcg_store_v4
+typedef struct {
+    shm_store_t *store;
+    uint64_t *sids;
+    uint32_t live;
+    state_t st;
+    evlog_t log;
+    hand_t hand;
+    uint32_t pick;
+} store_ctx_t;
+
+static void b_alloc(void *ctx, long iters) {
+    store_ctx_t *c = ctx;
+    for (long i = 0; i < iters; i++) {
+        uint64_t sid = ipc_alloc_session(c->store, AI_TIER_DEFAULT);
+        ipc_release_session(c->store, sid); // keep the fill level constant
+        g_sink += sid;
+    }
+}
+
+static void b_save(void *ctx, long iters) {
+    store_ctx_t *c = ctx;
+    for (long i = 0; i < iters; i++) {
+        uint64_t sid = c->sids[xorshift32(&c->pick) % c->live];
+        g_sink += (uint64_t)ipc_save_session(c->store, sid, &c->st, &c->log, &c->hand, (uint32_t)i);
+    }
+}
+
+static void b_load(void *ctx, long iters) {
+    store_ctx_t *c = ctx;
+    uint32_t rng;
+    for (long i = 0; i < iters; i++) {
+        uint64_t sid = c->sids[xorshift32(&c->pick) % c->live];
+        g_sink += (uint64_t)ipc_load_session(c->store, sid, &c->st, &c->log, &c->hand, &rng) + rng;
+    }
+}
+
+static void b_touch(void *ctx, long iters) {
+    store_ctx_t *c = ctx;
+    for (long i = 0; i < iters; i++) {
+        uint64_t sid = c->sids[xorshift32(&c->pick) % c->live];
+        g_sink += (uint64_t)ipc_touch_session(c->store, sid);
+    }
+}
+
+static void b_snap_encode(void *ctx, long iters) {
+    store_ctx_t *c = ctx;
+    snap_t sn;
+    for (long i = 0; i < iters; i++) {
+        c->st.p_hp = (int16_t)i;
+        g_sink += (uint64_t)snap_encode(&sn, &c->st, &c->hand, (uint32_t)i) + sn.w[0];
+    }
+}
+
+static void b_snap_decode(void *ctx, long iters) {
+    store_ctx_t *c = ctx;
+    snap_t sn;
+    uint32_t rng;
+    snap_encode(&sn, &c->st, &c->hand, 1);
+    for (long i = 0; i < iters; i++) {
+        sn.w[1] ^= (uint64_t)i << 32;
+        snap_decode(&sn, &c->st, &c->hand, &rng);
+        g_sink += rng + (uint64_t)c->st.p_hp;
+    }
+}
+
+static void bench_ipc(void) {
+    {
+        store_ctx_t c;
+        memset(&c, 0, sizeof(c));
+        c.st.p_hp = 30; c.st.ai_hp = 30; c.st.mana = 3; c.st.max_mana = 3; c.st.phase = PHASE_MAIN;
+        uint32_t rng = 5;
+        deal_hand(&c.hand, &rng);
+        run_bench("ipc/snap_encode", b_snap_encode, &c);
+        run_bench("ipc/snap_decode", b_snap_decode, &c);
+    }
+
+    // live sessions: fits in L1/L2, fits in LLC, most of the 64k slots
+    static const uint32_t fills[] = { 64, 4096, 60000 };
+    srand(1);
+    for (size_t f = 0; f < sizeof(fills) / sizeof(fills[0]); f++) {
+        store_ctx_t c;
+        memset(&c, 0, sizeof(c));
+        c.store = calloc(1, sizeof(shm_store_t));
+        c.sids = malloc(fills[f] * sizeof(uint64_t));
+        if (!c.store || !c.sids) { fprintf(stderr, "out of memory\n"); exit(1); }
+        c.store->keep_log = 1; // the server's default
+        c.pick = 7;
+        c.st.p_hp = 30; c.st.ai_hp = 30;
+        for (uint32_t i = 0; i < fills[f]; i++) {
+            c.sids[c.live] = ipc_alloc_session(c.store, AI_TIER_DEFAULT);
+            if (c.sids[c.live]) ipc_save_session(c.store, c.sids[c.live++], &c.st, &c.log, &c.hand, 1);
+        }
+
+        struct { const char *op; bench_fn fn; } ops[] = {
+            { "alloc+release", b_alloc }, { "save", b_save }, { "load", b_load }, { "touch", b_touch },
+        };
+        for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+            char name[NAME_LEN];
+            snprintf(name, sizeof(name), "ipc/%s/live=%u", ops[i].op, fills[f]);
+            run_bench(name, ops[i].fn, &c);
+        }
+        free(c.sids);
+        free(c.store);
+    }
+}
+
+/* ---------- event log ---------- */
+
+static void b_evlog_push(void *ctx, long iters) {
+    evlog_t *log = ctx;
+    for (long i = 0; i < iters; i++)
+        evlog_push(log, EV_PLAY, (uint8_t)(i & 1), (uint16_t)(1 + (i & 7)), (int16_t)i, 3);
+    g_sink += log->head;
+}
+
+static void b_evlog_format(void *ctx, long iters) {
+    const evlog_t *log = ctx;
+    char buf[LOG_LEN];
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++)
+        acc += (uint64_t)evlog_format(&log->events[i % LOG_LINES], buf, sizeof(buf));
+    g_sink += acc;
+}
+
+static void bench_evlog(void) {
+    evlog_t log;
+    memset(&log, 0, sizeof(log));
+    run_bench("evlog/push", b_evlog_push, &log);
+    // one of each line shape the clients draw
+    evlog_push(&log, EV_PLAY, 0, 1, 5, 2);
+    evlog_push(&log, EV_PLAY, 1, 4, 3, 1);
+    evlog_push(&log, EV_POISON_TICK, 0, 0, 1, 3);
+    evlog_push(&log, EV_DRAW_PHASE, 1, 0, 0, 3);
+    evlog_push(&log, EV_END_PHASE, 0, 0, 0, 0);
+    evlog_push(&log, EV_GAME_OVER, 0, 0, 0, 0);
+    run_bench("evlog/format", b_evlog_format, &log);
+}
+
+/* ---------- GUI thread channels ---------- */
+
+// what client_gui's renderer copies every frame
+typedef struct { state_t st; evlog_t log; hand_t hand; int flags[4]; } gui_snap_t;
+
+typedef struct {
+    pthread_mutex_t mu;
+    seqlock_t sl;
+    gui_snap_t shared;
+    spsc_t q;
+    int pfd[2];
+} chan_ctx_t;
+
+static void b_snap_mutex(void *ctx, long iters) {
+    chan_ctx_t *c = ctx;
+    gui_snap_t s;
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++) {
+        pthread_mutex_lock(&c->mu);
+        s = c->shared;
+        pthread_mutex_unlock(&c->mu);
+        acc += s.st.p_hp;
+    }
+    g_sink += acc;
+}
+
+static void b_snap_seqlock(void *ctx, long iters) {
+    chan_ctx_t *c = ctx;
+    gui_snap_t s;
+    uint64_t acc = 0;
+    for (long i = 0; i < iters; i++)
+        acc += seqlock_read(&c->sl, &s, &c->shared, sizeof(s)) + s.st.p_hp;
+    g_sink += acc;
+}
+
+// one UI command handed to the net thread and picked up (same thread here)
+static void b_cmd_pipe(void *ctx, long iters) {
+    chan_ctx_t *c = ctx;
+    uint8_t cmd[4] = { 0 };
+    for (long i = 0; i < iters; i++) {
+        cmd[0] = (uint8_t)i;
+        if (write(c->pfd[1], cmd, sizeof(cmd)) != sizeof(cmd)) break;
+        if (read(c->pfd[0], cmd, sizeof(cmd)) != sizeof(cmd)) break;
+    }
+    g_sink += cmd[0];
+}
+
+static void b_cmd_spsc(void *ctx, long iters) {
+    chan_ctx_t *c = ctx;
+    uint8_t cmd[4] = { 0 };
+    for (long i = 0; i < iters; i++) {
+        cmd[0] = (uint8_t)i;
+        spsc_push(&c->q, cmd);
+        spsc_ack(&c->q);
+        spsc_pop(&c->q, cmd);
+    }
+    g_sink += cmd[0];
+}
+
+static void bench_chan(void) {
+    static chan_ctx_t c;
+    pthread_mutex_init(&c.mu, NULL);
+    c.shared.st.p_hp = 30;
+    if (spsc_init(&c.q, 64, 4) != 0 || pipe(c.pfd) != 0) { perror("chan"); exit(1); }
+    run_bench("gui/snapshot/mutex", b_snap_mutex, &c);
+    run_bench("gui/snapshot/seqlock", b_snap_seqlock, &c);
+    run_bench("gui/cmd/pipe", b_cmd_pipe, &c);
+    run_bench("gui/cmd/spsc+eventfd", b_cmd_spsc, &c);
+    close(c.pfd[0]);
+    close(c.pfd[1]);
+    spsc_free(&c.q);
+}
+
+/* ---------- TLS handshakes ---------- */
+
+typedef struct {
+    SSL_CTX *sctx, *cctx;
+    SSL_SESSION *sess;     // ticket for the next resumed run (tickets are single use)
+    int resume;
+    long not_reused;       // resumed runs the server answered with a full handshake
+} hs_ctx_t;
+
+// One handshake over a fresh non-blocking socketpair, both ends pumped from
+// this thread. Returns 0 ok; *srv_ns gets the time spent in server calls.
+// With ticket_out, the client also reads the ticket the server issued.
+static int hs_once(hs_ctx_t *h, long long *srv_ns, SSL_SESSION **ticket_out) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) != 0) return -1;
+    SSL *srv = SSL_new(h->sctx), *cli = SSL_new(h->cctx);
+    SSL_set_fd(srv, sv[1]);
+    SSL_set_fd(cli, sv[0]);
+    SSL_set_accept_state(srv);
+    SSL_set_connect_state(cli);
+    if (h->resume && h->sess) SSL_set_session(cli, h->sess);
+
+    int s_done = 0, c_done = 0, rc = -1;
+    for (int k = 0; k < 16 && !(s_done && c_done); k++) {
+        if (!c_done) {
+            int r = SSL_do_handshake(cli);
+            if (r == 1) c_done = 1;
+            else if (SSL_get_error(cli, r) != SSL_ERROR_WANT_READ) break;
+        }
+        if (!s_done) {
+            long long t0 = now_ns();
+            int r = SSL_do_handshake(srv);
+            *srv_ns += now_ns() - t0;
+            if (r == 1) s_done = 1;
+            else if (SSL_get_error(srv, r) != SSL_ERROR_WANT_READ) break;
+        }
+    }
+    if (s_done && c_done) {
+        rc = 0;
+        if (h->resume && !SSL_session_reused(cli)) h->not_reused++;
+        if (ticket_out) {
+            // TLS 1.3 tickets arrive after the handshake: a read processes them
+            char b;
+            SSL_read(cli, &b, 1);
+            if (*ticket_out) SSL_SESSION_free(*ticket_out);
+            *ticket_out = SSL_get1_session(cli);
+        }
+    }
+    // a clean close like conn_close: SSL_free without it marks the session
+    // not resumable
+    if (rc == 0) { SSL_shutdown(cli); SSL_shutdown(srv); }
+    SSL_free(srv);
+    SSL_free(cli);
+    close(sv[0]);
+    close(sv[1]);
+    return rc;
+}
+
+static void b_handshake(void *ctx, long iters) {
+    hs_ctx_t *h = ctx;
+    long long srv = 0;
+    for (long i = 0; i < iters; i++) {
+        if (hs_once(h, &srv, h->resume ? &h->sess : NULL) != 0) {
+            ERR_print_errors_fp(stderr);
+            fprintf(stderr, "handshake failed\n");
+            exit(1);
+        }
+    }
+    g_aux = (double)srv / (double)iters;
+}
+
+static void bench_tls(void) {
+    static const char *certs[] = { "server", "server-rsa", "server-rsa3072", "server-ecdsa", "server-ed25519" };
+    char seen[8][32];
+    int nseen = 0, first = g_nres;
+
+    SSL_CTX *cctx = ssl_init_client_ctx();
+    if (!cctx || ssl_ctx_set_profile(cctx, g_tls_ciphers, g_tls_groups, 1) != 0) exit(1);
+
+    for (size_t i = 0; i < sizeof(certs) / sizeof(certs[0]); i++) {
+        char crt[64], key[64], kname[32];
+        snprintf(crt, sizeof(crt), "%s.crt", certs[i]);
+        snprintf(key, sizeof(key), "%s.key", certs[i]);
+        if (access(crt, R_OK) != 0 || access(key, R_OK) != 0) continue;
+        SSL_CTX *sctx = ssl_init_server_ctx(crt, key);
+        if (!sctx) continue;
+        if (ssl_ctx_set_profile(sctx, g_tls_ciphers, g_tls_groups, 1) != 0) exit(1);
+        ssl_ctx_key_name(sctx, kname, sizeof(kname));
+
+        // server.crt is usually one of the generated types: run each key once
+        int dup = 0;
+        for (int k = 0; k < nseen; k++) dup |= strcmp(seen[k], kname) == 0;
+        if (dup || nseen >= 8) { SSL_CTX_free(sctx); continue; }
+        snprintf(seen[nseen++], sizeof(seen[0]), "%s", kname);
+
+        hs_ctx_t h = { .sctx = sctx, .cctx = cctx };
+        long long srv = 0;
+        char name[NAME_LEN];
+        snprintf(name, sizeof(name), "tls/handshake/full/%s", kname);
+        run_bench(name, b_handshake, &h);
+
+        if (hs_once(&h, &srv, &h.sess) == 0 && h.sess) {
+            h.not_reused = 0;
+            h.resume = 1;
+            snprintf(name, sizeof(name), "tls/handshake/resumed/%s", kname);
+            run_bench(name, b_handshake, &h);
+            if (h.not_reused) fprintf(stderr, "  (%ld resumptions fell back to a full handshake)\n", h.not_reused);
+            SSL_SESSION_free(h.sess);
+        }
+        SSL_CTX_free(sctx);
+    }
+    SSL_CTX_free(cctx);
+
+    if (g_nres == first) {
+        if (nseen == 0) fprintf(stderr, "(no certificates here: handshakes skipped, see gen_certs.sh)\n");
+        return;
+    }
+    printf("\n%-40s %14s %14s\n", "handshakes/s per core", "server side", "both ends");
+    for (int i = first; i < g_nres; i++) {
+        const result_t *r = &g_res[i];
+        printf("%-40s %14.0f %14.0f\n", r->name, r->aux > 0 ? 1e9 / r->aux : 0, 1e9 / r->median);
+    }
+    printf("\n");
+}
+
+/* ---------- reports ---------- */
+
+static int write_json(const char *path, const char *label) {
+    FILE *f = fopen(path, "w");
+    if (!f) { perror(path); return -1; }
+    fprintf(f, "{\"label\":\"%s\",\"reps\":%d,\"sample_ms\":%.1f,\"benches\":[\n", label ? label : "", g_reps, g_sample_ms);
+    for (int i = 0; i < g_nres; i++) {
+        const result_t *r = &g_res[i];
+        fprintf(f, "  {\"name\":\"%s\",\"ns_op\":%.3f,\"min\":%.3f,\"mean\":%.3f,\"cv_pct\":%.2f,\"iters\":%ld",
+                r->name, r->median, r->min, r->mean, r->cv, r->iters);
+        if (r->aux >= 0) fprintf(f, ",\"server_ns_op\":%.3f", r->aux);
+        fprintf(f, "}%s\n", i + 1 < g_nres ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+    return 0;
+}
+
+// ns_op of `name` in a file written by write_json, -1 if absent
+static double baseline_ns(const char *json, const char *name) {
+    char key[NAME_LEN + 16];
+    snprintf(key, sizeof(key), "\"name\":\"%.*s\"", NAME_LEN, name);
+    const char *p = strstr(json, key);
+    if (!p) return -1;
+    p = strstr(p, "\"ns_op\":");
+    return p ? atof(p + 8) : -1;
+}
+
+static int compare_baseline(const char *path, double threshold) {
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); return -1; }
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *json = malloc((size_t)n + 1);
+    size_t got = fread(json, 1, (size_t)n, f);
+    json[got] = '\0';
+    fclose(f);
+
+    int worse = 0;
+    printf("\nvs %s (threshold %.0f%%)\n", path, threshold);
+    printf("%-40s %12s %12s %8s\n", "benchmark", "base ns/op", "ns/op", "delta");
+    for (int i = 0; i < g_nres; i++) {
+        const result_t *r = &g_res[i];
+        double base = baseline_ns(json, r->name);
+        if (base <= 0) {
+            printf("%-40s %12s %12.1f %8s\n", r->name, "-", r->median, "new");
+            continue;
+        }
+        double d = 100.0 * (r->median - base) / base;
+        const char *tag = "";
+        if (d > threshold) { tag = "  SLOWER"; worse++; }
+        else if (d < -threshold) tag = "  faster";
+        printf("%-40s %12.1f %12.1f %+7.1f%%%s\n", r->name, base, r->median, d, tag);
+    }
+    free(json);
+    printf("%d regression(s)\n", worse);
+    return worse;
+}
+
+int main(int argc, char **argv) {
+    if (cards_init() != 0) return 1;
+    const char *json_path = NULL, *baseline = NULL, *label = NULL;
+    double threshold = 10;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--filter") == 0 && v) { g_filter = v; i++; }
+        else if (strcmp(a, "--reps") == 0 && v) { g_reps = atoi(v); i++; }
+        else if (strcmp(a, "--sample-ms") == 0 && v) { g_sample_ms = atof(v); i++; }
+        else if (strcmp(a, "--json") == 0 && v) { json_path = v; i++; }
+        else if (strcmp(a, "--baseline") == 0 && v) { baseline = v; i++; }
+        else if (strcmp(a, "--threshold") == 0 && v) { threshold = atof(v); i++; }
+        else if (strcmp(a, "--label") == 0 && v) { label = v; i++; }
+        else if (strcmp(a, "--tls-ciphers") == 0 && v) { g_tls_ciphers = v; i++; }
+        else if (strcmp(a, "--tls-groups") == 0 && v) { g_tls_groups = v; i++; }
+        else {
+            fprintf(stderr, "usage: %s [--filter STR] [--reps N] [--sample-ms MS]\n"
+                            "          [--json FILE] [--baseline FILE] [--threshold PCT] [--label STR]\n"
+                            "          [--tls-ciphers LIST] [--tls-groups LIST]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (g_reps < 1) g_reps = 1;
+    if (g_reps > MAX_REPS) g_reps = MAX_REPS;
+    if (g_sample_ms <= 0) g_sample_ms = 20;
+
+    signal(SIGPIPE, SIG_IGN); // closing one end of a TLS pair before the other
+    ssl_msg_init();
+    printf("reps=%d sample=%.0fms (ns/op: median of reps, after one warmup sample)\n", g_reps, g_sample_ms);
+    printf("%-40s %12s %12s %8s %12s\n", "benchmark", "ns/op", "min", "cv", "iters");
+
+    bench_proto();
+    bench_codec();
+    bench_engine();
+    bench_ipc();
+    bench_evlog();
+    bench_chan();
+    bench_tls();
+
+    if (json_path && write_json(json_path, label) != 0) return 1;
+    if (baseline) {
+        int worse = compare_baseline(baseline, threshold);
+        if (worse != 0) return 1;
+    }
+    return 0;
+}
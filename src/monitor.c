@@ -14,6 +14,11 @@ int main() {
         return 1;
     }
 
+    // AI decision cache is optional (server --no-ai-cache)
+    shm_aicache_t *cache = ipc_aicache_init(0);
+    // and so is the AI CPU budget (--ai-slots 0)
+    shm_aisched_t *sched = ipc_aisched_init(0);
+
     // 2. Monitoring Loop
     while (1) {
         // Clear screen using ANSI escape code
@@ -35,6 +40,57 @@ int main() {
         // Cast to unsigned long for portability across 32/64-bit systems
         printf(" Active Connections : %lu\n", (unsigned long)stats->total_connections); 
         printf(" Total Packets Recv : %lu\n", (unsigned long)stats->total_packets);
+        if (stats->total_flushes > 0)
+            printf(" Response Writes    : %lu (%.2f requests each)\n", (unsigned long)stats->total_flushes,
+                   (double)stats->total_packets / (double)stats->total_flushes);
+
+        if (stats->ai_turns > 0) {
+            printf("----------------------------------------\n");
+            printf(" AI Turns           : %lu (avg %.3f ms)\n", (unsigned long)stats->ai_turns,
+                   (double)stats->ai_turn_ns / (double)stats->ai_turns / 1e6);
+        }
+        uint64_t spec_takes = stats->spec_hits + stats->spec_misses;
+        if (spec_takes > 0) {
+            printf(" AI Speculation     : %lu / %lu hits (%.1f%%, %lu waited)\n",
+                   (unsigned long)stats->spec_hits, (unsigned long)spec_takes,
+                   100.0 * (double)stats->spec_hits / (double)spec_takes,
+                   (unsigned long)stats->spec_late);
+            printf(" AI Spec. Runs      : %lu finished, %lu cancelled\n",
+                   (unsigned long)stats->spec_runs, (unsigned long)stats->spec_cancels);
+        }
+
+        if (!sched) sched = ipc_aisched_init(0);
+        if (sched) {
+            // read without the lock: a display may be a request behind
+            uint64_t late = sched->deadline_misses + sched->shed;
+            uint64_t turns = sched->admitted + late;
+            printf(" AI Budget          : %u / %u slots busy, queue %u (peak %u)\n",
+                   sched->running, sched->slots, sched->queued, sched->queued_peak);
+            printf(" AI Deadline Misses : %lu / %lu turns (%.1f%%, %lu shed), greedy instead\n",
+                   (unsigned long)late, (unsigned long)turns,
+                   turns ? 100.0 * (double)late / (double)turns : 0.0, (unsigned long)sched->shed);
+            if (sched->waited > 0)
+                printf(" AI Slot Wait       : %lu turns queued (avg %.3f ms)\n", (unsigned long)sched->waited,
+                       (double)sched->wait_ns / (double)sched->waited / 1e6);
+        }
+
+        if (!cache) cache = ipc_aicache_init(0); // server may start after us
+        if (cache) {
+            uint64_t lookups = cache->hits + cache->misses;
+            printf(" AI Cache Hit/Miss  : %lu / %lu (%.1f%%)\n",
+                   (unsigned long)cache->hits, (unsigned long)cache->misses,
+                   lookups ? 100.0 * (double)cache->hits / (double)lookups : 0.0);
+            printf(" AI Cache Evictions : %lu\n", (unsigned long)cache->evictions);
+        }
+
+        if (stats->ai_searches > 0) {
+            double hit = stats->ai_tt_probes ? 100.0 * (double)stats->ai_tt_hits / (double)stats->ai_tt_probes : 0.0;
+            double nps = stats->ai_search_ns ? (double)stats->ai_nodes * 1e9 / (double)stats->ai_search_ns : 0.0;
+            printf("----------------------------------------\n");
+            printf(" AI Searches        : %lu\n", (unsigned long)stats->ai_searches);
+            printf(" AI Nodes           : %lu (%.0f nodes/s)\n", (unsigned long)stats->ai_nodes, nps);
+            printf(" AI TT Hit Rate     : %.1f%%\n", hit);
+        }
         
         printf("========================================\n");
         printf(" [Press Ctrl+C to exit monitor]\n");
@@ -0,0 +1,251 @@
+#define _DEFAULT_SOURCE
+#include "predcheck.h"
+#include "common/net.h"
+#include "common/proto.h"
+#include "common/engine.h"
+#include "common/evlog.h"
+#include "common/predict.h"
+#include "common/hist.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/ssl.h>
+
+#define PC_MODES 4 // wait, predict, pipeline, compact
+
+typedef struct {
+    int predict;
+    int pipeline;               // v2+: END_TURN goes out behind the plays
+    uint16_t offer;             // version asked for at login
+    uint16_t ver;               // framing in use
+    connection_t conn;
+    predict_t pred;
+    int outstanding;            // requests still owed their last response
+    uint32_t req_seq;           // v2 header seq
+    long long sent_at[PRED_MAX * 2]; // by play seq, for the confirm time
+
+    uint8_t in[8192];
+    uint32_t in_len;
+    uint8_t out[4096];
+    uint32_t out_len;
+
+    int plays, games;
+    long long ns_games;
+    long long tx_bytes, rx_bytes;
+    hist_t h_visible, h_confirm;
+} pc_run_t;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int pc_flush(pc_run_t *r);
+
+static int pc_connect(pc_run_t *r, SSL_CTX *ctx, const char *host, uint16_t port) {
+    int fd = tcp_connect(host, port);
+    if (fd < 0) return -1;
+    net_set_timeout(fd, 5);
+    SSL *ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (SSL_connect(ssl) <= 0) { SSL_free(ssl); close(fd); return -1; }
+    conn_init(&r->conn, fd, ssl);
+    return 0;
+}
+
+// Queues one request; pc_flush writes everything queued at once
+static int pc_send(pc_run_t *r, uint16_t op, const void *payload, uint32_t plen) {
+    if (r->out_len + sizeof(pkt_hdr2_t) + plen > sizeof(r->out) && pc_flush(r) != 0) return -1;
+    int n = proto_encode_ver(r->ver, r->out + r->out_len, sizeof(r->out) - r->out_len,
+                             op, ++r->req_seq, 0, payload, plen);
+    if (n < 0) return -1;
+    r->out_len += (uint32_t)n;
+    r->outstanding++;
+    return 0;
+}
+
+static int pc_flush(pc_run_t *r) {
+    if (r->out_len == 0) return 0;
+    int rc = conn_writen(&r->conn, r->out, r->out_len) == (ssize_t)r->out_len ? 0 : -1;
+    r->tx_bytes += r->out_len;
+    r->out_len = 0;
+    return rc;
+}
+
+static void pc_packet(pc_run_t *r, const proto_frame_t *f) {
+    state_t st;
+    evlog_t log;
+    if (f->opcode == OP_STATE && state_decode(f->payload, f->plen, &st, &log) == 0) {
+        pred_state(&r->pred, &st, &log);
+    } else if (f->opcode == OP_HAND && f->plen == sizeof(hand_t)) {
+        hand_t hand;
+        memcpy(&hand, f->payload, sizeof(hand));
+        if (hand.n > 8) hand.n = 8;
+        pred_hand(&r->pred, &hand);
+        // v1: every request here ends with HAND; so does the login in v2,
+        // which was sent before v2 framing and has no seq
+        if (r->ver < PROTO_V2 || f->seq == 0) r->outstanding--;
+    } else if (f->opcode == OP_PLAY_ACK && f->plen == sizeof(play_ack_t)) {
+        play_ack_t ack;
+        memcpy(&ack, f->payload, sizeof(ack));
+        if (ack.rc == 0) {
+            long long t = r->sent_at[ack.seq % (PRED_MAX * 2)];
+            hist_add(&r->h_confirm, (uint64_t)(now_ns() - t));
+        }
+        pred_ack(&r->pred, &ack);
+    } else if (f->opcode == OP_RESUME_RESP && f->plen >= offsetof(resume_resp_t, caps)) {
+        resume_resp_t rr;
+        memset(&rr, 0, sizeof(rr));
+        memcpy(&rr, f->payload, f->plen < sizeof(rr) ? f->plen : sizeof(rr));
+        if (rr.ok && rr.version >= PROTO_V2 && rr.version <= r->offer) r->ver = rr.version; // from the next packet on
+    }
+    if (r->ver >= PROTO_V2 && (f->flags & PKT_F_LAST)) r->outstanding--;
+}
+
+// Sends what is queued, then reads until every request is answered.
+// -1 on a broken link
+static int pc_drain(pc_run_t *r) {
+    if (pc_flush(r) != 0) return -1;
+    while (r->outstanding > 0) {
+        ssize_t n = conn_read_some(&r->conn, r->in + r->in_len, sizeof(r->in) - r->in_len);
+        if (n <= 0) return -1;
+        r->in_len += (uint32_t)n;
+        r->rx_bytes += n;
+        uint32_t off = 0;
+        for (;;) {
+            proto_frame_t f;
+            int k = proto_decode_ver(r->ver, r->in + off, r->in_len - off, &f);
+            if (k < 0) return -1;
+            if (k == 0) break;
+            pc_packet(r, &f);
+            off += (uint32_t)k;
+        }
+        memmove(r->in, r->in + off, r->in_len - off);
+        r->in_len -= off;
+    }
+    return 0;
+}
+
+static int pc_game(pc_run_t *r, SSL_CTX *ctx, const char *host, uint16_t port) {
+    if (pc_connect(r, ctx, host, port) != 0) return -1;
+    pred_init(&r->pred);
+    r->ver = PROTO_V1;
+    r->outstanding = 0;
+    r->in_len = r->out_len = 0;
+
+    long long t_game = now_ns();
+    login_req_t lr = { .caps = CAP_EVENT_LOG | (r->predict ? CAP_PLAY_SEQ : 0),
+                       .version = r->offer };
+    int rc = pc_send(r, OP_LOGIN_REQ, &lr, sizeof(lr)) == 0 ? pc_drain(r) : -1;
+
+    while (rc == 0 && !r->pred.st.game_over) {
+        const state_t *v = &r->pred.st;
+        int idx = -1;
+        if (v->turn == 0 && v->phase == PHASE_MAIN) {
+            state_t me;
+            state_mirror(v, &me);
+            idx = ai_pick_greedy(&me, &r->pred.hand, NULL);
+        }
+
+        if (idx >= 0 && r->predict && r->pred.npending < PRED_MAX) {
+            // shown now; the bot goes on from the predicted view
+            long long t0 = now_ns();
+            uint32_t seq;
+            if (pred_play(&r->pred, (uint8_t)idx, &seq) == 0) {
+                hist_add(&r->h_visible, (uint64_t)(now_ns() - t0));
+                r->sent_at[seq % (PRED_MAX * 2)] = t0;
+                play_seq_req_t pr = { .hand_idx = (uint8_t)idx, .seq = seq };
+                if (pc_send(r, OP_PLAY_CARD, &pr, sizeof(pr)) != 0) rc = -1;
+                r->plays++;
+                continue;
+            }
+            idx = -1; // local rules refuse it: settle and end the turn
+        } else if (idx >= 0 && !r->predict) {
+            // shown once the server answered
+            long long t0 = now_ns();
+            play_req_t pr = { .hand_idx = (uint8_t)idx };
+            if (pc_send(r, OP_PLAY_CARD, &pr, sizeof(pr)) != 0) { rc = -1; break; }
+            rc = pc_drain(r);
+            long long dt = now_ns() - t0;
+            hist_add(&r->h_visible, (uint64_t)dt);
+            hist_add(&r->h_confirm, (uint64_t)dt);
+            r->plays++;
+            continue;
+        }
+
+        if (r->pipeline && idx < 0 && r->pred.st.turn == 0) {
+            // v2: the turn's plays and its END_TURN leave in one write
+            if (pc_send(r, OP_END_TURN, NULL, 0) != 0) { rc = -1; break; }
+            rc = pc_drain(r);
+            continue;
+        }
+
+        // v1: in-flight plays settle before the turn ends
+        rc = pc_drain(r);
+        if (rc != 0 || r->pred.st.game_over) break;
+        if (idx < 0 || r->pred.st.turn != 0) {
+            if (pc_send(r, OP_END_TURN, NULL, 0) != 0) { rc = -1; break; }
+            rc = pc_drain(r);
+        }
+    }
+    if (rc == 0) rc = pc_drain(r);
+
+    r->ns_games += now_ns() - t_game;
+    r->games++;
+    conn_close(&r->conn);
+    return rc;
+}
+
+static void pc_print(const char *name, const pc_run_t *r) {
+    int g = r->games ? r->games : 1;
+    printf("%-9s%6d  %8.3f %8.3f  %8.2f %8.2f  %8.2f  %9llu %9llu  %8lld %8lld\n", name, r->plays,
+           hist_quantile(&r->h_visible, 0.50) / 1e6, hist_quantile(&r->h_visible, 0.99) / 1e6,
+           hist_quantile(&r->h_confirm, 0.50) / 1e6, hist_quantile(&r->h_confirm, 0.99) / 1e6,
+           r->ns_games / 1e9 / g,
+           (unsigned long long)r->pred.confirmed, (unsigned long long)r->pred.rollbacks,
+           r->tx_bytes / g, r->rx_bytes / g);
+}
+
+int run_predict_check(const char *host, uint16_t port, int games) {
+    static const char *names[PC_MODES] = { "wait", "predict", "pipeline", "compact" };
+    static const uint16_t offer[PC_MODES] = { PROTO_V1, PROTO_V1, PROTO_V2, PROTO_V3 };
+    SSL_CTX *ctx = ssl_init_client_ctx();
+    if (!ctx) return 1;
+
+    static pc_run_t runs[PC_MODES];
+    uint64_t confirmed = 0, rollbacks = 0;
+    int predicted = 0, failed = 0;
+    for (int m = 0; m < PC_MODES; m++) {
+        pc_run_t *r = &runs[m];
+        memset(r, 0, sizeof(*r));
+        r->predict = m >= 1;
+        r->pipeline = m >= 2;
+        r->offer = offer[m];
+        hist_init(&r->h_visible);
+        hist_init(&r->h_confirm);
+        uint64_t c = 0, rb = 0;
+        for (int g = 0; g < games; g++) {
+            if (pc_game(r, ctx, host, port) != 0) {
+                fprintf(stderr, "[predict-check] game %d (%s) lost the link\n", g, names[m]);
+                failed = 1;
+            }
+            c += r->pred.confirmed;
+            rb += r->pred.rollbacks;
+        }
+        r->pred.confirmed = c; // per-run totals for pc_print
+        r->pred.rollbacks = rb;
+        if (r->predict) { confirmed += c; rollbacks += rb; predicted += r->plays; }
+    }
+    SSL_CTX_free(ctx);
+
+    printf("[predict-check] %s:%u, %d games per mode\n", host, port, games);
+    printf("%-9s%6s  %17s  %17s  %8s  %9s %9s  %8s %8s\n", "mode", "plays",
+           "visible p50/p99ms", "confirm p50/p99ms", "game s", "confirmed", "rollbacks",
+           "tx B/g", "rx B/g");
+    for (int m = 0; m < PC_MODES; m++) pc_print(names[m], &runs[m]);
+    printf("[predict-check] %llu/%d predicted plays confirmed, %llu rollbacks\n",
+           (unsigned long long)confirmed, predicted, (unsigned long long)rollbacks);
+    return (failed || rollbacks) ? 1 : 0;
+}
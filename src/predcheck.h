@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Prediction check: plays N games as a greedy bot over a real connection in
+ * three modes:
+ *   wait      waits for the server after every play (the clients before
+ *             prediction)
+ *   predict   picks the next card from the predicted view, up to PRED_MAX
+ *             plays in flight; END_TURN waits until they are answered
+ *   pipeline  the same on protocol v2: a turn's plays and its END_TURN go
+ *             out in one write and are matched to their answers by seq
+ *   compact   pipeline on protocol v3 (varint framing, compact payloads)
+ * Reports the time until a play is visible, the time until the server
+ * confirmed it, the confirmed/rollback counts and the bytes per game. Run it
+ * through latproxy to see a slow link.
+ */
+
+// 0 when every run finished without a rollback
+int run_predict_check(const char *host, uint16_t port, int games);
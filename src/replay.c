@@ -0,0 +1,312 @@
+#define _DEFAULT_SOURCE
+#include "common/engine.h"
+#include "common/evlog.h"
+#include "common/journal.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * replay: re-run journaled games (server --journal DIR) through the engine.
+ *
+ *   ./replay [-v] [--sid ID] [--bench N] <segment|dir>...
+ *
+ * Segments are mmapped; records are grouped by session and ordered by time,
+ * so a game resumed on another worker is stitched back together. Every
+ * state hash in the journal is checked. --sid prints the rebuilt state of
+ * one game, --bench N times N replay passes over the whole corpus.
+ */
+
+typedef struct {
+    void  *map;
+    size_t len;
+} segment_t;
+
+typedef struct {
+    const journal_rec_t *r;
+    uint64_t seq;          // file/position order, breaks timestamp ties
+} ref_t;
+
+typedef struct {
+    size_t games, verified, finished, diverged, partial;
+    size_t records;
+} totals_t;
+
+static segment_t *g_segs;
+static size_t g_nsegs, g_capsegs;
+static ref_t *g_refs;
+static size_t g_nrefs, g_caprefs;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int load_segment(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { perror(path); return -1; }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(journal_hdr_t)) {
+        fprintf(stderr, "%s: too short\n", path);
+        close(fd);
+        return -1;
+    }
+    size_t len = (size_t)sb.st_size;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { perror("mmap"); return -1; }
+
+    const journal_hdr_t *h = map;
+    if (memcmp(h->magic, JOURNAL_MAGIC, 4) != 0 || h->version != JOURNAL_VERSION ||
+        h->rec_size != sizeof(journal_rec_t)) {
+        fprintf(stderr, "%s: not a v%d journal segment\n", path, JOURNAL_VERSION);
+        munmap(map, len);
+        return -1;
+    }
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    if (g_nsegs == g_capsegs) {
+        g_capsegs = g_capsegs ? g_capsegs * 2 : 64;
+        g_segs = realloc(g_segs, g_capsegs * sizeof(*g_segs));
+    }
+    g_segs[g_nsegs++] = (segment_t){ map, len };
+
+    // a torn tail (worker killed mid-write) is ignored
+    size_t n = (len - sizeof(journal_hdr_t)) / sizeof(journal_rec_t);
+    const journal_rec_t *recs = (const journal_rec_t*)((const char*)map + sizeof(journal_hdr_t));
+    if (g_nrefs + n > g_caprefs) {
+        while (g_nrefs + n > g_caprefs) g_caprefs = g_caprefs ? g_caprefs * 2 : 4096;
+        g_refs = realloc(g_refs, g_caprefs * sizeof(*g_refs));
+    }
+    for (size_t i = 0; i < n; i++) {
+        g_refs[g_nrefs] = (ref_t){ &recs[i], g_nrefs };
+        g_nrefs++;
+    }
+    return 0;
+}
+
+static int load_path(const char *path) {
+    struct stat sb;
+    if (stat(path, &sb) != 0) { perror(path); return -1; }
+    if (!S_ISDIR(sb.st_mode)) return load_segment(path);
+
+    DIR *d = opendir(path);
+    if (!d) { perror(path); return -1; }
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t l = strlen(e->d_name);
+        if (l < 5 || strcmp(e->d_name + l - 5, ".tcgj") != 0) continue;
+        char full[1024];
+        snprintf(full, sizeof(full), "%s/%s", path, e->d_name);
+        load_segment(full);
+    }
+    closedir(d);
+    return 0;
+}
+
+static int cmp_ref(const void *a, const void *b) {
+    const ref_t *x = a, *y = b;
+    if (x->r->session_id != y->r->session_id) return x->r->session_id < y->r->session_id ? -1 : 1;
+    if (x->r->ts_ns != y->r->ts_ns) return x->r->ts_ns < y->r->ts_ns ? -1 : 1;
+    return x->seq < y->seq ? -1 : (x->seq > y->seq);
+}
+
+/* ---------- replay ---------- */
+
+// AI picks recorded since the last JR_AI_DONE, fed back as a policy
+typedef struct {
+    int8_t idx[64];
+    int n, pos;
+} script_t;
+
+static int script_pick(const state_t *st, const hand_t *hand, void *ctx) {
+    (void)st; (void)hand;
+    script_t *s = ctx;
+    return (s->pos < s->n) ? s->idx[s->pos++] : -1;
+}
+
+static void new_game(state_t *st, evlog_t *log, hand_t *hand, uint32_t *rng, uint32_t seed) {
+    // same as the server's LOGIN
+    memset(st, 0, sizeof(*st));
+    memset(log, 0, sizeof(*log));
+    memset(hand, 0, sizeof(*hand));
+    st->p_hp = 30; st->ai_hp = 30;
+    st->max_mana = 3;
+    *rng = seed;
+    enter_turn(st, hand, 0, rng, log);
+}
+
+static const char* type_name(uint8_t t) {
+    switch (t) {
+        case JR_START: return "START";
+        case JR_RESUME: return "RESUME";
+        case JR_PLAY: return "PLAY";
+        case JR_END_TURN: return "END_TURN";
+        case JR_AI_PICK: return "AI_PICK";
+        case JR_AI_DONE: return "AI_DONE";
+        default: return "?";
+    }
+}
+
+static void print_state(const state_t *st, const evlog_t *log, const hand_t *hand) {
+    printf("  hp %d/%d shield %d/%d buff %d/%d poison %u/%u mana %u/%u turn %u phase %u over %u winner %u\n",
+           st->p_hp, st->ai_hp, st->p_shield, st->ai_shield, st->p_buff, st->ai_buff,
+           st->p_poison, st->ai_poison, st->mana, st->max_mana, st->turn, st->phase,
+           st->game_over, st->winner);
+    printf("  hand:");
+    for (int i = 0; i < hand->n; i++) printf(" %u", hand->card_ids[i]);
+    printf("\n");
+    for (int i = 0; i < LOG_LINES; i++) {
+        char line[LOG_LEN];
+        if (evlog_format(evlog_at(log, i), line, sizeof(line)) > 0) printf("  | %s\n", line);
+    }
+}
+
+// Replays g_refs[lo, hi) (one session). Returns 0 ok, 1 diverged, 2 no START.
+static int replay_game(size_t lo, size_t hi, int verbose, uint64_t show_sid, totals_t *t) {
+    uint64_t sid = g_refs[lo].r->session_id;
+    state_t st;
+    evlog_t log;
+    hand_t hand;
+    uint32_t rng = 0;
+    script_t ai = { .n = 0 };
+    ai_policy_t pol = { script_pick, &ai };
+    int started = 0, bad = 0;
+
+    for (size_t i = lo; i < hi && !bad; i++) {
+        const journal_rec_t *r = g_refs[i].r;
+        t->records++;
+        uint32_t want = r->value;
+
+        switch (r->type) {
+            case JR_START:
+                new_game(&st, &log, &hand, &rng, r->value);
+                started = 1;
+                ai.n = 0;
+                continue;
+            case JR_AI_PICK:
+                if (ai.n < (int)sizeof(ai.idx)) ai.idx[ai.n++] = r->arg;
+                continue;
+            default:
+                break;
+        }
+        if (!started) continue; // began in a segment we were not given
+
+        switch (r->type) {
+            case JR_RESUME:
+                // the store must hold exactly what we rebuilt; a server with
+                // --no-store-log brings the game back without its event log
+                if (journal_state_hash(&st, &log, &hand) != want) {
+                    evlog_t bare;
+                    memset(&bare, 0, sizeof(bare));
+                    if (journal_state_hash(&st, &bare, &hand) != want) { bad = 1; break; }
+                    log = bare;
+                }
+                evlog_push(&log, EV_RESUMED, 0, 0, 0, st.mana);
+                break;
+            case JR_PLAY:
+                engine_play_card(&st, &hand, 1, (uint8_t)r->arg, &rng, &log);
+                bad = journal_state_hash(&st, &log, &hand) != want;
+                break;
+            case JR_END_TURN:
+                phase_end(&st, &hand, &rng, &log);
+                bad = journal_state_hash(&st, &log, &hand) != want;
+                break;
+            case JR_AI_DONE:
+                ai.pos = 0;
+                process_ai_turn_with(&st, &hand, &pol, &rng, &log);
+                ai.n = 0;
+                bad = journal_state_hash(&st, &log, &hand) != want;
+                break;
+            default:
+                fprintf(stderr, "session %llu: unknown record type %u\n",
+                        (unsigned long long)sid, r->type);
+                bad = 1;
+                break;
+        }
+        if (bad && verbose >= 0)
+            fprintf(stderr, "session %llu: MISMATCH at record %zu (%s)\n",
+                    (unsigned long long)sid, i - lo, type_name(r->type));
+    }
+
+    t->games++;
+    if (!started) t->partial++;
+    else if (bad) t->diverged++;
+    else {
+        t->verified++;
+        t->finished += st.game_over;
+    }
+
+    if (verbose > 0 && started) {
+        static const char *result[] = { ", draw", ", player won", ", AI won" };
+        printf("session %llu: %zu records %s%s\n", (unsigned long long)sid, hi - lo,
+               bad ? "DIVERGED" : "ok",
+               (st.game_over && st.winner <= 2) ? result[st.winner] : "");
+    }
+    if (show_sid && sid == show_sid && started) {
+        printf("session %llu rebuilt state:\n", (unsigned long long)sid);
+        print_state(&st, &log, &hand);
+    }
+    return !started ? 2 : bad;
+}
+
+static void replay_all(int verbose, uint64_t show_sid, totals_t *t) {
+    memset(t, 0, sizeof(*t));
+    size_t lo = 0;
+    while (lo < g_nrefs) {
+        size_t hi = lo + 1;
+        while (hi < g_nrefs && g_refs[hi].r->session_id == g_refs[lo].r->session_id) hi++;
+        replay_game(lo, hi, verbose, show_sid, t);
+        lo = hi;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (cards_init() != 0) return 1;
+    int verbose = 0, bench = 0, npaths = 0;
+    uint64_t show_sid = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) verbose = 1;
+        else if (strcmp(argv[i], "--sid") == 0 && i + 1 < argc) show_sid = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench = atoi(argv[++i]);
+        else { load_path(argv[i]); npaths++; }
+    }
+    if (npaths == 0) {
+        fprintf(stderr, "usage: %s [-v] [--sid ID] [--bench N] <segment|dir>...\n", argv[0]);
+        return 2;
+    }
+
+    qsort(g_refs, g_nrefs, sizeof(*g_refs), cmp_ref);
+
+    totals_t t;
+    long long t0 = now_ns();
+    replay_all(verbose, show_sid, &t);
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    printf("segments=%zu records=%zu games=%zu verified=%zu finished=%zu diverged=%zu partial=%zu\n",
+           g_nsegs, t.records, t.games, t.verified, t.finished, t.diverged, t.partial);
+
+    if (bench > 0) {
+        totals_t bt;
+        t0 = now_ns();
+        for (int i = 0; i < bench; i++) replay_all(-1, 0, &bt);
+        secs = (double)(now_ns() - t0) / 1e9 / bench;
+    }
+    if (secs > 0)
+        printf("replay: %.3f ms/pass, %.0f games/s, %.0f records/s\n",
+               secs * 1e3, (double)t.games / secs, (double)t.records / secs);
+
+    for (size_t i = 0; i < g_nsegs; i++) munmap(g_segs[i].map, g_segs[i].len);
+    free(g_segs);
+    free(g_refs);
+    return t.diverged ? 1 : 0;
+}
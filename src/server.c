@@ -1,17 +1,28 @@
+#define _DEFAULT_SOURCE
 #include "common/net.h"
 #include "common/proto.h"
 #include "common/ipc.h"
+#include "common/engine.h"
+#include "common/ai.h"
+#include "common/evlog.h"
+#include "common/journal.h"
+#include "common/spec.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <stdarg.h>
+#include <errno.h>
 #include <time.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/mman.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
@@ -43,87 +54,151 @@ static void on_sigint(int sig) {
 
 static void on_sigchld(int sig) {
     (void)sig;
+    int saved = errno;
     while (waitpid(-1, NULL, WNOHANG) > 0) {}
+    errno = saved;
 }
 
-/* ---------- Game helpers ---------- */
-
-static void push_log(state_t *st, const char *fmt, ...) {
-    uint8_t idx = st->log_head % LOG_LINES;
-    va_list ap;
-    va_start(ap, fmt);
-    vsnprintf(st->logs[idx], sizeof(st->logs[idx]), fmt, ap);
-    va_end(ap);
-
-    // vsnprintf always null terminates if size > 0
-    st->log_head = (uint8_t)((st->log_head + 1) % LOG_LINES);
+// sigaction, not signal(): under -std=c11 signal() has SysV semantics and
+// resets the handler after the first delivery, so every worker after the
+// first one stayed a zombie.
+static void on_signal(int sig, void (*fn)(int), int flags) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = fn;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = flags;
+    sigaction(sig, &sa, NULL);
 }
 
+/* ---------- AI selection ---------- */
+
+typedef enum { AI_GREEDY = 0, AI_SEARCH = 1 } ai_kind_t;
+
+static ai_kind_t g_ai_kind = AI_GREEDY;
+static ai_search_t g_search = { .tt = NULL, .depth = 2, .max_nodes = 200000 };
+
+typedef struct {
+    ai_kind_t kind;
+    int depth;
+    uint64_t max_nodes; // per pick
+} ai_tier_def_t;
+
+// search budget per difficulty; the default tier is --ai / --ai-depth. The
+// names live in proto_ai_tier
+static ai_tier_def_t g_tiers[AI_TIER_COUNT] = {
+    [AI_TIER_DEFAULT] = { AI_GREEDY, 2, 200000 },
+    [AI_TIER_EASY]    = { AI_GREEDY, 0, 0 },
+    [AI_TIER_NORMAL]  = { AI_SEARCH, 2, 20000 },
+    [AI_TIER_HARD]    = { AI_SEARCH, 3, 200000 },
+};
+static shm_aisched_t *g_aisched = NULL; // NULL = --ai-slots 0, no CPU budget
+static shm_aicache_t *g_aicache = NULL; // NULL = --no-ai-cache
+static const char *g_journal_dir = NULL; // NULL = no --journal
+static uint16_t g_proto_max = PROTO_VERSION; // --proto-max
+static int g_speculate = -1; // --[no-]ai-speculate; -1 = sessions whose tier searches
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-
-static void apply_damage(int16_t *hp, int16_t *shield, int dmg) {
-    if (dmg <= 0) return;
-
-    if (*shield > 0) {
-        int s = (int)(*shield);
-        int used = (dmg < s) ? dmg : s;
-        *shield = (int16_t)(*shield - used);
-        dmg -= used;
-    }
-    if (dmg > 0) {
-        *hp = (int16_t)(*hp - dmg);
-        if (*hp < 0) *hp = 0;
-    }
+/* ---------- Session I/O ----------
+ * Requests are read into `in` as they come and handled one by one; their
+ * responses collect in `out` and are written only once no complete request
+ * is left and nothing more is readable. A client that sends a burst gets
+ * all the answers in one write, and STATE + HAND never go out as two small
+ * writes that Nagle would hold back.
+ */
+#define IO_IN_CAP  8192
+#define IO_OUT_CAP 16384
+
+typedef struct {
+    connection_t *c;
+    shm_stats_t *stats;
+    uint16_t ver;       // framing, PROTO_V1 until the handshake picked one
+    uint32_t seq;       // request being answered (v2)
+    int      last_off;  // its last response in out, -1 none yet
+    uint8_t  in[IO_IN_CAP];
+    uint32_t in_len, in_off;
+    uint8_t  out[IO_OUT_CAP];
+    uint32_t out_len;
+    void   (*idle)(void *ctx); // optional: everything is answered and written, about to wait
+    void    *idle_ctx;
+} sess_io_t;
+
+static int io_flush(sess_io_t *io) {
+    if (io->out_len == 0) return 0;
+    ssize_t w = conn_writen(io->c, io->out, io->out_len);
+    int rc = (w == (ssize_t)io->out_len) ? 0 : -1;
+    io->out_len = 0;
+    io->last_off = -1;
+    ipc_stats_inc_flush(io->stats);
+    return rc;
 }
 
-static void tick_poison(state_t *st) {
-    if (st->p_poison > 0) {
-        st->p_poison--;
-        st->p_hp = (int16_t)(st->p_hp - 2);
-        if (st->p_hp < 0) st->p_hp = 0;
-        push_log(st, "P takes poison (-2)");
-    }
-    if (st->ai_poison > 0) {
-        st->ai_poison--;
-        st->ai_hp = (int16_t)(st->ai_hp - 2);
-        if (st->ai_hp < 0) st->ai_hp = 0;
-        push_log(st, "AI takes poison (-2)");
-    }
+// Queues one response to the current request
+static int io_put(sess_io_t *io, uint16_t op, const void *payload, uint32_t plen) {
+    uint32_t need = (uint32_t)sizeof(pkt_hdr2_t) + plen;
+    if (IO_OUT_CAP - io->out_len < need && io_flush(io) != 0) return -1;
+    int n = proto_encode_ver(io->ver, io->out + io->out_len, IO_OUT_CAP - io->out_len,
+                             op, io->seq, 0, payload, plen);
+    if (n < 0) return -1;
+    io->last_off = (int)io->out_len;
+    io->out_len += (uint32_t)n;
+    return 0;
 }
 
-static void check_game_over(state_t *st) {
-    if (st->game_over) return;
-    if (st->p_hp <= 0 || st->ai_hp <= 0) {
-        st->game_over = 1;
-        if (st->p_hp > st->ai_hp) st->winner = 1;
-        else if (st->ai_hp > st->p_hp) st->winner = 2;
-        else st->winner = 0;
-        push_log(st, "GAME OVER");
-    }
+// The current request is done: flag its last response (v2)
+static void io_end(sess_io_t *io) {
+    if (io->ver >= PROTO_V2 && io->seq != 0 && io->last_off >= 0)
+        proto_set_flags(io->ver, io->out + io->last_off, PKT_F_LAST);
+    io->last_off = -1;
+    io->seq = 0;
 }
 
-#include "common/cards.h"
-
-static uint16_t rand_card_id(void) {
-    // Pool of new IDs
-    static const uint16_t pool[] = {
-        100, 101, 102, // ATK
-        200, 201,      // HEAL
-        300, 301,      // SHIELD
-        400, 401,      // BUFF
-        500, 501       // POISON
-    };
-    int n = sizeof(pool)/sizeof(pool[0]);
-    return pool[rand() % n];
+// Next request into payload. Writes the queued responses before it waits.
+// 0 ok, -1 closed / broken / bad packet
+static int io_next(sess_io_t *io, uint16_t *op, void *payload, uint32_t cap, uint32_t *plen) {
+    io_end(io);
+    for (;;) {
+        proto_frame_t f;
+        int n = proto_decode_ver(io->ver, io->in + io->in_off, io->in_len - io->in_off, &f);
+        if (n < 0 || (n > 0 && f.plen > cap)) return -1;
+        if (n > 0) {
+            io->in_off += (uint32_t)n;
+            io->seq = f.seq;
+            *op = f.opcode;
+            *plen = f.plen;
+            if (f.plen) memcpy(payload, f.payload, f.plen);
+            return 0;
+        }
+
+        memmove(io->in, io->in + io->in_off, io->in_len - io->in_off);
+        io->in_len -= io->in_off;
+        io->in_off = 0;
+        if (io->in_len == IO_IN_CAP) return -1; // a packet never fits: not ours
+
+        // a partial TLS record makes this wait briefly, never for a new request
+        if (!conn_readable(io->c)) {
+            if (io_flush(io) != 0) return -1;
+            if (io->idle) io->idle(io->idle_ctx);
+        }
+        ssize_t r = conn_read_some(io->c, io->in + io->in_len, IO_IN_CAP - io->in_len);
+        if (r <= 0) return -1;
+        io->in_len += (uint32_t)r;
+    }
 }
 
-static void deal_hand(hand_t *h) {
-    memset(h, 0, sizeof(*h));
-    h->n = 3;
-    for (int i = 0; i < 3; i++) h->card_ids[i] = rand_card_id();
+// Highest version both sides speak; v3 has no legacy state format
+static uint16_t pick_version(uint16_t offered, uint32_t caps) {
+    uint16_t v = offered < g_proto_max ? offered : g_proto_max;
+    if (v >= PROTO_V3 && !(caps & CAP_EVENT_LOG)) v = PROTO_V2;
+    return v < PROTO_V1 ? PROTO_V1 : v;
 }
 
-static int err_send(connection_t *c, int32_t code, const char *msg) { // Fixed signature in prev step
+static int err_send(sess_io_t *io, int32_t code, const char *msg) {
     error_t e;
     memset(&e, 0, sizeof(e));
     e.code = code;
@@ -131,142 +206,137 @@ static int err_send(connection_t *c, int32_t code, const char *msg) { // Fixed s
         strncpy(e.msg, msg, sizeof(e.msg) - 1);
         e.msg[sizeof(e.msg) - 1] = '\0';
     }
-    return proto_send(c, OP_ERROR, &e, sizeof(e));
+    return io_put(io, OP_ERROR, &e, sizeof(e));
 }
 
-
-static int handle_play_card(state_t *st, hand_t *hand, int is_player, uint8_t idx) {
-    if (idx >= hand->n) return -1;
-    
-    uint16_t cid = hand->card_ids[idx];
-    if (cid == 0) return -3;
-
-    const card_def_t *c = get_card_def(cid);
-    if (!c) return -3;
-
-    if (c->cost > st->mana) return -2;
-    st->mana = (uint8_t)(st->mana - c->cost);
-
-    int16_t *self_hp     = is_player ? &st->p_hp     : &st->ai_hp;
-    int16_t *enemy_hp    = is_player ? &st->ai_hp    : &st->p_hp;
-    int16_t *self_shield = is_player ? &st->p_shield : &st->ai_shield;
-    int16_t *enemy_shield= is_player ? &st->ai_shield: &st->p_shield;
-    int16_t *self_buff   = is_player ? &st->p_buff   : &st->ai_buff;
-    uint8_t *enemy_poison= is_player ? &st->ai_poison : &st->p_poison;
-
-    switch (c->type) {
-        case CT_ATK: {
-            int dmg = (int)c->value + (int)(*self_buff);
-            *self_buff = 0; // consume buff
-            apply_damage(enemy_hp, enemy_shield, dmg);
-            push_log(st, "%s %s (%d) [mana %u]", is_player ? "P" : "AI",
-                     "ATK", dmg, st->mana);
-        } break;
-        case CT_HEAL: {
-            *self_hp = (int16_t)(*self_hp + c->value);
-            push_log(st, "%s HEAL (+%d) [mana %u]", is_player ? "P" : "AI",
-                     (int)c->value, st->mana);
-        } break;
-        case CT_SHIELD: {
-            *self_shield = (int16_t)(*self_shield + c->value);
-            push_log(st, "%s SHIELD (+%d) [mana %u]", is_player ? "P" : "AI",
-                     (int)c->value, st->mana);
-        } break;
-        case CT_BUFF: {
-            // User logic: BUFF adds to NEXT attack.
-            *self_buff = (int16_t)(*self_buff + c->value);
-            push_log(st, "%s BUFF (+%d next) [mana %u]", is_player ? "P" : "AI",
-                     (int)c->value, st->mana);
-        } break;
-        case CT_POISON: {
-            // User logic: POISON adds TURNS. (Value = turns)
-            *enemy_poison = (uint8_t)(*enemy_poison + (uint8_t)c->value);
-            push_log(st, "%s POISON (+%d turns) [mana %u]", is_player ? "P" : "AI",
-                     (int)c->value, st->mana);
-        } break;
-        default:
-            return -3;
+// OP_STATE in the format the client asked for at login: the wire forms are
+// only built here, the game itself runs on state_t + its evlog_t
+static int send_state(sess_io_t *io, const state_t *st, const evlog_t *log, uint32_t caps) {
+    if (caps & CAP_EVENT_LOG) {
+        state_wire_t w;
+        state_pack(st, log, &w);
+        return io_put(io, OP_STATE, &w, sizeof(w));
     }
 
-    check_game_over(st);
-    return 0;
+    state_legacy_t lg;
+    state_to_legacy(st, log, &lg);
+    return io_put(io, OP_STATE, &lg, sizeof(lg));
 }
 
-// FSM and AI (Same as before but ensures correct logic usage)
-static void enter_turn(state_t *st, hand_t *hand, int side);
-static void phase_draw(state_t *st, hand_t *hand);
-static void phase_end(state_t *st, hand_t *hand);
+// One AI play (CAP_AI_STREAM); flush: write it right away
+static void ai_play_send(sess_io_t *io, const state_t *st, const evlog_t *log, uint8_t step,
+                         int flush) {
+    ai_play_t ap;
+    memset(&ap, 0, sizeof(ap));
+    ap.step = step;
+    for (int i = LOG_LINES - 1; i >= 0; i--) { // newest first: a winning play is followed by EV_GAME_OVER
+        const game_event_t *e = evlog_at(log, i);
+        if (e->kind == EV_PLAY) { ap.ev = *e; break; }
+    }
+    ap.p_hp = st->p_hp;
+    ap.ai_hp = st->ai_hp;
+    ap.p_shield = st->p_shield;
+    ap.ai_shield = st->ai_shield;
+    io_put(io, OP_AI_PLAY, &ap, sizeof(ap));
+    if (flush) io_flush(io);
+}
 
-static void enter_turn(state_t *st, hand_t *hand, int side) {
-    st->turn = (uint8_t)side;
-    st->phase = PHASE_DRAW;
-    phase_draw(st, hand);
+// The tier's policy: search behind the decision cache, or plain greedy.
+// stop: set to abandon a pick (speculation), NULL = never
+static ai_policy_t ai_policy(ai_search_t *s, ai_cached_t *cached, int tier, const int *stop) {
+    const ai_tier_def_t *t = &g_tiers[tier];
+    *s = g_search; // tt is shared, stats are per user
+    s->depth = t->depth;
+    s->max_nodes = t->max_nodes;
+    memset(&s->stats, 0, sizeof(s->stats));
+    s->stop = stop;
+
+    // greedy scores at most 8 cards, faster than a cache lookup even on a hit
+    if (t->kind != AI_SEARCH) return (ai_policy_t){ ai_pick_greedy, NULL };
+
+    memset(cached, 0, sizeof(*cached));
+    cached->cache = g_aicache;
+    cached->stop = stop;
+    cached->inner = (ai_policy_t){ ai_pick_search, s };
+    cached->policy_id = (uint8_t)(16 + 8 * tier + t->depth);
+    return (ai_policy_t){ ai_pick_cached, cached };
 }
 
-static void phase_draw(state_t *st, hand_t *hand) {
-    st->mana = st->max_mana;
-    if (st->turn == 0) { // Player
-        deal_hand(hand);
-        push_log(st, "P: DRAW PHASE");
-    } else { // AI
-        deal_hand(hand);
-        push_log(st, "AI: DRAW PHASE");
-    }
-    st->phase = PHASE_MAIN;
+// search counters into the shared stats, then zeroed
+static void add_search_stats(shm_stats_t *stats, ai_search_t *s) {
+    if (s->stats.picks)
+        ipc_stats_add_ai(stats, s->stats.picks, s->stats.nodes,
+                         s->stats.tt_probes, s->stats.tt_hits, s->stats.ns);
+    memset(&s->stats, 0, sizeof(s->stats));
 }
 
-static void phase_end(state_t *st, hand_t *hand) {
-    st->phase = PHASE_END;
-    push_log(st, "%s: END PHASE", st->turn == 0 ? "P" : "AI");
-    tick_poison(st);
-    check_game_over(st);
-    if (st->game_over) return;
-    int next_side = (st->turn == 0) ? 1 : 0;
-    enter_turn(st, hand, next_side);
+// aisched slot for the turn: AI_SLOT_ASK acquires one if the tier searches,
+// >= 0 = already held (released here), any other value < 0 = refused (play
+// greedy). Outside the range of ipc_aisched_acquire, whose -1 and -2 both
+// mean refused.
+#define AI_SLOT_ASK INT_MIN
+#define AI_SLOT_REFUSED(slot) ((slot) < 0 && (slot) != AI_SLOT_ASK)
+
+// Takes a CPU budget slot for a searching tier: < 0 = none, play greedy;
+// AI_SLOT_ASK when the turn needs no slot
+static int ai_slot_acquire(int tier) {
+    if (g_tiers[tier].kind != AI_SEARCH || !g_aisched) return AI_SLOT_ASK;
+    return ipc_aisched_acquire(g_aisched);
 }
 
-static int ai_eval_card(const state_t *st, const card_def_t *c) {
-    int score = 0;
-    if (st->ai_hp < 10 && c->type == CT_HEAL) score += 100;
-    if (st->p_shield > 0 && c->type == CT_BUFF) score += 40; // Break shield setup
-    
-    switch (c->type) {
-        case CT_ATK: score += c->value; break;
-        case CT_POISON: if (st->p_poison == 0) score += 30; break;
-        case CT_SHIELD: if (st->ai_shield == 0) score += 20; break;
-        default: break;
+// stream: the END_TURN being answered with CAP_AI_STREAM, NULL = none
+// plan: the picks the speculation made for this turn, NULL = ask the policy
+// t0: when the turn began, including any wait for the speculation
+static void run_ai_turn(state_t *st, evlog_t *log, hand_t *hand, uint32_t *rng,
+                        shm_stats_t *stats, journal_t *jr, uint64_t sid, int tier,
+                        sess_io_t *stream, const ai_plan_t *plan, int slot, long long t0) {
+    ai_search_t s;
+    ai_cached_t cached;
+    ai_policy_t inner = ai_policy(&s, &cached, tier, NULL);
+    ai_plan_cursor_t cur = { plan, 0 };
+    int searching = !plan && g_tiers[tier].kind == AI_SEARCH;
+    if (!plan && slot == AI_SLOT_ASK) slot = ai_slot_acquire(tier);
+    if (plan) {
+        inner = (ai_policy_t){ ai_pick_plan, &cur };
+    } else if (searching && AI_SLOT_REFUSED(slot)) {
+        // over the CPU budget the turn plays greedy rather than wait on
+        inner = ai_policy(&s, &cached, AI_TIER_EASY, NULL);
+        searching = 0;
     }
-    score -= (c->cost * 2);
-    return score;
-}
 
-static void process_ai_turn(state_t *st, hand_t *hand) {
-    while (st->phase == PHASE_MAIN && !st->game_over) {
-        int best_idx = -1;
-        int best_score = -9999;
-
-        for (int i = 0; i < hand->n; i++) {
-            uint16_t cid = hand->card_ids[i];
-            if (cid == 0) continue;
-            const card_def_t *c = get_card_def(cid);
-            if (!c) continue;
-            if (c->cost <= st->mana) {
-                int score = ai_eval_card(st, c);
-                if (score > best_score) {
-                    best_score = score;
-                    best_idx = i;
-                }
-            }
-        }
-        
-        if (best_idx >= 0) {
-            handle_play_card(st, hand, 0, (uint8_t)best_idx);
-            hand->card_ids[best_idx] = 0; 
-        } else {
-            break; 
-        }
+    // picks go to the journal: cached/search decisions are not reproducible
+    journal_policy_t rec = { jr, sid, inner };
+    ai_policy_t pol = { journal_pick, &rec };
+    uint8_t step = 0;
+    while (ai_turn_step(st, hand, &pol, rng, log)) {
+        // instant picks (replayed, greedy) go out in one write with the final state
+        if (stream) ai_play_send(stream, st, log, ++step, searching);
     }
-    if (!st->game_over) phase_end(st, hand);
+    if (slot >= 0) ipc_aisched_release(g_aisched, slot);
+    if (!st->game_over) phase_end(st, hand, rng, log);
+    journal_log_state(jr, sid, JR_AI_DONE, 0, st, log, hand);
+
+    add_search_stats(stats, &s);
+    ipc_stats_add_ai_turn(stats, (uint64_t)(now_ns() - t0));
+}
+
+typedef struct {
+    journal_t *jr;
+    ai_spec_t *spec;     // NULL: no speculation
+    const state_t *st;
+    const hand_t *hand;
+    const uint32_t *rng;
+} session_idle_t;
+
+// The answers are written and nothing is left to read. The player is
+// thinking: the speculation worker plays the AI turn that an END_TURN would
+// start (posting only now keeps it from starting while a reply still waits
+// to be written), and the journal batch goes to disk without delaying one.
+static void session_on_idle(void *ctx) {
+    session_idle_t *si = (session_idle_t*)ctx;
+    if (si->spec && si->st->turn == 0 && !si->st->game_over)
+        ai_spec_post(si->spec, si->st, si->hand, *si->rng);
+    journal_maybe_flush(si->jr);
 }
 
 static void run_session(int cfd, SSL *ssl, shm_stats_t *stats, shm_store_t *store) {
@@ -278,68 +348,106 @@ static void run_session(int cfd, SSL *ssl, shm_stats_t *stats, shm_store_t *stor
     // We need a session ID. 
     // Wait for LOGIN or RESUME.
     uint64_t my_sid = 0;
+    uint32_t caps = 0;
+    uint32_t rng = 0;
+    int tier = AI_TIER_DEFAULT;
+
+    journal_t jr;
+    journal_init(&jr, g_journal_dir);
 
     state_t st;
+    evlog_t log;
     hand_t hand;
     memset(&st, 0, sizeof(st));
+    memset(&log, 0, sizeof(log));
     memset(&hand, 0, sizeof(hand));
     
     uint8_t payload[1024];
+    uint16_t version = PROTO_V1; // picked at login, used once the handshake is answered
+
+    static sess_io_t io;
+    memset(&io, 0, sizeof(io));
+    io.c = &conn;
+    io.stats = stats;
+    io.ver = PROTO_V1;
+    io.last_off = -1;
 
     // Handshake Phase
     while (my_sid == 0) {
        uint16_t op = 0;
        uint32_t plen = 0;
-       if (proto_recv(&conn, &op, payload, sizeof(payload), &plen) != 0) { conn_close(&conn); return; }
+       if (io_next(&io, &op, payload, sizeof(payload), &plen) != 0) { conn_close(&conn); return; }
 
        if (op == OP_PING) {
-            proto_send(&conn, OP_PONG, NULL, 0);
+            io_put(&io, OP_PONG, NULL, 0);
             continue;
        }
 
        if (op == OP_LOGIN_REQ) {
+           login_req_t lq;
+           memset(&lq, 0, sizeof(lq));
+           memcpy(&lq, payload, plen < sizeof(lq) ? plen : sizeof(lq));
+           if (plen >= offsetof(login_req_t, version)) caps = lq.caps & SERVER_CAPS;
+           version = pick_version(lq.version, caps);
+           if (plen >= offsetof(login_req_t, tier) + 1 && lq.tier < AI_TIER_COUNT) tier = lq.tier;
+
            // New session
            st.p_hp = 30; st.ai_hp = 30;
            st.max_mana = 3; 
            st.game_over = 0;
-           enter_turn(&st, &hand, 0); // Player turn start -> Phase DRAW -> MAIN
+           uint32_t seed = (uint32_t)rand() ^ (uint32_t)now_ns();
+           if (seed == 0) seed = 1;
+           rng = seed;
+           enter_turn(&st, &hand, 0, &rng, &log); // Player turn start -> Phase DRAW -> MAIN
            
-           my_sid = ipc_alloc_session(store);
+           my_sid = ipc_alloc_session(store, (uint8_t)tier);
            if (my_sid == 0) {
-               err_send(&conn, -999, "server full");
+               err_send(&io, -999, "server full");
+               io_flush(&io);
                conn_close(&conn);
                return; 
            }
-           ipc_save_session(store, my_sid, &st, &hand);
+           ipc_save_session(store, my_sid, &st, &log, &hand, rng);
+           journal_log(&jr, my_sid, JR_START, 0, seed);
 
 
            login_resp_t resp = { .ok = 1 };
-           proto_send(&conn, OP_LOGIN_RESP, &resp, sizeof(resp));
+           io_put(&io, OP_LOGIN_RESP, &resp, sizeof(resp));
            
-           resume_resp_t rr = { .ok = 1, .session_id = my_sid };
-           proto_send(&conn, OP_RESUME_RESP, &rr, sizeof(rr));
+           resume_resp_t rr = { .ok = 1, .session_id = my_sid, .caps = caps, .version = version };
+           io_put(&io, OP_RESUME_RESP, &rr, sizeof(rr));
+           io.ver = version;
            
-           proto_send(&conn, OP_STATE, &st, sizeof(st));
-           proto_send(&conn, OP_HAND, &hand, sizeof(hand));
+           send_state(&io, &st, &log, caps);
+           io_put(&io, OP_HAND, &hand, sizeof(hand));
            break;
        }
        else if (op == OP_RESUME_REQ) {
-           if (plen < sizeof(resume_req_t)) { conn_close(&conn); return; }
-           resume_req_t *rr = (resume_req_t*)payload;
-           if (ipc_load_session(store, rr->session_id, &st, &hand) == 0) {
+           if (plen < offsetof(resume_req_t, caps)) { conn_close(&conn); return; }
+           resume_req_t rr;
+           memset(&rr, 0, sizeof(rr));
+           memcpy(&rr, payload, plen < sizeof(rr) ? plen : sizeof(rr));
+           caps = (plen >= offsetof(resume_req_t, version)) ? rr.caps & SERVER_CAPS : 0;
+           version = pick_version(rr.version, caps);
+           if (ipc_load_session(store, rr.session_id, &st, &log, &hand, &rng) == 0) {
                // Found
-               my_sid = rr->session_id;
-               resume_resp_t rresp = { .ok = 1, .session_id = my_sid };
-               proto_send(&conn, OP_RESUME_RESP, &rresp, sizeof(rresp));
-               proto_send(&conn, OP_STATE, &st, sizeof(st));
-               proto_send(&conn, OP_HAND, &hand, sizeof(hand));
+               my_sid = rr.session_id;
+               int t = ipc_session_tier(store, my_sid);
+               if (t > 0 && t < AI_TIER_COUNT) tier = t;
+               journal_log_state(&jr, my_sid, JR_RESUME, 0, &st, &log, &hand);
+               resume_resp_t rresp = { .ok = 1, .session_id = my_sid, .caps = caps, .version = version };
+               io_put(&io, OP_RESUME_RESP, &rresp, sizeof(rresp));
+               io.ver = version;
+               send_state(&io, &st, &log, caps);
+               io_put(&io, OP_HAND, &hand, sizeof(hand));
                
-               push_log(&st, "Player Resumed Session");
+               evlog_push(&log, EV_RESUMED, 0, 0, 0, st.mana);
+               ipc_save_session(store, my_sid, &st, &log, &hand, rng); // keep store == journal
                break;
            } else {
                // Not found
-               resume_resp_t rresp = { .ok = 0, .session_id = 0 };
-               proto_send(&conn, OP_RESUME_RESP, &rresp, sizeof(rresp));
+               resume_resp_t rresp = { .ok = 0, .session_id = 0, .caps = caps, .version = PROTO_V1 };
+               io_put(&io, OP_RESUME_RESP, &rresp, sizeof(rresp));
                // Client should try Login
            }
        }
@@ -348,98 +456,237 @@ static void run_session(int cfd, SSL *ssl, shm_stats_t *stats, shm_store_t *stor
        }
     }
 
+    // AI speculation: one worker thread per session, started once logged in
+    static ai_spec_t spec;
+    static ai_search_t spec_search;
+    static ai_cached_t spec_cached;
+    uint64_t spec_runs = 0, spec_cancels = 0; // already in the shared stats
+    int spec_on = (g_speculate > 0 || (g_speculate < 0 && g_tiers[tier].kind == AI_SEARCH)) &&
+                  ai_spec_start(&spec, ai_policy(&spec_search, &spec_cached, tier, &spec.stop)) == 0;
+    session_idle_t idle = { &jr, spec_on ? &spec : NULL, &st, &hand, &rng };
+    io.idle = session_on_idle;
+    io.idle_ctx = &idle;
+
     // Main Loop
     for (;;) {
         uint16_t op = 0;
         uint32_t plen = 0;
         
         if (st.turn == 1 && !st.game_over) {
-             process_ai_turn(&st, &hand);
+             run_ai_turn(&st, &log, &hand, &rng, stats, &jr, my_sid, tier, NULL, NULL,
+                         AI_SLOT_ASK, now_ns());
              // Save state after AI
-             ipc_save_session(store, my_sid, &st, &hand);
+             ipc_save_session(store, my_sid, &st, &log, &hand, rng);
         }
 
-        if (proto_recv(&conn, &op, payload, sizeof(payload), &plen) != 0) break;
+        if (io_next(&io, &op, payload, sizeof(payload), &plen) != 0) break;
 
         ipc_stats_inc_pkt(stats);
         // implicit heartbeat on any packet
         ipc_touch_session(store, my_sid);
 
         if (op == OP_PING) {
-            proto_send(&conn, OP_PONG, NULL, 0);
+            io_put(&io, OP_PONG, NULL, 0);
             continue;
         }
 
         if (st.game_over) {
-            proto_send(&conn, OP_STATE, &st, sizeof(st));
-            proto_send(&conn, OP_HAND, &hand, sizeof(hand));
+            if (op == OP_PLAY_CARD && (caps & CAP_PLAY_SEQ) && plen == sizeof(play_seq_req_t)) {
+                play_ack_t ack = { .rc = -13 }; // game over: the play is dropped
+                memcpy(&ack.seq, payload + offsetof(play_seq_req_t, seq), sizeof(ack.seq));
+                io_put(&io, OP_PLAY_ACK, &ack, sizeof(ack));
+            }
+            send_state(&io, &st, &log, caps);
+            io_put(&io, OP_HAND, &hand, sizeof(hand));
             continue;
         }
 
         if (op == OP_PLAY_CARD) {
-            if (st.turn != 0) { err_send(&conn, -11, "not your turn"); continue; }
-            if (st.phase != PHASE_MAIN) { err_send(&conn, -12, "phase error"); continue; }
-            if (plen != sizeof(play_req_t)) { err_send(&conn, -10, "bad payload"); continue; }
+            // a tagged play is acknowledged before anything else it causes
+            int tagged = (caps & CAP_PLAY_SEQ) && plen == sizeof(play_seq_req_t);
+            play_ack_t ack = { .seq = 0, .rc = 0 };
+            if (tagged) memcpy(&ack.seq, payload + offsetof(play_seq_req_t, seq), sizeof(ack.seq));
+
+            int pre = 0;
+            if (st.turn != 0) pre = -11;
+            else if (st.phase != PHASE_MAIN) pre = -12;
+            else if (plen != sizeof(play_req_t) && !tagged) pre = -10;
+            if (pre != 0) {
+                if (tagged) { ack.rc = pre; io_put(&io, OP_PLAY_ACK, &ack, sizeof(ack)); }
+                err_send(&io, pre, pre == -11 ? "not your turn" : pre == -12 ? "phase error" : "bad payload");
+                continue;
+            }
 
             play_req_t pr;
             memcpy(&pr, payload, sizeof(pr));
 
-            int rc = handle_play_card(&st, &hand, 1, pr.hand_idx);
+            int rc = engine_play_card(&st, &hand, 1, pr.hand_idx, &rng, &log);
+            journal_log_state(&jr, my_sid, JR_PLAY, (int8_t)pr.hand_idx, &st, &log, &hand);
+            if (tagged) { ack.rc = rc; io_put(&io, OP_PLAY_ACK, &ack, sizeof(ack)); }
             if (rc == 0) {
                 // ok
             } else {
-                if (rc == -1) err_send(&conn, -1, "invalid hand idx");
-                else if (rc == -2) err_send(&conn, -2, "not enough mana");
-                else err_send(&conn, -3, "invalid card");
+                if (rc == -1) err_send(&io, -1, "invalid hand idx");
+                else if (rc == -2) err_send(&io, -2, "not enough mana");
+                else err_send(&io, -3, "invalid card");
             }
             
-            ipc_save_session(store, my_sid, &st, &hand); // Sync to SHM
+            ipc_save_session(store, my_sid, &st, &log, &hand, rng); // Sync to SHM
 
-            proto_send(&conn, OP_STATE, &st, sizeof(st));
-            proto_send(&conn, OP_HAND, &hand, sizeof(hand));
+            send_state(&io, &st, &log, caps);
+            io_put(&io, OP_HAND, &hand, sizeof(hand));
             continue;
         }
 
         if (op == OP_END_TURN) {
-            if (st.turn != 0) { err_send(&conn, -11, "not your turn"); continue; }
+            if (st.turn != 0) { err_send(&io, -11, "not your turn"); continue; }
+
+            long long t0 = now_ns(); // the AI turn includes any wait below
+            ai_plan_t plan;
+            int have_plan = 0;
+            int slot = AI_SLOT_ASK;
+            if (spec_on) {
+                // finishing the run puts it at normal priority: that needs the
+                // slot a search of our own would; without one, play greedy
+                int wait = 1;
+                if (!ai_spec_ready(&spec, &st, &hand, rng)) {
+                    slot = ai_slot_acquire(tier);
+                    if (AI_SLOT_REFUSED(slot)) wait = 0;
+                }
+                int rc = ai_spec_take(&spec, &st, &hand, rng, wait, &plan);
+                // the worker is idle now: its counters can be read
+                ipc_stats_add_spec(stats, rc, spec.runs - spec_runs, spec.cancelled - spec_cancels);
+                spec_runs = spec.runs;
+                spec_cancels = spec.cancelled;
+                add_search_stats(stats, &spec_search);
+                have_plan = rc > 0;
+            }
 
-            phase_end(&st, &hand); // Switch to AI
+            phase_end(&st, &hand, &rng, &log); // Switch to AI
+            journal_log_state(&jr, my_sid, JR_END_TURN, 0, &st, &log, &hand);
             
-            ipc_save_session(store, my_sid, &st, &hand);
+            ipc_save_session(store, my_sid, &st, &log, &hand, rng);
 
             if (st.turn == 1 && !st.game_over) {
-                 process_ai_turn(&st, &hand);
-                 ipc_save_session(store, my_sid, &st, &hand);
+                 int stream = (caps & CAP_AI_STREAM) != 0;
+                 if (stream) {
+                     // answered before the AI thinks: the AI's turn has begun
+                     send_state(&io, &st, &log, caps);
+                     io_flush(&io);
+                 }
+                 run_ai_turn(&st, &log, &hand, &rng, stats, &jr, my_sid, tier, stream ? &io : NULL,
+                             have_plan ? &plan : NULL, slot, t0);
+                 ipc_save_session(store, my_sid, &st, &log, &hand, rng);
+            } else if (slot >= 0) {
+                 ipc_aisched_release(g_aisched, slot); // the game ended: no AI turn
             }
 
-            proto_send(&conn, OP_STATE, &st, sizeof(st));
-            proto_send(&conn, OP_HAND, &hand, sizeof(hand));
+            send_state(&io, &st, &log, caps);
+            io_put(&io, OP_HAND, &hand, sizeof(hand));
             continue;
         }
 
-        // Ignore duplicates LOGIN/RESUME in loop
-        if (op == OP_LOGIN_REQ || op == OP_RESUME_REQ) continue;
+        // Ignore duplicates LOGIN/RESUME in loop (v2: every request is answered)
+        if (op == OP_LOGIN_REQ || op == OP_RESUME_REQ) {
+            if (io.ver >= PROTO_V2) err_send(&io, -14, "already in a session");
+            continue;
+        }
 
-        err_send(&conn, -99, "unknown opcode");
+        err_send(&io, -99, "unknown opcode");
     }
 
+    // a finished game cannot be resumed into anything useful: free its slot now
+    if (st.game_over) ipc_release_session(store, my_sid);
+
+    io_flush(&io);
+    if (spec_on) {
+        ai_spec_stop(&spec);
+        add_search_stats(stats, &spec_search);
+    }
+    journal_close(&jr);
     conn_close(&conn);
 }
 
 int main(int argc, char **argv) {
     uint16_t port = 9000;
-    if (argc >= 2) port = (uint16_t)atoi(argv[1]);
+    unsigned tt_bits = 20;
+    int use_aicache = 1;
+    const char *cert_file = "server.crt", *key_file = "server.key";
+    const char *tls_ciphers = NULL, *tls_groups = NULL;
+    int tls13_only = 0;
+    long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+    int ai_slots = nproc > 0 ? (int)nproc : 1;
+    int ai_queue = -1;       // -1: 4 per slot
+    int ai_deadline_ms = 100;
+    int store_log = 1;
+
+    // ./server [port] [--ai greedy|search] [--ai-depth N] [--tt-bits N] [--no-ai-cache]
+    //          [--journal DIR] [--cert FILE --key FILE] [--tls-ciphers LIST]
+    //          [--tls-groups LIST] [--tls13-only] [--proto-max N] [--[no-]ai-speculate]
+    //          [--ai-slots N] [--ai-queue N] [--ai-deadline MS] [--no-store-log]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ai") == 0 && i + 1 < argc) {
+            i++;
+            g_ai_kind = (strcmp(argv[i], "search") == 0) ? AI_SEARCH : AI_GREEDY;
+        } else if (strcmp(argv[i], "--ai-depth") == 0 && i + 1 < argc) {
+            g_search.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tt-bits") == 0 && i + 1 < argc) {
+            tt_bits = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-ai-cache") == 0) {
+            use_aicache = 0;
+        } else if (strcmp(argv[i], "--ai-speculate") == 0) {
+            g_speculate = 1;
+        } else if (strcmp(argv[i], "--no-ai-speculate") == 0) {
+            g_speculate = 0;
+        } else if (strcmp(argv[i], "--ai-slots") == 0 && i + 1 < argc) {
+            ai_slots = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ai-queue") == 0 && i + 1 < argc) {
+            ai_queue = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ai-deadline") == 0 && i + 1 < argc) {
+            ai_deadline_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-store-log") == 0) {
+            store_log = 0;
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            g_journal_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cert") == 0 && i + 1 < argc) {
+            cert_file = argv[++i];
+        } else if (strcmp(argv[i], "--key") == 0 && i + 1 < argc) {
+            key_file = argv[++i];
+        } else if (strcmp(argv[i], "--tls-ciphers") == 0 && i + 1 < argc) {
+            tls_ciphers = argv[++i];
+        } else if (strcmp(argv[i], "--tls-groups") == 0 && i + 1 < argc) {
+            tls_groups = argv[++i];
+        } else if (strcmp(argv[i], "--tls13-only") == 0) {
+            tls13_only = 1;
+        } else if (strcmp(argv[i], "--proto-max") == 0 && i + 1 < argc) {
+            int v = atoi(argv[++i]);
+            g_proto_max = (uint16_t)(v < PROTO_V1 ? PROTO_V1 : v > PROTO_VERSION ? PROTO_VERSION : v);
+        } else {
+            port = (uint16_t)atoi(argv[i]);
+        }
+    }
 
-    signal(SIGINT, on_sigint);
-    signal(SIGTERM, on_sigint);
-    signal(SIGCHLD, on_sigchld);
+    // before fork: every worker inherits the checked table
+    if (cards_init() != 0) return 1;
+
+    on_signal(SIGINT, on_sigint, 0);   // no SA_RESTART: accept() returns, the loop sees g_stop
+    on_signal(SIGTERM, on_sigint, 0);
+    on_signal(SIGCHLD, on_sigchld, SA_RESTART | SA_NOCLDSTOP);
 
     ssl_msg_init();
-    SSL_CTX *ctx = ssl_init_server_ctx("server.crt", "server.key");
+    SSL_CTX *ctx = ssl_init_server_ctx(cert_file, key_file);
     if (!ctx) {
         fprintf(stderr, "Failed to init SSL context. Check certs.\n");
         return 1;
     }
+    if (ssl_ctx_set_profile(ctx, tls_ciphers, tls_groups, tls13_only) != 0) return 1;
+    // created before fork: every worker shares the ticket keys, so a client
+    // can resume on any worker (the per-process session cache cannot)
+    char key_name[32];
+    log_info("[server] TLS: %s key=%s ciphers=%s groups=%s%s\n", cert_file,
+             ssl_ctx_key_name(ctx, key_name, sizeof(key_name)),
+             tls_ciphers ? tls_ciphers : "default", tls_groups ? tls_groups : "default",
+             tls13_only ? " tls1.3-only" : "");
 
     shm_stats_t *stats = ipc_stats_init(1);
     if (!stats) {
@@ -452,6 +699,52 @@ int main(int argc, char **argv) {
         perror("ipc_store_init");
         return 1;
     }
+    store->keep_log = (uint32_t)store_log;
+
+    if (use_aicache) {
+        g_aicache = ipc_aicache_init(1);
+        if (!g_aicache) {
+            perror("ipc_aicache_init");
+            return 1;
+        }
+    }
+
+    // created before fork: all workers share one table. Every server has
+    // it, since the normal and hard tiers search whatever --ai says
+    g_search.tt = ai_tt_create(tt_bits);
+    if (!g_search.tt) {
+        perror("ai_tt_create");
+        return 1;
+    }
+    g_tiers[AI_TIER_DEFAULT].kind = g_ai_kind;
+    g_tiers[AI_TIER_DEFAULT].depth = g_search.depth;
+    g_tiers[AI_TIER_DEFAULT].max_nodes = g_search.max_nodes;
+    if (g_ai_kind == AI_SEARCH)
+        log_info("[server] AI: search depth=%d tt=2^%u entries\n", g_search.depth, tt_bits);
+    // greedy turns take microseconds: speculate only for sessions that search
+    if (g_speculate) log_info("[server] AI: speculating during the player's turn%s\n",
+                              g_speculate < 0 ? " (searching tiers)" : "");
+
+    if (ai_slots > 0) {
+        g_aisched = ipc_aisched_init(1);
+        if (!g_aisched) {
+            perror("ipc_aisched_init");
+            return 1;
+        }
+        g_aisched->slots = (uint32_t)(ai_slots < AISCHED_MAX_SLOTS ? ai_slots : AISCHED_MAX_SLOTS);
+        g_aisched->queue_max = (uint32_t)(ai_queue < 0 ? 4 * g_aisched->slots : (uint32_t)ai_queue);
+        g_aisched->deadline_ms = (uint32_t)(ai_deadline_ms < 0 ? 0 : ai_deadline_ms);
+        log_info("[server] AI budget: %u searching turns at once, queue %u, deadline %u ms\n",
+                 g_aisched->slots, g_aisched->queue_max, g_aisched->deadline_ms);
+    }
+
+    if (g_journal_dir) {
+        if (mkdir(g_journal_dir, 0755) != 0 && errno != EEXIST) {
+            perror("mkdir journal");
+            return 1;
+        }
+        log_info("[server] journal: %s\n", g_journal_dir);
+    }
 
     int lfd = tcp_listen(port);
     if (lfd < 0) {
@@ -473,6 +766,9 @@ int main(int argc, char **argv) {
             
             // Set 5 seconds timeout for handshake/recv
             net_set_timeout(cfd, 5);
+            // sess_io_t already batches; a flush is meant to leave now
+            int one = 1;
+            setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
             // SSL Handshake in Child
             SSL *ssl = SSL_new(ctx);
@@ -505,11 +801,14 @@ int main(int argc, char **argv) {
 
     close(lfd);
     SSL_CTX_free(ctx);
+    ai_tt_destroy(g_search.tt);
     log_info("[server] shutdown initiated\n");
 
     // --- Cleanup Shared Memory ---
     shm_unlink(PROTO_MAGIC_SHM); 
     shm_unlink(STORE_MAGIC_SHM);
+    shm_unlink(AICACHE_MAGIC_SHM);
+    shm_unlink(AISCHED_MAGIC_SHM);
     
     log_info("Shared memory unlinked\n");
     return 0;
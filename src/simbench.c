@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+#include "common/engine.h"
+#include "common/batch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * simbench: offline simulator for the batch (SoA) engine.
+ *
+ *   ./simbench verify [games] [turns] [seed]   differential check vs the scalar engine
+ *   ./simbench bench  [max_turns]              games/s for batch sizes 8..64k
+ */
+
+#define PLAYS_PER_TURN 3
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t xorshift32(uint32_t *s) {
+    uint32_t x = *s;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return *s = x;
+}
+
+// random kinds, including "no card" so the invalid path is exercised too
+static uint8_t* make_kinds(size_t len, uint32_t seed, int with_invalid) {
+    uint8_t *k = malloc(len);
+    if (!k) return NULL;
+    int span = DRAW_POOL_SIZE + (with_invalid ? 1 : 0);
+    for (size_t i = 0; i < len; i++) {
+        int v = (int)(xorshift32(&seed) % (uint32_t)span);
+        k[i] = (v >= DRAW_POOL_SIZE) ? BATCH_NO_CARD : (uint8_t)v;
+    }
+    return k;
+}
+
+static void new_game(state_t *st) {
+    memset(st, 0, sizeof(*st));
+    st->p_hp = 30; st->ai_hp = 30;
+    st->max_mana = 3; st->mana = 3;
+}
+
+static evlog_t g_log; // where loud plays' events go (never read)
+
+// scalar reference: exactly what the server does, minus the draw
+static int scalar_play(state_t *st, uint8_t kind, int loud) {
+    hand_t h;
+    h.n = 1;
+    h.card_ids[0] = (kind < DRAW_POOL_SIZE) ? engine_draw_pool()[kind] : 0;
+    return loud ? handle_play_card(st, &h, st->turn == 0, 0, &g_log)
+                : engine_play_quiet(st, &h, st->turn == 0, 0);
+}
+
+static void scalar_end(state_t *st) {
+    engine_end_quiet(st);
+    if (st->game_over) return;
+    st->turn = (uint8_t)(st->turn ? 0 : 1);
+    st->mana = st->max_mana;
+    st->phase = PHASE_MAIN;
+}
+
+static int same_numeric(const state_t *a, const state_t *b) {
+    return a->p_hp == b->p_hp && a->ai_hp == b->ai_hp &&
+           a->p_shield == b->p_shield && a->ai_shield == b->ai_shield &&
+           a->p_buff == b->p_buff && a->ai_buff == b->ai_buff &&
+           a->p_poison == b->p_poison && a->ai_poison == b->ai_poison &&
+           a->mana == b->mana && a->max_mana == b->max_mana &&
+           a->turn == b->turn && a->game_over == b->game_over && a->winner == b->winner;
+}
+
+static void dump(const char *tag, const state_t *s) {
+    fprintf(stderr, "  %-6s hp %d/%d shd %d/%d buf %d/%d psn %u/%u mana %u/%u turn %u over %u win %u\n",
+            tag, s->p_hp, s->ai_hp, s->p_shield, s->ai_shield, s->p_buff, s->ai_buff,
+            s->p_poison, s->ai_poison, s->mana, s->max_mana, s->turn, s->game_over, s->winner);
+}
+
+/* ---------- verify ---------- */
+
+static int verify_one(size_t games, int turns, uint32_t seed, int force_scalar) {
+    batch_force_scalar(force_scalar);
+
+    state_t *ref = calloc(games, sizeof(state_t));
+    batch_t b;
+    if (!ref || batch_init(&b, games) != 0) { fprintf(stderr, "out of memory\n"); return 1; }
+
+    // random (not only fresh) starting states to reach shields, buffs, wraps, 0 HP
+    uint32_t rs = seed;
+    for (size_t i = 0; i < games; i++) {
+        state_t *s = &ref[i];
+        memset(s, 0, sizeof(*s));
+        s->p_hp = (int16_t)(xorshift32(&rs) % 40);
+        s->ai_hp = (int16_t)(xorshift32(&rs) % 40);
+        s->p_shield = (int16_t)(xorshift32(&rs) % 8);
+        s->ai_shield = (int16_t)(xorshift32(&rs) % 8);
+        s->p_buff = (int16_t)(xorshift32(&rs) % 6);
+        s->ai_buff = (int16_t)(xorshift32(&rs) % 6);
+        s->p_poison = (uint8_t)(xorshift32(&rs) % 4 == 0 ? 250 + xorshift32(&rs) % 6 : xorshift32(&rs) % 4);
+        s->ai_poison = (uint8_t)(xorshift32(&rs) % 4);
+        s->max_mana = (uint8_t)(1 + xorshift32(&rs) % 5);
+        s->mana = (uint8_t)(xorshift32(&rs) % (s->max_mana + 1u));
+        s->turn = (uint8_t)(xorshift32(&rs) & 1);
+        batch_load(&b, i, s);
+    }
+
+    size_t steps = (size_t)turns * PLAYS_PER_TURN;
+    uint8_t *kinds = make_kinds(games + steps, seed ^ 0xA5A5A5u, 1);
+    int16_t *rc = calloc(games, sizeof(int16_t));
+    int bad = 0;
+
+    for (int t = 0; t < turns && !bad; t++) {
+        for (int j = 0; j < PLAYS_PER_TURN && !bad; j++) {
+            const uint8_t *k = kinds + (size_t)t * PLAYS_PER_TURN + (size_t)j;
+            batch_play(&b, k, rc);
+            for (size_t i = 0; i < games; i++) {
+                int r = scalar_play(&ref[i], k[i], 1);
+                state_t got = ref[i];
+                batch_store(&b, i, &got);
+                if (r != rc[i] || !same_numeric(&got, &ref[i])) {
+                    fprintf(stderr, "MISMATCH play game=%zu turn=%d kind=%u rc=%d/%d\n",
+                            i, t, k[i], r, rc[i]);
+                    dump("scalar", &ref[i]);
+                    dump("batch", &got);
+                    bad = 1;
+                    break;
+                }
+            }
+        }
+        if (bad) break;
+        batch_end_phase(&b);
+        for (size_t i = 0; i < games; i++) {
+            scalar_end(&ref[i]);
+            state_t got = ref[i];
+            batch_store(&b, i, &got);
+            if (!same_numeric(&got, &ref[i])) {
+                fprintf(stderr, "MISMATCH end game=%zu turn=%d\n", i, t);
+                dump("scalar", &ref[i]);
+                dump("batch", &got);
+                bad = 1;
+                break;
+            }
+        }
+    }
+
+    size_t over = 0;
+    for (size_t i = 0; i < games; i++) over += ref[i].game_over;
+    printf("verify %-6s games=%zu turns=%d finished=%zu : %s\n",
+           force_scalar ? "scalar" : (batch_simd_enabled() ? "avx2" : "scalar"),
+           games, turns, over, bad ? "FAIL" : "OK");
+
+    free(rc); free(kinds); free(ref);
+    batch_free(&b);
+    batch_force_scalar(0);
+    return bad;
+}
+
+static int cmd_verify(int argc, char **argv) {
+    size_t games = (argc >= 3) ? (size_t)atol(argv[2]) : 10007; // odd: exercises the scalar tail
+    int turns = (argc >= 4) ? atoi(argv[3]) : 60;
+    uint32_t seed = (argc >= 5) ? (uint32_t)strtoul(argv[4], NULL, 0) : 12345u;
+    if (seed == 0) seed = 1;
+
+    int bad = verify_one(games, turns, seed, 1);
+    if (batch_simd_enabled()) bad |= verify_one(games, turns, seed, 0);
+    return bad ? 1 : 0;
+}
+
+/* ---------- bench ---------- */
+
+// games/s: every game runs from a fresh state until game over (or max_turns)
+static double bench_scalar(size_t n, int max_turns, const uint8_t *kinds) {
+    state_t *g = malloc(n * sizeof(state_t));
+    for (size_t i = 0; i < n; i++) new_game(&g[i]);
+
+    long long t0 = now_ns();
+    size_t done = 0;
+    for (size_t i = 0; i < n; i++) {
+        state_t *st = &g[i];
+        for (int t = 0; t < max_turns && !st->game_over; t++) {
+            for (int j = 0; j < PLAYS_PER_TURN && !st->game_over; j++)
+                scalar_play(st, kinds[i + (size_t)t * PLAYS_PER_TURN + (size_t)j], 0);
+            if (!st->game_over) scalar_end(st);
+        }
+        done += st->game_over;
+    }
+    double secs = (double)(now_ns() - t0) / 1e9;
+    free(g);
+    return (double)done / secs;
+}
+
+static double bench_batch(size_t n, int max_turns, const uint8_t *kinds, int force_scalar) {
+    batch_force_scalar(force_scalar);
+    batch_t b;
+    if (batch_init(&b, n) != 0) return 0;
+    state_t fresh;
+    new_game(&fresh);
+    for (size_t i = 0; i < n; i++) batch_load(&b, i, &fresh);
+    uint8_t *k = malloc(n);
+
+    long long t0 = now_ns();
+    for (int t = 0; t < max_turns; t++) {
+        for (int j = 0; j < PLAYS_PER_TURN; j++) {
+            const uint8_t *src = kinds + (size_t)t * PLAYS_PER_TURN + (size_t)j;
+            for (size_t i = 0; i < n; i++) k[i] = b.game_over[i] ? BATCH_NO_CARD : src[i];
+            batch_play(&b, k, NULL);
+        }
+        batch_end_phase(&b);
+    }
+    size_t done = 0;
+    for (size_t i = 0; i < n; i++) done += (size_t)b.game_over[i];
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    free(k);
+    batch_free(&b);
+    batch_force_scalar(0);
+    return (double)done / secs;
+}
+
+static int cmd_bench(int argc, char **argv) {
+    int max_turns = (argc >= 3) ? atoi(argv[2]) : 40;
+    static const size_t sizes[] = { 8, 64, 512, 4096, 32768, 65536 };
+    size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    int simd = batch_simd_enabled();
+
+    printf("max_turns=%d plays/turn=%d simd=%s\n", max_turns, PLAYS_PER_TURN, simd ? "avx2" : "none");
+    printf("%8s %16s %16s %16s\n", "batch", "scalar-engine", "batch-scalar", "batch-avx2");
+
+    for (size_t s = 0; s < nsizes; s++) {
+        size_t n = sizes[s];
+        // repeat small batches so each point runs long enough to time
+        int reps = (int)(65536 / n);
+        if (reps < 1) reps = 1;
+        uint8_t *kinds = make_kinds(n + (size_t)max_turns * PLAYS_PER_TURN, (uint32_t)(n * 2654435761u) | 1u, 0);
+
+        double a = 0, b = 0, c = 0;
+        for (int r = 0; r < reps; r++) {
+            a += bench_scalar(n, max_turns, kinds);
+            b += bench_batch(n, max_turns, kinds, 1);
+            if (simd) c += bench_batch(n, max_turns, kinds, 0);
+        }
+        printf("%8zu %16.0f %16.0f %16.0f\n", n, a / reps, b / reps, c / reps);
+        free(kinds);
+    }
+    printf("(games/s, higher is better)\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (cards_init() != 0) return 1;
+    if (argc >= 2 && strcmp(argv[1], "verify") == 0) return cmd_verify(argc, argv);
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) return cmd_bench(argc, argv);
+
+    fprintf(stderr, "usage: %s verify [games] [turns] [seed]\n"
+                    "       %s bench [max_turns]\n", argv[0], argv[0]);
+    return 2;
+}
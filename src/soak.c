@@ -0,0 +1,324 @@
+#define _DEFAULT_SOURCE
+#include "soak.h"
+#include "common/ipc.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+enum { M_RSS = 0, M_CHILD_RSS, M_FDS, M_CHILDREN, M_ZOMBIES, M_STORE_USED, M_STORE_STALE, M_CONNS, M_COUNT };
+
+static const char *g_metric_names[M_COUNT] = {
+    "rss_kb", "child_rss_kb", "fds", "children", "zombies", "store_used", "store_stale", "conns",
+};
+// conns only ever grows: it is shown as a rate, not checked for leaks
+static const int g_metric_checked[M_COUNT] = { 1, 1, 1, 1, 1, 1, 1, 0 };
+
+#define SOAK_WARMUP 0.2   // share of the run ignored by the trend check
+#define SOAK_MIN_SAMPLES 8
+
+typedef struct {
+    double t;
+    double v[M_COUNT];     // -1 = not available
+} soak_sample_t;
+
+struct soak {
+    pid_t pid;
+    double interval_s;
+    FILE *csv;
+    pthread_t th;
+    atomic_int stop;
+    long long t0;
+    long page_kb;
+    shm_store_t *store;
+    shm_stats_t *stats;
+    soak_sample_t *smp;
+    size_t n, cap;
+};
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int is_pid_dir(const char *name) {
+    for (const char *p = name; *p; p++) if (!isdigit((unsigned char)*p)) return 0;
+    return name[0] != '\0';
+}
+
+/* ---------- /proc ---------- */
+
+// inode of a listening socket on this port, from /proc/net/tcp{,6}
+static unsigned long listen_inode(uint16_t port) {
+    static const char *files[] = { "/proc/net/tcp", "/proc/net/tcp6" };
+    for (int k = 0; k < 2; k++) {
+        FILE *f = fopen(files[k], "r");
+        if (!f) continue;
+        char line[512];
+        unsigned long found = 0;
+        if (!fgets(line, sizeof(line), f)) { fclose(f); continue; } // header
+        while (!found && fgets(line, sizeof(line), f)) {
+            char local[64];
+            unsigned st;
+            unsigned long inode;
+            // sl local rem st tx:rx tr:when retrnsmt uid timeout inode
+            if (sscanf(line, "%*s %63s %*s %x %*s %*s %*s %*s %*s %lu", local, &st, &inode) != 3) continue;
+            char *colon = strrchr(local, ':');
+            if (st == 0x0A && colon && strtoul(colon + 1, NULL, 16) == port) found = inode;
+        }
+        fclose(f);
+        if (found) return found;
+    }
+    return 0;
+}
+
+pid_t soak_find_server(uint16_t port) {
+    unsigned long inode = listen_inode(port);
+    if (!inode) return -1;
+    char want[64];
+    snprintf(want, sizeof(want), "socket:[%lu]", inode);
+
+    DIR *proc = opendir("/proc");
+    if (!proc) return -1;
+    pid_t found = -1;
+    struct dirent *de;
+    while (found < 0 && (de = readdir(proc)) != NULL) {
+        if (!is_pid_dir(de->d_name)) continue;
+        char path[300];
+        snprintf(path, sizeof(path), "/proc/%s/fd", de->d_name);
+        DIR *fds = opendir(path);
+        if (!fds) continue;
+        struct dirent *fe;
+        while ((fe = readdir(fds)) != NULL) {
+            char link[600], target[64];
+            snprintf(link, sizeof(link), "%s/%s", path, fe->d_name);
+            ssize_t n = readlink(link, target, sizeof(target) - 1);
+            if (n <= 0) continue;
+            target[n] = '\0';
+            if (strcmp(target, want) == 0) { found = (pid_t)atoi(de->d_name); break; }
+        }
+        closedir(fds);
+    }
+    closedir(proc);
+    return found;
+}
+
+static double rss_kb(pid_t pid) {
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    double kb = -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "VmRSS: %lf", &kb) == 1) break;
+    fclose(f);
+    return kb;
+}
+
+static double count_fds(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    DIR *d = opendir(path);
+    if (!d) return -1;
+    int n = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) n += (de->d_name[0] != '.');
+    closedir(d);
+    return n;
+}
+
+// workers: every process whose parent is pid
+static void scan_children(soak_t *s, soak_sample_t *o) {
+    o->v[M_CHILDREN] = o->v[M_ZOMBIES] = o->v[M_CHILD_RSS] = 0;
+    DIR *proc = opendir("/proc");
+    if (!proc) return;
+    struct dirent *de;
+    while ((de = readdir(proc)) != NULL) {
+        if (!is_pid_dir(de->d_name)) continue;
+        char path[300], buf[1024];
+        snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+        fclose(f);
+        buf[n] = '\0';
+
+        // the command name may contain spaces: fields start after the last ')'
+        char *p = strrchr(buf, ')');
+        char state;
+        int ppid;
+        long rss;
+        if (!p || sscanf(p + 2, "%c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+                          &state, &ppid, &rss) != 3) continue;
+        if (ppid != s->pid) continue;
+        if (state == 'Z') { o->v[M_ZOMBIES]++; continue; }
+        o->v[M_CHILDREN]++;
+        o->v[M_CHILD_RSS] += (double)rss * (double)s->page_kb;
+    }
+    closedir(proc);
+}
+
+static void scan_store(soak_t *s, soak_sample_t *o) {
+    if (!s->store) s->store = ipc_store_init(0); // the server may start after us
+    if (!s->stats) s->stats = ipc_stats_init(0);
+    o->v[M_STORE_USED] = o->v[M_STORE_STALE] = o->v[M_CONNS] = -1;
+    if (s->stats) o->v[M_CONNS] = (double)s->stats->total_connections;
+    if (!s->store) return;
+
+    time_t now = time(NULL);
+    uint32_t used = 0, stale = 0;
+    for (uint32_t i = 0; i < MAX_SESSIONS; i++) {
+        const session_entry_t *e = &s->store->sessions[i];
+        if (!e->valid) continue;
+        used++;
+        stale += (now - e->last_seen > SESSION_TTL_SEC);
+    }
+    o->v[M_STORE_USED] = used;
+    o->v[M_STORE_STALE] = stale;
+}
+
+static void take_sample(soak_t *s) {
+    if (s->n == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 256;
+        soak_sample_t *ns = realloc(s->smp, cap * sizeof(*ns));
+        if (!ns) return;
+        s->smp = ns;
+        s->cap = cap;
+    }
+    soak_sample_t *o = &s->smp[s->n++];
+    o->t = (double)(now_ns() - s->t0) / 1e9;
+    o->v[M_RSS] = rss_kb(s->pid);
+    o->v[M_FDS] = count_fds(s->pid);
+    scan_children(s, o);
+    scan_store(s, o);
+
+    if (s->csv) {
+        fprintf(s->csv, "%.1f", o->t);
+        for (int m = 0; m < M_COUNT; m++) fprintf(s->csv, ",%.0f", o->v[m]);
+        fprintf(s->csv, "\n");
+        fflush(s->csv);
+    }
+}
+
+static void* sampler(void *p) {
+    soak_t *s = p;
+    while (!atomic_load(&s->stop)) {
+        take_sample(s);
+        // sleep in slices so soak_stop does not wait a whole interval
+        long long until = now_ns() + (long long)(s->interval_s * 1e9);
+        while (!atomic_load(&s->stop) && now_ns() < until) {
+            struct timespec ts = { 0, 50000000L };
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+soak_t* soak_start(pid_t pid, double interval_s, const char *csv_path) {
+    soak_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->pid = pid;
+    s->interval_s = interval_s > 0 ? interval_s : 5;
+    s->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    s->t0 = now_ns();
+    if (csv_path) {
+        s->csv = fopen(csv_path, "w");
+        if (!s->csv) { perror(csv_path); free(s); return NULL; }
+        fprintf(s->csv, "t_s");
+        for (int m = 0; m < M_COUNT; m++) fprintf(s->csv, ",%s", g_metric_names[m]);
+        fprintf(s->csv, "\n");
+    }
+    if (pthread_create(&s->th, NULL, sampler, s) != 0) {
+        if (s->csv) fclose(s->csv);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/* ---------- trends ---------- */
+
+typedef struct {
+    double first, last, min, max, slope_h;
+    int grew, valid;
+} trend_t;
+
+static trend_t trend_of(const soak_t *s, int m) {
+    trend_t tr = { .min = INFINITY, .max = -INFINITY };
+    size_t lo = (size_t)((double)s->n * SOAK_WARMUP);
+    size_t n = 0;
+    double st = 0, sv = 0, stt = 0, stv = 0;
+    for (size_t i = lo; i < s->n; i++) {
+        const soak_sample_t *o = &s->smp[i];
+        double v = o->v[m];
+        if (v < 0) continue;
+        if (n == 0) tr.first = v;
+        tr.last = v;
+        if (v < tr.min) tr.min = v;
+        if (v > tr.max) tr.max = v;
+        st += o->t; sv += v; stt += o->t * o->t; stv += o->t * v;
+        n++;
+    }
+    if (n < 2) return tr;
+    tr.valid = 1;
+    double den = (double)n * stt - st * st;
+    tr.slope_h = den > 0 ? ((double)n * stv - st * sv) / den * 3600.0 : 0;
+
+    if (n < SOAK_MIN_SAMPLES) return tr;
+    // sustained growth: the last quarter never comes back down to the first
+    size_t q = n / 4, k = 0;
+    double head_max = -INFINITY, tail_min = INFINITY;
+    for (size_t i = lo; i < s->n; i++) {
+        double v = s->smp[i].v[m];
+        if (v < 0) continue;
+        if (k < q && v > head_max) head_max = v;
+        if (k >= n - q && v < tail_min) tail_min = v;
+        k++;
+    }
+    tr.grew = tail_min > head_max && tr.slope_h > 0;
+    return tr;
+}
+
+int soak_stop(soak_t *s) {
+    if (!s) return 0;
+    atomic_store(&s->stop, 1);
+    pthread_join(s->th, NULL);
+    take_sample(s); // the state right after the load stopped
+
+    double span = s->n ? s->smp[s->n - 1].t : 0;
+    printf("\nsoak: server pid %d, %zu samples every %.1fs over %.0fs (trend after the first %.0f%%)\n",
+           (int)s->pid, s->n, s->interval_s, span, 100 * SOAK_WARMUP);
+    printf("%-14s %12s %12s %12s %12s %12s  %s\n", "metric", "first", "last", "min", "max", "slope/h", "trend");
+
+    int grew = 0;
+    for (int m = 0; m < M_COUNT; m++) {
+        trend_t tr = trend_of(s, m);
+        if (!tr.valid) {
+            printf("%-14s %12s %12s %12s %12s %12s  n/a\n", g_metric_names[m], "-", "-", "-", "-", "-");
+            continue;
+        }
+        const char *verdict = "flat";
+        if (!g_metric_checked[m]) verdict = "(rate)";
+        else if (s->n - (size_t)((double)s->n * SOAK_WARMUP) < SOAK_MIN_SAMPLES) verdict = "too short";
+        else if (tr.grew) { verdict = "GROWING"; grew++; }
+        printf("%-14s %12.0f %12.0f %12.0f %12.0f %12.1f  %s\n",
+               g_metric_names[m], tr.first, tr.last, tr.min, tr.max, tr.slope_h, verdict);
+    }
+    if (grew) printf("%d metric(s) grew for the whole run: possible leak\n", grew);
+
+    if (s->csv) fclose(s->csv);
+    if (s->store) munmap(s->store, sizeof(shm_store_t));
+    if (s->stats) munmap(s->stats, sizeof(shm_stats_t));
+    free(s->smp);
+    free(s);
+    return grew;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Soak sampler: watches a local server while the load generator runs.
+ * Every interval it records, from /proc and the shm segments:
+ *   rss_kb        the accept loop's resident set
+ *   child_rss_kb  sum over the forked workers
+ *   fds           open fds of the accept loop
+ *   children      live workers, zombies counted separately
+ *   store_used    valid session slots, store_stale = valid but past the TTL
+ *   conns         stats total_connections (a rate, never flagged)
+ * At the end each metric gets a least-squares slope and a growth check: after
+ * the warm-up, the lowest value of the last quarter of the run is above the
+ * highest value of the first quarter.
+ */
+
+typedef struct soak soak_t;
+
+// pid of the process listening on this TCP port, -1 if none is visible
+pid_t soak_find_server(uint16_t port);
+
+// Starts the sampler thread; csv_path (NULL = none) gets one row per sample.
+soak_t* soak_start(pid_t pid, double interval_s, const char *csv_path);
+
+// Stops it and prints the trend table. Returns how many metrics grew.
+int soak_stop(soak_t *s);